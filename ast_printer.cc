@@ -0,0 +1,62 @@
+#include "ast_printer.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include "third_party/assert_exception.h"
+
+thread_local AstPrinter * AstPrinter::active_ = nullptr;
+
+namespace {
+
+/// The language options all printers have always used
+clang::LangOptions printing_lang_opts() {
+  clang::LangOptions lang_opts;
+  lang_opts.CPlusPlus = true;
+  return lang_opts;
+}
+
+}  // namespace
+
+AstPrinter::AstPrinter() : lang_opts_(printing_lang_opts()), policy_(lang_opts_) {}
+
+Symbol AstPrinter::symbol(const clang::Stmt * stmt) {
+  assert_exception(stmt != nullptr);
+  const auto it = stmts_.find(stmt);
+  if (it != stmts_.end()) return it->second;
+
+  std::string str;
+  llvm::raw_string_ostream rso(str);
+  stmt->printPretty(rso, nullptr, policy_);
+  rso.flush();
+  const auto ret = symbols_.intern(str);
+  stmts_.emplace(stmt, ret);
+  return ret;
+}
+
+Symbol AstPrinter::name_symbol(const clang::ValueDecl * value_decl) {
+  assert_exception(value_decl != nullptr);
+  const auto it = names_.find(value_decl);
+  if (it != names_.end()) return it->second;
+
+  std::string str;
+  llvm::raw_string_ostream rso(str);
+  value_decl->printName(rso);
+  rso.flush();
+  const auto ret = symbols_.intern(str);
+  names_.emplace(value_decl, ret);
+  return ret;
+}
+
+const std::string & AstPrinter::print_decl(const clang::Decl * decl) {
+  assert_exception(decl != nullptr);
+  const auto it = decls_.find(decl);
+  if (it != decls_.end()) return symbols_.name(it->second);
+
+  std::string str;
+  llvm::raw_string_ostream rso(str);
+  decl->print(rso);
+  rso.flush();
+  const auto ret = symbols_.intern(str);
+  decls_.emplace(decl, ret);
+  return symbols_.name(ret);
+}
@@ -0,0 +1,74 @@
+#ifndef AST_PRINTER_H_
+#define AST_PRINTER_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "clang/AST/Decl.h"
+#include "clang/AST/PrettyPrinter.h"
+#include "clang/AST/Stmt.h"
+#include "clang/Basic/LangOptions.h"
+
+#include "symbol_table.h"
+
+/// Memoizing printer for the AST of one parse. Every pass used to set up
+/// fresh LangOptions, a PrintingPolicy and a stream for every node it printed,
+/// and printed the same nodes over and over. An AstPrinter sets them up once
+/// and prints every statement and declaration at most once, interning the
+/// text as a Symbol, so equal text is equal Symbols.
+/// Nothing rewrites the AST in place, so the text of a node never changes
+/// while its ASTContext lives. ParseSession::parse makes a printer active
+/// on its thread for exactly that long, and the clang_*_printer functions
+/// in clang_utility_functions.h go through it while it is active.
+class AstPrinter {
+ public:
+  AstPrinter();
+  AstPrinter(const AstPrinter &) = delete;
+  AstPrinter & operator=(const AstPrinter &) = delete;
+
+  /// Printer of the calling thread, or nullptr if none is active
+  static AstPrinter * active() { return active_; }
+
+  /// Make a printer the active one of the calling thread until destroyed
+  class Scope {
+   public:
+    explicit Scope(AstPrinter & printer) : previous_(active_) { active_ = &printer; }
+    ~Scope() { active_ = previous_; }
+    Scope(const Scope &) = delete;
+    Scope & operator=(const Scope &) = delete;
+   private:
+    AstPrinter * previous_;
+  };
+
+  /// Text of stmt as printPretty prints it, and its Symbol
+  const std::string & print(const clang::Stmt * stmt) { return symbols_.name(symbol(stmt)); }
+  Symbol symbol(const clang::Stmt * stmt);
+
+  /// Name of value_decl, and its Symbol
+  const std::string & print_name(const clang::ValueDecl * value_decl) { return symbols_.name(name_symbol(value_decl)); }
+  Symbol name_symbol(const clang::ValueDecl * value_decl);
+
+  /// Whole declaration decl, including its definition, if any
+  const std::string & print_decl(const clang::Decl * decl);
+
+  /// Everything printed so far
+  const SymbolTable & symbols() const { return symbols_; }
+
+ private:
+  /// The active printer of each thread
+  static thread_local AstPrinter * active_;
+
+  /// Set up once, used for every statement
+  clang::LangOptions lang_opts_;
+  clang::PrintingPolicy policy_;
+
+  /// Text printed so far, interned
+  SymbolTable symbols_ = {};
+
+  /// Symbol of the text of every node printed so far
+  std::unordered_map<const clang::Stmt *, Symbol> stmts_ = {};
+  std::unordered_map<const clang::ValueDecl *, Symbol> names_ = {};
+  std::unordered_map<const clang::Decl *, Symbol> decls_ = {};
+};
+
+#endif  // AST_PRINTER_H_
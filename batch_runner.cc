@@ -0,0 +1,134 @@
+#include "batch_runner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "third_party/assert_exception.h"
+
+#include "context.h"
+#include "util.h"
+
+std::vector<std::string> batch_inputs(const std::string & dir_or_manifest) {
+  std::vector<std::string> inputs;
+  if (std::filesystem::is_directory(dir_or_manifest)) {
+    for (const auto & entry : std::filesystem::directory_iterator(dir_or_manifest)) {
+      if (entry.is_regular_file() and entry.path().extension() == ".c") inputs.emplace_back(entry.path().string());
+    }
+    // directory_iterator's order is unspecified
+    std::sort(inputs.begin(), inputs.end());
+  } else {
+    std::ifstream manifest(dir_or_manifest);
+    if (not manifest.good()) throw std::logic_error("Cannot read from " + dir_or_manifest + ", maybe it doesn't exist?");
+    std::string line;
+    while (std::getline(manifest, line)) {
+      line.erase(0, line.find_first_not_of(" \t\r"));
+      line.erase(line.find_last_not_of(" \t\r") + 1);
+      if (line.empty() or line.front() == '#') continue;
+      inputs.emplace_back(line);
+    }
+  }
+  if (inputs.empty()) throw std::logic_error("No Domino programs found in " + dir_or_manifest);
+  return inputs;
+}
+
+std::vector<BatchJob> batch_jobs(const std::vector<std::string> & inputs, const std::string & output_dir) {
+  std::vector<BatchJob> jobs;
+  std::set<std::string> file_names;
+  for (const auto & input : inputs) {
+    const auto file_name = std::filesystem::path(input).filename().string();
+    if (not file_names.emplace(file_name).second) {
+      throw std::logic_error("Two batch inputs are named " + file_name + ", their outputs would overwrite each other");
+    }
+    const auto prefix = (std::filesystem::path(output_dir) / file_name).string();
+    jobs.emplace_back(BatchJob{input, prefix + ".out", prefix + ".log"});
+  }
+  return jobs;
+}
+
+namespace {
+
+void str_to_file(const std::string & str, const std::string & file_name) {
+  std::ofstream ofs(file_name);
+  if (not ofs.good()) throw std::logic_error("Cannot write to " + file_name);
+  ofs << str;
+}
+
+/// Run one job on the calling thread, with a Context of its own
+BatchResult run_job(const BatchJob & job, const BatchCompiler & compiler) {
+  const auto start = std::chrono::steady_clock::now();
+  Context ctx;
+  std::ostringstream log;
+  ctx.SetLog(log);
+
+  BatchResult result = {job, true, "", 0.0};
+  try {
+    // Same as main: the result followed by std::endl
+    str_to_file(compiler(file_to_str(job.input), ctx) + "\n", job.output);
+  } catch (const std::exception & e) {
+    result.ok = false;
+    result.error = e.what();
+    log << "domino_preprocessor: Caught exception in main " << std::endl << e.what() << std::endl;
+  }
+
+  try {
+    str_to_file(log.str(), job.log);
+  } catch (const std::exception & e) {
+    if (result.ok) result.error = e.what();
+    result.ok = false;
+  }
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+}  // namespace
+
+std::vector<BatchResult> run_batch(const std::vector<BatchJob> & jobs, const BatchCompiler & compiler,
+                                   const unsigned num_threads) {
+  assert_exception(num_threads >= 1);
+  for (const auto & job : jobs) {
+    const auto output_dir = std::filesystem::path(job.output).parent_path();
+    if (not output_dir.empty()) std::filesystem::create_directories(output_dir);
+  }
+
+  // Each worker claims the next unclaimed job until none are left,
+  // and is the only one to write that job's slot in results.
+  std::vector<BatchResult> results(jobs.size());
+  std::atomic<size_t> next_job(0);
+  const auto worker = [&jobs, &compiler, &results, &next_job] () {
+    for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+      results.at(i) = run_job(jobs.at(i), compiler);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned i = 0; i < std::min<size_t>(num_threads, jobs.size()); i++) pool.emplace_back(worker);
+  for (auto & thread : pool) thread.join();
+  return results;
+}
+
+bool print_batch_summary(std::ostream & out, const std::vector<BatchResult> & results, const double wall_seconds) {
+  size_t failed = 0;
+  double cpu_seconds = 0.0;
+  for (const auto & result : results) {
+    cpu_seconds += result.seconds;
+    if (result.ok) {
+      out << "ok      " << result.job.input << " -> " << result.job.output
+          << " (" << result.seconds << " s)" << std::endl;
+    } else {
+      failed++;
+      // First line of the error, the rest is in the log
+      out << "FAILED  " << result.job.input << ": " << result.error.substr(0, result.error.find('\n'))
+          << " (see " << result.job.log << ")" << std::endl;
+    }
+  }
+  out << results.size() << " programs, " << results.size() - failed << " succeeded, " << failed << " failed, "
+      << wall_seconds << " s wall, " << cpu_seconds << " s total" << std::endl;
+  return failed == 0;
+}
@@ -0,0 +1,53 @@
+#ifndef BATCH_RUNNER_H_
+#define BATCH_RUNNER_H_
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "context.h"
+
+/// One program to preprocess in batch mode
+struct BatchJob {
+  /// Domino program to read
+  std::string input;
+
+  /// File receiving what a standalone run prints to stdout
+  std::string output;
+
+  /// File receiving what a standalone run prints to stderr,
+  /// e.g., the rename maps and any error
+  std::string log;
+};
+
+/// Outcome of one BatchJob
+struct BatchResult {
+  BatchJob job;
+  bool ok;
+  std::string error;
+  double seconds;
+};
+
+/// Preprocess the text of one program with a fresh Context, throwing on failure
+typedef std::function<std::string(const std::string &, Context &)> BatchCompiler;
+
+/// Inputs for batch mode: every .c file directly inside dir_or_manifest
+/// if it is a directory, otherwise every line of the manifest file
+/// dir_or_manifest, skipping blank lines and lines starting with #.
+std::vector<std::string> batch_inputs(const std::string & dir_or_manifest);
+
+/// One job per input, writing <output_dir>/<input file name>.out and .log.
+/// Throws if two inputs share a file name, since their outputs would collide.
+std::vector<BatchJob> batch_jobs(const std::vector<std::string> & inputs, const std::string & output_dir);
+
+/// Run jobs on a pool of num_threads threads, each job with its own Context,
+/// so that every job produces exactly what a standalone run would.
+/// Results are in the same order as jobs.
+std::vector<BatchResult> run_batch(const std::vector<BatchJob> & jobs, const BatchCompiler & compiler,
+                                   const unsigned num_threads);
+
+/// Print one line per job and a total, returning true if every job succeeded
+bool print_batch_summary(std::ostream & out, const std::vector<BatchResult> & results, const double wall_seconds);
+
+#endif  // BATCH_RUNNER_H_
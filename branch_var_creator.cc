@@ -8,23 +8,22 @@
 using namespace clang;
 
 std::string
-branch_var_creator_transform(const clang::TranslationUnitDecl *tu_decl) {
+branch_var_creator_transform(const clang::TranslationUnitDecl *tu_decl, Context &ctx) {
   UniqueIdentifiers uid(identifier_census(tu_decl));
   return pkt_func_transform(tu_decl,
                             std::bind(&create_branch_var, std::placeholders::_1,
-                                      std::placeholders::_2, uid));
+                                      std::placeholders::_2, uid, std::ref(ctx)));
 }
 
 std::pair<std::string, std::vector<std::string>>
 create_branch_var(const clang::CompoundStmt *function_body,
-                  const std::string &pkt_name, UniqueIdentifiers &uid) {
+                  const std::string &pkt_name, UniqueIdentifiers &uid,
+                  Context &ctx) {
   // Note: need to schedule this pass after SSA.
 
   std::vector<std::string> new_decls;
   std::string out;
 
-  Context &ctx = Context::GetContext();
-
   std::map<std::string, std::string> expr_to_var;
 
   for (const auto *child : function_body->children()) {
@@ -3,6 +3,7 @@
 
 #include "compiler_pass.h"
 #include "pkt_func_transform.h"
+#include "context.h"
 #include "unique_identifiers.h"
 #include "clang/AST/Expr.h"
 
@@ -11,10 +12,11 @@
 #include <vector>
 
 std::string
-branch_var_creator_transform(const clang::TranslationUnitDecl *tu_decl);
+branch_var_creator_transform(const clang::TranslationUnitDecl *tu_decl, Context &ctx);
 
 std::pair<std::string, std::vector<std::string>>
 create_branch_var(const clang::CompoundStmt *function_body,
-                  const std::string &pkt_name, UniqueIdentifiers &uid);
+                  const std::string &pkt_name, UniqueIdentifiers &uid,
+                  Context &ctx);
 
 #endif
\ No newline at end of file
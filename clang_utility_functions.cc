@@ -1,6 +1,8 @@
 #include "clang_utility_functions.h"
 
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include "clang/AST/Expr.h"
 #include "clang/AST/PrettyPrinter.h"
@@ -8,12 +10,15 @@
 #include "clang/Basic/LangOptions.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "ast_printer.h"
 #include "set_idioms.h"
 #include "third_party/assert_exception.h"
 
 using namespace clang;
 
 std::string clang_expr_printer(const clang::Expr *expr) {
+  if (auto *printer = AstPrinter::active()) return printer->print(expr);
+
   clang::LangOptions LangOpts;
   LangOpts.CPlusPlus = true;
   clang::PrintingPolicy Policy(LangOpts);
@@ -27,6 +32,7 @@ std::string clang_expr_printer(const clang::Expr *expr) {
 
 std::string clang_stmt_printer(const clang::Stmt *stmt) {
   assert_exception(stmt != nullptr);
+  if (auto *printer = AstPrinter::active()) return printer->print(stmt);
 
   // Required for pretty printing
   clang::LangOptions LangOpts;
@@ -41,6 +47,8 @@ std::string clang_stmt_printer(const clang::Stmt *stmt) {
 }
 
 std::string clang_value_decl_printer(const clang::ValueDecl *value_decl) {
+  if (auto *printer = AstPrinter::active()) return printer->print_name(value_decl);
+
   // Required for pretty printing
   clang::LangOptions LangOpts;
   LangOpts.CPlusPlus = true;
@@ -53,6 +61,8 @@ std::string clang_value_decl_printer(const clang::ValueDecl *value_decl) {
 }
 
 std::string clang_decl_printer(const clang::Decl *decl) {
+  if (auto *printer = AstPrinter::active()) return printer->print_decl(decl);
+
   // Required for pretty printing
   clang::LangOptions LangOpts;
   LangOpts.CPlusPlus = true;
@@ -193,85 +203,95 @@ bool binop_contains(const clang::BinaryOperator *bin_op,
   return contains;
 }
 
-std::set<std::string> gen_var_list(const Stmt *stmt,
-                                   const VariableTypeSelector &var_selector) {
-  // Recursively scan stmt to generate a set of strings representing
-  // either packet fields or state variables used within stmt
+void collect_var_uses(const Stmt *stmt, AstPrinter &printer, VarUses &uses) {
+  // Recursively scan stmt, appending every packet field and state variable
+  // used within stmt to uses as it goes
   assert_exception(stmt);
-  std::set<std::string> ret;
   if (isa<CompoundStmt>(stmt)) {
-    for (const auto &child : stmt->children()) {
-      ret = ret + gen_var_list(child, var_selector);
-    }
-    return ret;
+    for (const auto *child : stmt->children())
+      collect_var_uses(child, printer, uses);
   } else if (isa<IfStmt>(stmt)) {
     const auto *if_stmt = dyn_cast<IfStmt>(stmt);
-    if (if_stmt->getElse() != nullptr) {
-      return gen_var_list(if_stmt->getCond(), var_selector) +
-             gen_var_list(if_stmt->getThen(), var_selector) +
-             gen_var_list(if_stmt->getElse(), var_selector);
-    } else {
-      return gen_var_list(if_stmt->getCond(), var_selector) +
-             gen_var_list(if_stmt->getThen(), var_selector);
-    }
+    collect_var_uses(if_stmt->getCond(), printer, uses);
+    collect_var_uses(if_stmt->getThen(), printer, uses);
+    if (if_stmt->getElse() != nullptr)
+      collect_var_uses(if_stmt->getElse(), printer, uses);
   } else if (isa<BinaryOperator>(stmt)) {
     const auto *bin_op = dyn_cast<BinaryOperator>(stmt);
-    return gen_var_list(bin_op->getLHS(), var_selector) +
-           gen_var_list(bin_op->getRHS(), var_selector);
+    collect_var_uses(bin_op->getLHS(), printer, uses);
+    collect_var_uses(bin_op->getRHS(), printer, uses);
   } else if (isa<ConditionalOperator>(stmt)) {
     const auto *cond_op = dyn_cast<ConditionalOperator>(stmt);
-    return gen_var_list(cond_op->getCond(), var_selector) +
-           gen_var_list(cond_op->getTrueExpr(), var_selector) +
-           gen_var_list(cond_op->getFalseExpr(), var_selector);
+    collect_var_uses(cond_op->getCond(), printer, uses);
+    collect_var_uses(cond_op->getTrueExpr(), printer, uses);
+    collect_var_uses(cond_op->getFalseExpr(), printer, uses);
   } else if (isa<MemberExpr>(stmt)) {
-    return (var_selector.at(VariableType::PACKET))
-               ? std::set<std::string>{clang_stmt_printer(stmt)}
-               : std::set<std::string>();
+    uses.packet.emplace_back(printer.symbol(stmt));
   } else if (isa<DeclRefExpr>(stmt)) {
-    return (var_selector.at(VariableType::STATE_SCALAR))
-               ? std::set<std::string>{clang_stmt_printer(stmt)}
-               : std::set<std::string>();
+    uses.state_scalar.emplace_back(printer.symbol(stmt));
   } else if (isa<ArraySubscriptExpr>(stmt)) {
-    // We return array name here, not array name subscript index.
+    // We record the array name, not array name subscript index.
     // We assume that the array name is a unique identifier because
     // per-packet we only ever access one address in the array.
-    if (var_selector.at(VariableType::STATE_ARRAY)) {
-      return std::set<std::string>{
-          clang_stmt_printer(dyn_cast<ArraySubscriptExpr>(stmt)->getBase())};
-    } else if (var_selector.at(VariableType::PACKET)) {
-      return std::set<std::string>{
-          clang_stmt_printer(dyn_cast<ArraySubscriptExpr>(stmt)->getIdx())};
-    } else {
-      return std::set<std::string>();
-    }
+    const auto *array_op = dyn_cast<ArraySubscriptExpr>(stmt);
+    uses.state_array.emplace_back(printer.symbol(array_op->getBase()));
+    uses.array_index.emplace_back(printer.symbol(array_op->getIdx()));
   } else if (isa<IntegerLiteral>(stmt) or isa<NullStmt>(stmt)) {
-    return std::set<std::string>();
+    return;
   } else if (isa<ParenExpr>(stmt)) {
-    return gen_var_list(dyn_cast<ParenExpr>(stmt)->getSubExpr(), var_selector);
+    collect_var_uses(dyn_cast<ParenExpr>(stmt)->getSubExpr(), printer, uses);
   } else if (isa<UnaryOperator>(stmt)) {
     const auto *un_op = dyn_cast<UnaryOperator>(stmt);
     assert_exception(un_op->isArithmeticOp());
-    const auto opcode_str =
-        std::string(UnaryOperator::getOpcodeStr(un_op->getOpcode()));
-    // assert_exception(opcode_str == "!");
-    return gen_var_list(un_op->getSubExpr(), var_selector);
+    collect_var_uses(un_op->getSubExpr(), printer, uses);
   } else if (isa<ImplicitCastExpr>(stmt)) {
-    return gen_var_list(dyn_cast<ImplicitCastExpr>(stmt)->getSubExpr(),
-                        var_selector);
+    collect_var_uses(dyn_cast<ImplicitCastExpr>(stmt)->getSubExpr(), printer,
+                     uses);
   } else if (isa<CallExpr>(stmt)) {
-    const auto *call_expr = dyn_cast<CallExpr>(stmt);
-    std::set<std::string> ret;
-    for (const auto *child : call_expr->arguments()) {
-      const auto child_uses = gen_var_list(child, var_selector);
-      ret = ret + child_uses;
-    }
-    return ret;
+    for (const auto *child : dyn_cast<CallExpr>(stmt)->arguments())
+      collect_var_uses(child, printer, uses);
   } else {
     throw std::logic_error("gen_var_list cannot handle stmt of type " +
                            std::string(stmt->getStmtClassName()));
   }
 }
 
+std::set<std::string> gen_var_list(const Stmt *stmt,
+                                   const VariableTypeSelector &var_selector) {
+  std::unique_ptr<AstPrinter> local_printer;
+  auto *printer = AstPrinter::active();
+  if (printer == nullptr) {
+    local_printer = std::make_unique<AstPrinter>();
+    printer = local_printer.get();
+  }
+
+  VarUses uses;
+  collect_var_uses(stmt, *printer, uses);
+
+  // Only look up the kinds that occur, as var_selector need not have the others.
+  // Array accesses are the array if STATE_ARRAY is selected, else the index.
+  std::vector<Symbol> selected;
+  const auto select = [&selected](const std::vector<Symbol> &symbols) {
+    selected.insert(selected.end(), symbols.begin(), symbols.end());
+  };
+  if (not uses.packet.empty() and var_selector.at(VariableType::PACKET))
+    select(uses.packet);
+  if (not uses.state_scalar.empty() and
+      var_selector.at(VariableType::STATE_SCALAR))
+    select(uses.state_scalar);
+  if (not uses.state_array.empty()) {
+    if (var_selector.at(VariableType::STATE_ARRAY))
+      select(uses.state_array);
+    else if (var_selector.at(VariableType::PACKET))
+      select(uses.array_index);
+  }
+
+  std::set<std::string> ret;
+  for (const auto symbol : SymbolSet(std::move(selected)))
+    ret.emplace(printer->symbols().name(symbol));
+  return ret;
+}
+
 std::string generate_scalar_func_def(const FunctionDecl *func_decl) {
   // Yet another C quirk. Adding a semicolon after a function definition
   // is caught by -pedantic, not adding a semicolon after a function declaration
@@ -4,11 +4,14 @@
 #include <set>
 #include <string>
 #include <map>
+#include <vector>
 
 #include "clang/AST/Decl.h"
 #include "clang/AST/Stmt.h"
 #include "clang/AST/OperationKinds.h"
 #include "clang/AST/Expr.h"
+
+#include "ast_printer.h"
 /// Enum class to represent Variable type
 /// PACKET is for the names of all packet fields (in identifier_census)
 /// and packet fields prefixed with "pkt." (in gen_var_list)
@@ -21,6 +24,9 @@ enum class VariableType {PACKET, STATE_SCALAR, STATE_ARRAY, FUNCTION_PARAMETER};
 /// denoting whether a variable should be selected or not
 typedef std::map<VariableType, bool> VariableTypeSelector;
 
+/// The printers below print through the active AstPrinter, if any,
+/// which prints every node once per parse: see ast_printer.h
+
 /// General purpose printer for clang expressions
 std::string clang_expr_printer(const clang::Expr * expr);
 
@@ -63,7 +69,30 @@ bool binop_contains_only(const clang::BinaryOperator * bin_op, const std::set<cl
 /// contains_alternate_stmt: Returns false if bin_op contains a statement that isn't a clang::BinaryOperator.
 bool binop_contains(const clang::BinaryOperator * bin_op, const std::set<clang::BinaryOperatorKind> & operators, bool contains_alternate_stmt = true);
 
+/// Variables used within a clang::Stmt, by kind, as Symbols of their text
+/// in an AstPrinter, in the order they are used, with repeats
+struct VarUses {
+  /// Packet fields, e.g., pkt.x
+  std::vector<Symbol> packet = {};
+
+  /// Scalar state variables
+  std::vector<Symbol> state_scalar = {};
+
+  /// Array state variables: the name of the array at every access,
+  /// and the index it was accessed at, at the same position
+  std::vector<Symbol> state_array = {};
+  std::vector<Symbol> array_index = {};
+
+  void clear() { packet.clear(); state_scalar.clear(); state_array.clear(); array_index.clear(); }
+};
+
+/// Append all variables used within stmt to uses, in one walk over stmt,
+/// so that callers can reuse one VarUses across statements
+/// and get packet and state variables at once
+void collect_var_uses(const clang::Stmt * stmt, AstPrinter & printer, VarUses & uses);
+
 /// Determine all variables (either packet or state) used within a clang::Stmt,
+/// by collect_var_uses through the active AstPrinter
 std::set<std::string> gen_var_list(const clang::Stmt * stmt,
                                    const VariableTypeSelector & var_selector =
                                    {{VariableType::PACKET, true},
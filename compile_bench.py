@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Compile-time benchmark for the domino preprocessor.
+
+Runs the default and --noopt pipelines over every .c file directly inside
+the corpus directories several times, and reports the median and p95
+latency per program and per pass (from --time-passes-json). Results are
+written as JSON; given the JSON of an earlier build with --baseline, any
+program or pass whose median got slower by more than --threshold percent
+is flagged and the exit status is nonzero.
+
+Usage: compile_bench.py --domino ./domino [--runs 5] [--output bench.json]
+                        [--baseline old.json] [--threshold 10] [corpus_dir ...]
+"""
+
+import argparse
+import json
+import math
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+DEFAULT_CORPUS = ["benchmarks", "real_tests", "rjf_tests", "tmp_tests", "domino_test_programs"]
+PIPELINES = {"default": [], "noopt": ["--noopt"]}
+
+
+def p95(samples):
+    """95th percentile, nearest-rank method"""
+    ordered = sorted(samples)
+    return ordered[max(0, math.ceil(0.95 * len(ordered)) - 1)]
+
+
+def summarize(samples):
+    return {"median_ms": statistics.median(samples), "p95_ms": p95(samples), "runs_ms": samples}
+
+
+def corpus_programs(corpus_dirs):
+    programs = []
+    for directory in corpus_dirs:
+        if not os.path.isdir(directory):
+            print("skipping %s: not a directory" % directory, file=sys.stderr)
+            continue
+        programs += sorted(os.path.join(directory, f) for f in os.listdir(directory)
+                           if f.endswith(".c") and os.path.isfile(os.path.join(directory, f)))
+    return programs
+
+
+def pass_times(timings):
+    """Total ms per pass in one run. Passes that run several times, like
+    algebra_simplify, are numbered in order: algebra_simplify#2, ..."""
+    times = {}
+    seen = {}
+    for row in timings:
+        name = row["pass"]
+        seen[name] = seen.get(name, 0) + 1
+        if seen[name] > 1:
+            name += "#%d" % seen[name]
+        times[name] = row["total_seconds"] * 1000.0
+    return times
+
+
+def run_once(domino, program, flags, json_file):
+    start = time.perf_counter()
+    result = subprocess.run([domino, program] + flags + ["--time-passes-json", json_file],
+                            stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    elapsed_ms = (time.perf_counter() - start) * 1000.0
+    if result.returncode != 0:
+        return None, result.stderr.decode(errors="replace").strip().splitlines()[-1:]
+    with open(json_file) as f:
+        return (elapsed_ms, pass_times(json.load(f))), None
+
+
+def benchmark(domino, programs, runs):
+    results = {"programs": {}, "passes": {}, "failed": {}}
+    all_pass_samples = {}
+    with tempfile.TemporaryDirectory() as tmp:
+        json_file = os.path.join(tmp, "timings.json")
+        for pipeline, flags in PIPELINES.items():
+            for program in programs:
+                key = "%s [%s]" % (program, pipeline)
+                latencies = []
+                per_pass = {}
+                for _ in range(runs):
+                    measurement, error = run_once(domino, program, flags, json_file)
+                    if measurement is None:
+                        results["failed"][key] = error[0] if error else "failed"
+                        break
+                    latencies.append(measurement[0])
+                    for name, ms in measurement[1].items():
+                        per_pass.setdefault(name, []).append(ms)
+                if key in results["failed"]:
+                    continue
+                results["programs"][key] = summarize(latencies)
+                results["programs"][key]["passes"] = {name: summarize(samples)
+                                                      for name, samples in per_pass.items()}
+                for name, samples in per_pass.items():
+                    all_pass_samples.setdefault("%s [%s]" % (name, pipeline), []).extend(samples)
+                print("%-50s median %8.2f ms  p95 %8.2f ms" %
+                      (key, results["programs"][key]["median_ms"], results["programs"][key]["p95_ms"]))
+    results["passes"] = {name: summarize(samples) for name, samples in all_pass_samples.items()}
+    return results
+
+
+def print_pass_summary(results):
+    print("\n%-50s %12s %12s" % ("pass (all programs)", "median ms", "p95 ms"))
+    for name, stats in sorted(results["passes"].items(), key=lambda item: -item[1]["median_ms"]):
+        print("%-50s %12.2f %12.2f" % (name, stats["median_ms"], stats["p95_ms"]))
+    for key, error in sorted(results["failed"].items()):
+        print("FAILED %s: %s" % (key, error))
+
+
+def regressions(baseline, results, threshold, min_ms):
+    """Programs and passes whose median got slower by more than threshold
+    percent, ignoring differences below min_ms, which are noise."""
+    flagged = []
+    comparisons = [(key, baseline["programs"].get(key), stats) for key, stats in results["programs"].items()]
+    comparisons += [(key, baseline["passes"].get(key), stats) for key, stats in results["passes"].items()]
+    for key, old, new in comparisons:
+        if old is None:
+            continue
+        increase = new["median_ms"] - old["median_ms"]
+        if increase > min_ms and increase > old["median_ms"] * threshold / 100.0:
+            flagged.append((key, old["median_ms"], new["median_ms"]))
+    # A program that used to compile and now fails is the worst regression of all
+    for key in results["failed"]:
+        if key in baseline["programs"]:
+            flagged.append((key, baseline["programs"][key]["median_ms"], math.inf))
+    return flagged
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile-time benchmark for the domino preprocessor")
+    parser.add_argument("--domino", default="./domino", help="domino binary to benchmark")
+    parser.add_argument("--runs", type=int, default=5, help="runs per program and pipeline")
+    parser.add_argument("--output", default="bench.json", help="where to write the results as JSON")
+    parser.add_argument("--baseline", help="results of an earlier build to compare against")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="flag medians that got slower by more than this many percent")
+    parser.add_argument("--min-ms", type=float, default=1.0,
+                        help="ignore slowdowns smaller than this many ms")
+    parser.add_argument("corpus", nargs="*", default=DEFAULT_CORPUS, help="directories of .c programs")
+    args = parser.parse_args()
+
+    domino = os.path.abspath(args.domino)
+    programs = corpus_programs(args.corpus)
+    if not programs:
+        sys.exit("No programs found in " + " ".join(args.corpus))
+
+    # Read the baseline first, it may be the file we are about to overwrite
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    results = benchmark(domino, programs, args.runs)
+    results["runs"] = args.runs
+    print_pass_summary(results)
+    with open(args.output, "w") as f:
+        json.dump(results, f, indent=1, sort_keys=True)
+    print("\nresults written to " + args.output)
+
+    if baseline is not None:
+        flagged = regressions(baseline, results, args.threshold, args.min_ms)
+        for key, old, new in flagged:
+            if math.isinf(new):
+                print("REGRESSION %s: %.2f ms -> failed" % (key, old))
+            else:
+                print("REGRESSION %s: %.2f ms -> %.2f ms (+%.0f%%)" % (key, old, new, 100.0 * (new - old) / old))
+        if flagged:
+            sys.exit(1)
+        print("no regressions above %.0f%% against %s" % (args.threshold, args.baseline))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,32 +1,25 @@
 #ifndef COMPILER_PASS_H_
 #define COMPILER_PASS_H_
 
+#include <chrono>
 #include <string>
 #include <functional>
 #include <cstdio>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <iostream>
 //#include <experimental/tuple>
 #include <tuple>
 
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
-#include "clang/Basic/Diagnostic.h"
-#include "clang/Basic/FileManager.h"
-#include "clang/Basic/SourceManager.h"
-#include "clang/Basic/TargetOptions.h"
-#include "clang/Basic/TargetInfo.h"
-#include "clang/Frontend/CompilerInstance.h"
-#include "clang/Lex/Preprocessor.h"
-#include "clang/Parse/ParseAST.h"
-#include "llvm/Support/Host.h"
-#include "llvm/ADT/SmallString.h"
-
-#include "third_party/temp_file.hh"
+
 #include "third_party/assert_exception.h"
 
 #include "clang_utility_functions.h"
+#include "parse_session.h"
+#include "pass_profiler.h"
 
 
 
@@ -79,12 +72,19 @@ class SinglePass  : public CompilerPass {
        auto partial_fn = [tu_decl, this] (const Args... t_args) { return this->transformer_(tu_decl, t_args...); };
 
        // Now pack the args_ tuple object into a parameter pack (http://en.cppreference.com/w/cpp/experimental/apply)
+       const auto start = std::chrono::steady_clock::now();
        output_ = std::apply(partial_fn, args_); // experimental
+       transform_seconds_ = seconds_since(start);
      }
 
      /// Get previously stored output
      auto output() const { return output_; }
+
+     /// Time the last transform took, which is part of the time parse() took
+     double transform_seconds() const { return transform_seconds_; }
     private:
+     double transform_seconds_ = 0.0;
+
      /// Temporary holding area for output
      std::string  output_ = {};
 
@@ -96,69 +96,23 @@ class SinglePass  : public CompilerPass {
   };
   /// Instantiate MyASTConsumer using supplied transformer
   MyASTConsumer my_ast_consumer_;
-
-  /// SimpleDiag, TODO: Add FixIt hints and other goodies to make it comparable to gcc/clang
-  class  SimpleDiag : public clang::DiagnosticConsumer {
-    void HandleDiagnostic(clang::DiagnosticsEngine::Level DiagLevel __attribute__((unused)),
-                          const clang::Diagnostic & diagnostic) override {
-      llvm::SmallString<100> OutStr;
-      diagnostic.FormatDiagnostic(OutStr);
-      std::cout << "ERROR ERROR CLANG ERROR: " << std::string(OutStr.str()) << std::endl;
-      throw std::logic_error("Clang compiler error: " + std::string(OutStr.str()));
-    }
-  };
-  SimpleDiag simple_diag_ = {};
-
-  /// TempFile to hold string to be parsed
-  /// This is really a workaround for the fact that the
-  /// entry points into clang's libraries are files on disk
-  TempFile temp_file_;
 };
 
 template<typename... Args>
 SinglePass<Args...>::SinglePass(const Transformer<Args...> & t_transformer, const Args... t_args)
-    : my_ast_consumer_(t_transformer, t_args...),
-      temp_file_("tmp", ".c") {}
+    : my_ast_consumer_(t_transformer, t_args...) {}
 
 template<typename... Args>
 std::string SinglePass<Args...>::operator()(const std::string & string_to_parse) {
-  // Write string_to_parse into temp_file_
-  temp_file_.write(string_to_parse);
-
-  // clang::CompilerInstance will hold the instance of the Clang compiler for us,
-  // managing the various objects needed to run the compiler.
-  clang::CompilerInstance TheCompInst;
-  TheCompInst.getDiagnosticOpts().Warnings.emplace_back("all");
-  TheCompInst.createDiagnostics(& simple_diag_, false);
-  TheCompInst.getLangOpts().CPlusPlus = 0;
-  TheCompInst.getLangOpts().LineComment = 1;
-
-  // Initialize target info with the default triple for our platform.
-  auto TO = std::make_shared<clang::TargetOptions>();
-  TO->Triple = llvm::sys::getDefaultTargetTriple();
-  clang::TargetInfo *TI =
-  clang::TargetInfo::CreateTargetInfo(TheCompInst.getDiagnostics(), TO);
-  TheCompInst.setTarget(TI);
-
-  TheCompInst.createFileManager();
-  clang::FileManager &FileMgr = TheCompInst.getFileManager();
-  TheCompInst.createSourceManager(FileMgr);
-  clang::SourceManager &SourceMgr = TheCompInst.getSourceManager();
-  TheCompInst.createPreprocessor(clang::TU_Module);
-  TheCompInst.createASTContext();
-
-  // Set the main file handled by the source manager to the input file.
-  //const clang::FileEntry *FileIn = FileMgr.getFile(temp_file_.name().c_str());
-  const auto FileIn = FileMgr.getFile(temp_file_.name().c_str()).get();
-
-  SourceMgr.setMainFileID(
-      SourceMgr.createFileID(FileIn, clang::SourceLocation(), clang::SrcMgr::C_User));
-  TheCompInst.getDiagnosticClient().BeginSourceFile(
-      TheCompInst.getLangOpts(), &TheCompInst.getPreprocessor());
-
-  // Parse the file to AST, registering my_ast_consumer_ as the AST consumer.
-  ParseAST(TheCompInst.getPreprocessor(), &my_ast_consumer_,
-           TheCompInst.getASTContext());
+  // Parse on the warm, process-wide front end,
+  // registering my_ast_consumer_ as the AST consumer.
+  const auto start = std::chrono::steady_clock::now();
+  ParseSession::get().parse(string_to_parse, my_ast_consumer_);
+
+  if (auto * profiler = PassProfiler::active()) {
+    profiler->add_parse(seconds_since(start) - my_ast_consumer_.transform_seconds());
+    profiler->add_transform(my_ast_consumer_.transform_seconds());
+  }
 
   return my_ast_consumer_.output();
 }
@@ -171,23 +125,21 @@ class FixedPointPass : public CompilerPass {
   FixedPointPass(const ArgType & arg)
       : arg_(arg) {}
 
+  /// Give up after this many iterations: a pass that hasn't converged by then is looping
+  static constexpr int kMaxIterations = 1000;
+
   /// Execute FixedPointPass object
   std::string operator() (const std::string & string_to_parse) final override {
     std::string old_output = string_to_parse;
-    std::string new_output = "";
-    while (true) {
-      new_output = PassType(arg_)(old_output);
-      if (new_output == old_output) break;
-      else {
-
-        // std::cout << "FixedPointPass: old_output and new_output do not converge. " << std::endl;
-        // std::cout << " old_output: " << old_output << std::endl;
-        // std::cout << " new_output: " << new_output << std::endl;
-        // std::cout << " -------------------------------------------" << std::endl;
-      }
+    for (int i = 0; i < kMaxIterations; i++) {
+      const auto start = std::chrono::steady_clock::now();
+      const std::string new_output = PassType(arg_)(old_output);
+      if (auto * profiler = PassProfiler::active()) profiler->add_iteration(seconds_since(start));
+      if (new_output == old_output) return new_output;
       old_output = new_output;
     }
-    return new_output;
+    throw std::logic_error("FixedPointPass did not converge after " + std::to_string(kMaxIterations) +
+                           " iterations, last output:\n" + old_output);
   }
 
  private:
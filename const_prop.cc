@@ -13,13 +13,14 @@ using namespace clang;
 using std::placeholders::_1;
 using std::placeholders::_2;
 
-std::string const_prop_transform(const TranslationUnitDecl *tu_decl) {
-  return pkt_func_transform(tu_decl, const_prop_body);
+std::string const_prop_transform(const TranslationUnitDecl *tu_decl, Context &ctx) {
+  return pkt_func_transform(tu_decl, std::bind(const_prop_body, _1, _2, std::ref(ctx)));
 }
 
 std::pair<std::string, std::vector<std::string>>
 const_prop_body(const clang::CompoundStmt *function_body,
-                const std::string &pkt_name __attribute__((unused))) {
+                const std::string &pkt_name __attribute__((unused)),
+                Context &ctx) {
   std::string transformed_body = "";
 
   // Vector of newly created packet temporaries
@@ -79,7 +80,7 @@ const_prop_body(const clang::CompoundStmt *function_body,
 
     const auto p = lhs->getType().getAsString();
 
-    if (Context::GetContext().GetOptLevel(var_decl) == D_NO_OPT) continue; // do not replace.
+    if (ctx.GetOptLevel(var_decl) == D_NO_OPT) continue; // do not replace.
     // else, carry out replacement.
     if (const_vars.find(clang_stmt_printer(lhs)) == const_vars.end()) {
       transformed_body +=
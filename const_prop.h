@@ -7,15 +7,17 @@
 #include <map>
 #include "clang/AST/Expr.h"
 
+#include "context.h"
+
 
 /// Common subexpression identification (CSI) entry point
-std::string const_prop_transform(const clang::TranslationUnitDecl * tu_decl);
+std::string const_prop_transform(const clang::TranslationUnitDecl * tu_decl, Context & ctx);
 
 /// Main function for constant propagation that rewrites function body by
 /// identifying and eliminating variables whos RHSes are constants.
 /// This pass must be scheduled as a FixedPointPass, in order to iteratively
 /// eliminate any remaining constexprs.
-std::pair<std::string, std::vector<std::string>> const_prop_body(const clang::CompoundStmt * function_body, const std::string & pkt_name __attribute__((unused)));
+std::pair<std::string, std::vector<std::string>> const_prop_body(const clang::CompoundStmt * function_body, const std::string & pkt_name __attribute__((unused)), Context & ctx);
 
 
 #endif // CONST_PROP_H_
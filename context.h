@@ -1,13 +1,20 @@
 #ifndef TYPE_INFO_H_
 #define TYPE_INFO_H_
 
+#include <algorithm>
 #include <iostream>
 #include <map>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "third_party/assert_exception.h"
 
+#include "name_allocator.h"
+#include "symbol_table.h"
+
 enum DominoType { D_UNKNOWN, D_INT, D_BIT };
 
 enum DominoVarKind { D_VAR_UNKNOWN, D_PKT_FIELD, D_STATEFUL, D_TMP };
@@ -51,46 +58,68 @@ static std::string domino_opt_level_to_string(DominoOptLevels opt) {
 }
 
 /**
- * Singleton class that stores type info, etc.
+ * Type info, etc. for one compilation. Create one per program
+ * and hand it to every pass: nothing is shared between compilations,
+ * so several programs can be compiled at once.
+ * Variables are keyed by their Symbol in Symbols(), which passes
+ * can use to key their own tables the same way.
  */
 class Context {
 
 public:
-  static Context &GetContext() {
-    static Context c;
-    return c;
-  }
+  Context() {}
+  Context(Context const &) = delete;
+  void operator=(Context const &) = delete;
+
+  // Stream for diagnostics that passes print along the way,
+  // e.g., the rename maps. std::cerr unless redirected.
+  std::ostream &Log() { return *this->log; }
+
+  // Redirect Log(), e.g., to keep the output of concurrent programs apart.
+  void SetLog(std::ostream &out) { this->log = &out; }
+
+  // Interned names of this program's variables
+  SymbolTable &Symbols() { return this->symbols; }
+  const SymbolTable &Symbols() const { return this->symbols; }
+
+  // Allocator of fresh identifiers, shared by all passes over this program
+  NameAllocator &Names() { return this->names; }
 
   // Returns type information.
   DominoType GetType(const std::string &name) {
-    if (this->type_info[name] == D_UNKNOWN) {
-      std::cout << "Error: cannot find variable name " << name
-                << " in context.\n";
+    const auto type = this->type_info[this->symbols.intern(name)];
+    if (type == D_UNKNOWN) {
+      this->Log() << "Error: cannot find variable name " << name
+                  << " in context.\n";
       assert_exception(false);
     }
-    return this->type_info[name];
+    return type;
   }
 
   // Returns variable kind.
   DominoVarKind GetVarKind(const std::string &name) {
-    return this->var_kind[name];
+    return this->var_kind[this->symbols.intern(name)];
   }
 
   // Set variable type.
   void SetType(const std::string &name, DominoType ty) {
-    this->type_info[name] = ty;
+    this->type_info[this->symbols.intern(name)] = ty;
   }
 
   // Set variable kind.
   void SetVarKind(const std::string &name, DominoVarKind kind) {
-    this->var_kind[name] = kind;
+    this->var_kind[this->symbols.intern(name)] = kind;
   }
 
   const std::string &GetLastDerived(std::string &base) {
-    return this->last_derived[base];
+    return this->symbols.name(this->last_derived[this->symbols.intern(base)]);
   }
 
   const std::string &GetBase(const std::string &derivation) {
+    return this->symbols.name(GetBase(this->symbols.intern(derivation)));
+  }
+
+  Symbol GetBase(const Symbol derivation) {
     return this->base_derived[derivation];
   }
 
@@ -98,71 +127,149 @@ public:
   // If a variable is first added, set it to NO_OPT.
   // If it is a temporary, set it to OPT.
   void Derive(const std::string &base, const std::string &derivation) {
+    const auto base_symbol = this->symbols.intern(base);
+    const auto derivation_symbol = this->symbols.intern(derivation);
     // Previous last_der
-    this->opt_levels[this->last_derived[base]] = D_OPT;
-    this->last_derived[base] = derivation;
-    this->base_derived[derivation] = base;
-    this->opt_levels[this->last_derived[base]] = D_NO_OPT;
+    this->opt_levels[this->last_derived[base_symbol]] = D_OPT;
+    this->last_derived[base_symbol] = derivation_symbol;
+    this->base_derived[derivation_symbol] = base_symbol;
+    this->opt_levels[this->last_derived[base_symbol]] = D_NO_OPT;
   }
 
   DominoOptLevels GetOptLevel(const std::string &v) {
-    return this->opt_levels[v];
+    return GetOptLevel(this->symbols.intern(v));
   }
 
+  DominoOptLevels GetOptLevel(const Symbol v) { return this->opt_levels[v]; }
+
   void SetOptLevel(const std::string &v, DominoOptLevels o) {
-    this->opt_levels[v] = o;
+    this->opt_levels[this->symbols.intern(v)] = o;
   }
 
   void Print() {
-    for (const auto &p : this->type_info) {
-      std::cout << "typeof " << p.first << " : "
+    for (const auto &p : SortedByName(this->type_info)) {
+      std::cout << "typeof " << *p.first << " : "
                 << domino_type_to_string(p.second) << "\n";
     }
     std::cout << "------------------\n";
-    for (const auto &p : this->var_kind) {
-      std::cout << "varkind " << p.first << " : "
+    for (const auto &p : SortedByName(this->var_kind)) {
+      std::cout << "varkind " << *p.first << " : "
                 << domino_var_kind_to_string(p.second) << "\n";
     }
     std::cout << "------------------\n";
-    for (const auto &p : this->opt_levels)
-      std::cout << "opt_level " << p.first << " : "
+    for (const auto &p : SortedByName(this->opt_levels))
+      std::cout << "opt_level " << *p.first << " : "
                 << domino_opt_level_to_string(p.second) << "\n";
   }
 
   void PrintDerivations(const std::set<std::string> &vars) {
     for (const auto &var : vars) {
-      std::cout << this->base_derived[var] << " -> " << var << std::endl;
+      std::cout << GetBase(var) << " -> " << var << std::endl;
     }
   }
 
-  void PrintPktVars(std::string prefix = "") {
-    for (const auto & p : this->var_kind) {
+  void PrintPktVars(std::ostream &out, std::string prefix = "") {
+    for (const auto &p : SortedByName(this->var_kind)) {
       auto kind = p.second;
-      auto opt_level = this->opt_levels[p.first];
+      auto opt_level = GetOptLevel(*p.first);
       if (kind == D_PKT_FIELD && opt_level == D_NO_OPT) {
-        std::cout << prefix << p.first << std::endl;
+        out << prefix << *p.first << std::endl;
       }
     }
   }
 
-  // Mark constructors as singleton
+  // Everything recorded so far as sorted "<table>\t<name>\t<value>" lines,
+  // e.g., to hash this Context or to diff it against an earlier one.
+  // That includes the state of Names(), since what a pass allocates
+  // depends on the names taken before it, not just on its input program.
+  std::vector<std::string> Entries() const {
+    std::vector<std::string> entries;
+    const auto name = [this](const Symbol symbol) { return this->symbols.name(symbol); };
+    for (const auto &p : this->type_info)
+      entries.emplace_back("t\t" + name(p.first) + "\t" + std::to_string(p.second));
+    for (const auto &p : this->var_kind)
+      entries.emplace_back("k\t" + name(p.first) + "\t" + std::to_string(p.second));
+    for (const auto &p : this->last_derived)
+      entries.emplace_back("l\t" + name(p.first) + "\t" + name(p.second));
+    for (const auto &p : this->base_derived)
+      entries.emplace_back("b\t" + name(p.first) + "\t" + name(p.second));
+    for (const auto &p : this->opt_levels)
+      entries.emplace_back("o\t" + name(p.first) + "\t" + std::to_string(p.second));
+    for (const auto &taken : this->names.taken_names())
+      entries.emplace_back("n\t" + taken + "\t");
+    for (const auto &p : this->names.next_suffixes())
+      entries.emplace_back("s\t" + p.first + "\t" + std::to_string(p.second));
+    std::sort(entries.begin(), entries.end());
+    return entries;
+  }
 
-  //  Context(Context const&)               = delete;
-  //  void operator=(Context const&)        = delete;
+  // Record lines produced by Entries(), overwriting existing values.
+  // Passes only ever add or overwrite entries, so applying the lines
+  // a pass added to the Context it started from reproduces its effect.
+  void Apply(const std::vector<std::string> &entries) {
+    for (const auto &entry : entries) {
+      const auto tab = entry.find('\t', 2);
+      assert_exception(entry.size() >= 2 and entry.at(1) == '\t' and tab != std::string::npos);
+      const auto key = entry.substr(2, tab - 2);
+      const auto value = entry.substr(tab + 1);
+      if (entry.at(0) == 'n') {
+        this->names.reserve(key);
+        continue;
+      } else if (entry.at(0) == 's') {
+        // A prefix, not a variable, so it isn't interned
+        this->names.set_next_suffix(key, std::stoull(value));
+        continue;
+      }
+      const auto name = this->symbols.intern(key);
+      switch (entry.at(0)) {
+      case 't':
+        this->type_info[name] = static_cast<DominoType>(std::stoi(value));
+        break;
+      case 'k':
+        this->var_kind[name] = static_cast<DominoVarKind>(std::stoi(value));
+        break;
+      case 'l':
+        this->last_derived[name] = this->symbols.intern(value);
+        break;
+      case 'b':
+        this->base_derived[name] = this->symbols.intern(value);
+        break;
+      case 'o':
+        this->opt_levels[name] = static_cast<DominoOptLevels>(std::stoi(value));
+        break;
+      default:
+        assert_exception(false);
+      }
+    }
+  }
 
 private:
-  // Non-C++11 semantics
-  Context() {}
-  Context(Context const &);        // Don't Implement
-  void operator=(Context const &); // Don't implement
+  // Entries of table as (name, value) pairs, sorted by name,
+  // which is the order in which they are printed
+  template <class T>
+  std::vector<std::pair<const std::string *, T>>
+  SortedByName(const std::unordered_map<Symbol, T> &table) const {
+    std::vector<std::pair<const std::string *, T>> ret;
+    ret.reserve(table.size());
+    for (const auto &p : table)
+      ret.emplace_back(&this->symbols.name(p.first), p.second);
+    std::sort(ret.begin(), ret.end(),
+              [](const auto &a, const auto &b) { return *a.first < *b.first; });
+    return ret;
+  }
+
+  SymbolTable symbols;
+  NameAllocator names{symbols};
+
+  std::unordered_map<Symbol, DominoType> type_info;
+  std::unordered_map<Symbol, DominoVarKind> var_kind;
 
-  std::map<std::string, DominoType> type_info;
-  std::map<std::string, DominoVarKind> var_kind;
+  std::unordered_map<Symbol, Symbol> last_derived;
+  std::unordered_map<Symbol, Symbol> base_derived;
 
-  std::map<std::string, std::string> last_derived;
-  std::map<std::string, std::string> base_derived;
+  std::unordered_map<Symbol, DominoOptLevels> opt_levels;
 
-  std::map<std::string, DominoOptLevels> opt_levels;
+  std::ostream *log = &std::cerr;
 };
 
 #endif
\ No newline at end of file
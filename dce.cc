@@ -13,13 +13,14 @@ using namespace clang;
 using std::placeholders::_1;
 using std::placeholders::_2;
 
-std::string dce_transform(const TranslationUnitDecl *tu_decl) {
-  return pkt_func_transform(tu_decl, dce_body);
+std::string dce_transform(const TranslationUnitDecl *tu_decl, Context &ctx) {
+  return pkt_func_transform(tu_decl, std::bind(dce_body, _1, _2, std::ref(ctx)));
 }
 
 std::pair<std::string, std::vector<std::string>>
 dce_body(const clang::CompoundStmt *function_body,
-         const std::string &pkt_name __attribute__((unused))) {
+         const std::string &pkt_name __attribute__((unused)),
+         Context &ctx) {
   std::string transformed_body = "";
 
   // Vector of newly created packet temporaries
@@ -78,7 +79,7 @@ dce_body(const clang::CompoundStmt *function_body,
     else assert_exception(false); // will not happen.
     // If current assignment stmt is not dead code, or marked as NO_OPT, then
     // add it to the transformed body. Else, ignore it.
-    if (emptyDefines.find(lhsStr) == emptyDefines.end() || Context::GetContext().GetOptLevel(lhsDeclStr) == D_NO_OPT) {
+    if (emptyDefines.find(lhsStr) == emptyDefines.end() || ctx.GetOptLevel(lhsDeclStr) == D_NO_OPT) {
       transformed_body += clang_stmt_printer(child) + ";";
     }
     //  else
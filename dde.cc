@@ -7,6 +7,7 @@
 
 #include "third_party/assert_exception.h"
 
+#include "ast_printer.h"
 #include "clang_utility_functions.h"
 #include "context.h"
 #include "pkt_func_transform.h"
@@ -16,7 +17,7 @@ using namespace clang;
 using std::placeholders::_1;
 using std::placeholders::_2;
 
-std::string dde_transform(const TranslationUnitDecl *tu_decl) {
+std::string dde_transform(const TranslationUnitDecl *tu_decl, Context &ctx) {
   // Accumulate all decls
   std::vector<const Decl *> all_decls;
   for (const auto *decl : dyn_cast<DeclContext>(tu_decl)->decls())
@@ -34,16 +35,11 @@ std::string dde_transform(const TranslationUnitDecl *tu_decl) {
                                      // all functions in a TU.
   std::set<std::string> usedStateVars; // set of all used state var names within
                                        // all functions in a TU.
-  const VariableTypeSelector pktVarSelector = {
-      {VariableType::FUNCTION_PARAMETER, false},
-      {VariableType::PACKET, true},
-      {VariableType::STATE_ARRAY, false},
-      {VariableType::STATE_SCALAR, false}};
-  const VariableTypeSelector stateVarSelector = {
-      {VariableType::FUNCTION_PARAMETER, false},
-      {VariableType::PACKET, false},
-      {VariableType::STATE_SCALAR, true},
-      {VariableType::STATE_ARRAY, false}};
+  // Packet and state variables of every function, collected in one walk
+  AstPrinter local_printer;
+  auto &printer =
+      AstPrinter::active() != nullptr ? *AstPrinter::active() : local_printer;
+  VarUses uses;
 
   std::string global_pkt_name = "";
 
@@ -58,10 +54,16 @@ std::string dde_transform(const TranslationUnitDecl *tu_decl) {
       else
         assert_exception(global_pkt_name == pkt_name);
 
-      std::set<std::string> pktVars = gen_var_list(fbody, pktVarSelector);
-      std::set<std::string> stateVars = gen_var_list(fbody, stateVarSelector);
-      usedPktVars.insert(pktVars.begin(), pktVars.end());
-      usedStateVars.insert(stateVars.begin(), stateVars.end());
+      // One walk for both packet and state variables. Array accesses count
+      // as their index, which is a packet field.
+      uses.clear();
+      collect_var_uses(fbody, printer, uses);
+      for (const auto symbol : uses.packet)
+        usedPktVars.emplace(printer.symbols().name(symbol));
+      for (const auto symbol : uses.array_index)
+        usedPktVars.emplace(printer.symbols().name(symbol));
+      for (const auto symbol : uses.state_scalar)
+        usedStateVars.emplace(printer.symbols().name(symbol));
     }
   }
 
@@ -116,7 +118,7 @@ std::string dde_transform(const TranslationUnitDecl *tu_decl) {
         // include it in the final printout. Otherwise, it is dead, so we
         // discard it.
         if (usedPktVars.find(global_pkt_name + "." + field_str) != usedPktVars.end() ||
-            Context::GetContext().GetOptLevel(field_str) == D_NO_OPT) {
+            ctx.GetOptLevel(field_str) == D_NO_OPT) {
           record_decl_str +=
               dyn_cast<ValueDecl>(field_decl)->getType().getAsString() + " " +
               clang_value_decl_printer(dyn_cast<ValueDecl>(field_decl)) + ";";
@@ -7,10 +7,12 @@
 #include <map>
 #include "clang/AST/Expr.h"
 
+#include "context.h"
+
 
 /// Dead Declarations Elimination: Eliminate unused packet variables
 /// as well as state variables in a translation unit.
-std::string dde_transform(const clang::TranslationUnitDecl * tu_decl);
+std::string dde_transform(const clang::TranslationUnitDecl * tu_decl, Context & ctx);
 
 
 #endif // DCE_H_
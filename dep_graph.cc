@@ -0,0 +1,184 @@
+#include "dep_graph.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "third_party/assert_exception.h"
+
+namespace {
+
+/// Declared variable of a declaration line such as "int p_x;" or "bit p_b;",
+/// or the empty string if line is something else
+std::string declared_variable(const std::string & line) {
+  if (line.size() < 6 or line.back() != ';') return "";
+  if (line.compare(0, 4, "int ") != 0 and line.compare(0, 4, "bit ") != 0) return "";
+  return line.substr(4, line.size() - 5);
+}
+
+/// Declared variables read by the right hand side of statement, in order,
+/// possibly repeated. Identifiers that aren't declared variables,
+/// e.g., names of scalar functions, are skipped.
+std::vector<std::string> variables_read(const std::string & rhs, const std::set<std::string> & variables) {
+  std::vector<std::string> ret;
+  for (size_t i = 0; i < rhs.size();) {
+    if (std::isalnum(static_cast<unsigned char>(rhs.at(i))) or rhs.at(i) == '_') {
+      size_t end = i;
+      while (end < rhs.size() and (std::isalnum(static_cast<unsigned char>(rhs.at(end))) or rhs.at(end) == '_')) end++;
+      // Tokens starting with a digit are literals such as 10 or 0x1f
+      const auto token = rhs.substr(i, end - i);
+      if (not std::isdigit(static_cast<unsigned char>(token.front())) and variables.count(token) != 0)
+        ret.emplace_back(token);
+      i = end;
+    } else {
+      i++;
+    }
+  }
+  return ret;
+}
+
+/// Open file for writing, throwing if that's not possible
+std::ofstream open_for_writing(const std::string & file_name) {
+  std::ofstream out(file_name);
+  if (not out.good()) throw std::logic_error("Cannot write to " + file_name);
+  return out;
+}
+
+}  // namespace
+
+FinalProgram parse_final_program(const std::string & program) {
+  FinalProgram ret;
+  std::istringstream in(program);
+  std::string line;
+  bool in_declarations = true;
+  bool in_state_vars = false;
+  bool in_pkt_vars = false;
+  while (std::getline(in, line)) {
+    if (line.empty()) continue;
+    if (not in_declarations) {
+      ret.statements.emplace_back(line);
+    } else if (line == "# declarations end") {
+      in_declarations = false;
+    } else if (line == "# state variables start") {
+      in_state_vars = true;
+    } else if (line == "# state variables end") {
+      in_state_vars = false;
+    } else if (line == "# packet vars start") {
+      in_pkt_vars = true;
+    } else if (in_pkt_vars) {
+      // Packet fields that must not be optimized away, one name per line
+      ret.variables.emplace(line);
+    } else {
+      const auto variable = declared_variable(line);
+      if (variable.empty()) throw std::logic_error("Unexpected declaration \"" + line + "\" in preprocessed program\n");
+      ret.variables.emplace(variable);
+      if (in_state_vars) ret.state_vars.emplace(variable);
+    }
+  }
+  if (in_declarations)
+    throw std::logic_error("Dependency graphs need the output of rename_pkt_fields, "
+                           "which ends its declarations with \"# declarations end\"\n");
+  return ret;
+}
+
+Graph<uint32_t> dependency_graph(const FinalProgram & program) {
+  // The printer outlives this call, e.g., in the graph's condensation
+  const auto statements = std::make_shared<const std::vector<std::string>>(program.statements);
+  Graph<uint32_t> dep_graph([statements](const uint32_t & id) { return statements->at(id); });
+  for (uint32_t i = 0; i < program.statements.size(); i++) dep_graph.add_node(i);
+
+  // Last statement to write each variable, and the statements that read it since
+  std::unordered_map<std::string, uint32_t> last_writer;
+  std::unordered_map<std::string, std::vector<uint32_t>> readers;
+  std::vector<Graph<uint32_t>::IdEdge> edges;
+  for (uint32_t i = 0; i < program.statements.size(); i++) {
+    const auto & stmt = program.statements.at(i);
+    const auto assign = stmt.find(" = ");
+    if (assign == std::string::npos or stmt.back() != ';')
+      throw std::logic_error("Expected an assignment, got \"" + stmt + "\"\n");
+    const auto lhs = stmt.substr(0, assign);
+    if (program.variables.count(lhs) == 0)
+      throw std::logic_error("Assignment to undeclared variable " + lhs + " in \"" + stmt + "\"\n");
+
+    // Read after write
+    for (const auto & var : variables_read(stmt.substr(assign + 3), program.variables)) {
+      const auto writer = last_writer.find(var);
+      if (writer != last_writer.end()) edges.emplace_back(writer->second, i);
+      readers[var].emplace_back(i);
+    }
+
+    // Write after read and write after write. A write to a state variable
+    // also closes the cycle through the statements that read its old value.
+    for (const auto reader : readers[lhs]) {
+      if (reader == i) continue;
+      edges.emplace_back(reader, i);
+      if (program.state_vars.count(lhs) != 0) edges.emplace_back(i, reader);
+    }
+    const auto writer = last_writer.find(lhs);
+    if (writer != last_writer.end()) edges.emplace_back(writer->second, i);
+    last_writer[lhs] = i;
+    readers[lhs].clear();
+  }
+  dep_graph.add_edges_by_id(edges);
+  return dep_graph;
+}
+
+void print_adjacency(std::ostream & out, const Graph<uint32_t> & dep_graph,
+                     const FinalProgram & program) {
+  assert_exception(dep_graph.num_nodes() == program.statements.size());
+  out << "# dependency graph: statement i is node i\n";
+  out << "statements " << program.statements.size() << "\n";
+  for (const auto & stmt : program.statements) out << stmt << "\n";
+  out << "edges " << dep_graph.num_edges() << "\n";
+  for (uint32_t i = 0; i < dep_graph.num_nodes(); i++)
+    for (const auto neighbor : dep_graph.succ(i)) out << i << " " << neighbor << "\n";
+}
+
+void print_adjacency(std::ostream & out, const Graph<std::vector<uint32_t>> & dag) {
+  out << "# condensed dependency graph: component i is node i, listing its statement IDs\n";
+  out << "components " << dag.num_nodes() << "\n";
+  for (const auto & component : dag.nodes()) {
+    for (size_t j = 0; j < component.size(); j++) out << (j == 0 ? "" : " ") << component.at(j);
+    out << "\n";
+  }
+  out << "edges " << dag.num_edges() << "\n";
+  for (uint32_t i = 0; i < dag.num_nodes(); i++)
+    for (const auto neighbor : dag.succ(i)) out << i << " " << neighbor << "\n";
+}
+
+std::vector<Operation> component_operations(const Graph<std::vector<uint32_t>> & dag,
+                                            const FinalProgram & program) {
+  std::vector<Operation> ops;
+  ops.reserve(dag.num_nodes());
+  for (const auto & component : dag.nodes()) {
+    const bool stateful = std::any_of(component.begin(), component.end(), [&program](const uint32_t id) {
+      const auto & stmt = program.statements.at(id);
+      return program.state_vars.count(stmt.substr(0, stmt.find(" = "))) != 0;
+    });
+    ops.emplace_back(Operation{1, stateful ? AluKind::STATEFUL : AluKind::STATELESS});
+  }
+  return ops;
+}
+
+void write_dependency_graphs(const std::string & program, const std::string & prefix,
+                             const PipelineModel & model) {
+  const auto final_program = parse_final_program(program);
+  const auto dep_graph = dependency_graph(final_program);
+  // Statements within a component in program order
+  const auto dag = dep_graph.condensation(std::less<uint32_t>());
+
+  auto dep_dot = open_for_writing(prefix + "_dep");
+  dep_dot << dep_graph << std::endl;
+  auto dag_dot = open_for_writing(prefix + "_dag");
+  dag_dot << dag << std::endl;
+  auto dep_adj = open_for_writing(prefix + "_dep.adj");
+  print_adjacency(dep_adj, dep_graph, final_program);
+  auto dag_adj = open_for_writing(prefix + "_dag.adj");
+  print_adjacency(dag_adj, dag);
+  auto schedule_out = open_for_writing(prefix + "_schedule");
+  print_schedule(schedule_out, dag, list_schedule(dag, component_operations(dag, final_program), model), model);
+}
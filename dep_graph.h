@@ -0,0 +1,70 @@
+#ifndef DEP_GRAPH_H_
+#define DEP_GRAPH_H_
+
+#include <cstdint>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "graph.h"
+#include "scheduler.h"
+
+/// Dependency analysis of the program rename_pkt_fields hands over to CaT,
+/// so that CaT doesn't have to redo it: which statements have to run after
+/// which, and which of them form the read-modify-write of a state variable
+/// and hence have to run together on one stateful ALU.
+
+/// The parts of a preprocessed program that dependency analysis needs
+struct FinalProgram {
+  /// Statements after "# declarations end", in program order.
+  /// Statement i is node i of the dependency graph.
+  std::vector<std::string> statements = {};
+
+  /// Every declared variable, and the state variables among them
+  std::set<std::string> variables = {};
+  std::set<std::string> state_vars = {};
+};
+
+/// Split the output of rename_pkt_fields into declarations and statements,
+/// throwing if it doesn't look like that output
+FinalProgram parse_final_program(const std::string & program);
+
+/// Dependency graph over the statements of program, in O(V + E):
+/// an edge from statement a to a later statement b if b reads what a wrote
+/// (read after write), writes what a read (write after read), or writes what
+/// a wrote (write after write), plus an edge from the write of every state
+/// variable back to the statements that read it before, which puts the whole
+/// read-modify-write into one strongly connected component.
+/// Node i of the graph is statement i, printed as its text.
+Graph<uint32_t> dependency_graph(const FinalProgram & program);
+
+/// Print a dependency graph in a compact form, with no statement
+/// text repeated: the statements, one per line, in the order of their IDs,
+/// then one "from to" line per edge
+void print_adjacency(std::ostream & out, const Graph<uint32_t> & dep_graph,
+                     const FinalProgram & program);
+
+/// Print the condensation of a dependency graph in the same compact form:
+/// for every component, in topological order, the IDs of its statements
+/// on one line, then one "from to" line per edge between components
+void print_adjacency(std::ostream & out, const Graph<std::vector<uint32_t>> & dag);
+
+/// Pipeline that --dep-graphs schedules programs onto unless --pipeline says otherwise
+const PipelineModel kDefaultPipelineModel = {12, 16, 4};
+
+/// Operation of every component of the condensation of program's dependency
+/// graph, by ID: a component that writes a state variable is one
+/// read-modify-write on a stateful ALU, anything else a stateless ALU,
+/// and either takes one stage
+std::vector<Operation> component_operations(const Graph<std::vector<uint32_t>> & dag,
+                                            const FinalProgram & program);
+
+/// Write the dependency graph of program and its condensation as Graphviz
+/// files prefix_dep and prefix_dag, and in the compact form above as
+/// prefix_dep.adj and prefix_dag.adj, and the list schedule of the
+/// condensation on model (see print_schedule) as prefix_schedule
+void write_dependency_graphs(const std::string & program, const std::string & prefix,
+                             const PipelineModel & model = kDefaultPipelineModel);
+
+#endif  // DEP_GRAPH_H_
@@ -26,19 +26,35 @@
 #include "validator.h"
 #include "flow_based_ite_simplifier.h"
 
+#include <cctype>
 #include <csignal>
 
 #include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <numeric>
 #include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include "third_party/assert_exception.h"
 
+#include "batch_runner.h"
 #include "compiler_pass.h"
+#include "dep_graph.h"
+#include "domino_server.h"
+#include "ir_analysis.h"
+#include "ir_egraph.h"
+#include "ir_pass.h"
+#include "ir_rules.h"
+#include "ir_transforms.h"
+#include "parse_session.h"
+#include "pass_cache.h"
+#include "pass_profiler.h"
 #include "pkt_func_transform.h"
 #include "util.h"
 
@@ -54,9 +70,9 @@ using std::placeholders::_2;
 
 // Convenience typedefs
 typedef std::string PassName;
-typedef std::function<std::unique_ptr<CompilerPass>(void)> PassFunctor;
+typedef std::function<std::unique_ptr<CompilerPass>(Context &)> PassFunctor;
 typedef std::map<PassName, PassFunctor> PassFactory;
-typedef std::vector<PassFunctor> PassFunctorVector;
+typedef std::map<PassName, IrTransformer> IrPassFactory;
 
 // Both SinglePass and Transformer take a parameter pack as template
 // arguments to allow additional arguments to the function carrying out
@@ -73,28 +89,34 @@ typedef SinglePass<> DefaultSinglePass;
 // Map to store factory for all passes
 static PassFactory all_passes;
 
+// Passes that also have an implementation on the Domino IR.
+// These are preferred over their counterparts in all_passes.
+static IrPassFactory all_ir_passes;
+
 void populate_passes() {
   // We need to explicitly call populate_passes instead of using an initializer
   // list to populate PassMap all_passes because initializer lists don't play
   // well with move-only types like unique_ptrs
   // (http://stackoverflow.com/questions/9618268/initializing-container-of-unique-ptrs-from-initializer-list-fails-with-gcc-4-7)
-  all_passes["initial_pass"] = []() {
-    return std::make_unique<DefaultSinglePass>(initial_pass_transform);
+  all_passes["initial_pass"] = [](Context &ctx) {
+    return std::make_unique<DefaultSinglePass>(
+        std::bind(initial_pass_transform, _1, std::ref(ctx)));
   };
-  all_passes["create_branch_var"] = []() {
-    return std::make_unique<DefaultSinglePass>(branch_var_creator_transform);
+  all_passes["create_branch_var"] = [](Context &ctx) {
+    return std::make_unique<DefaultSinglePass>(
+        std::bind(branch_var_creator_transform, _1, std::ref(ctx)));
   };
-  all_passes["array_replacer"] = []() {
+  all_passes["array_replacer"] = [](Context &) {
     return std::make_unique<DefaultSinglePass>(array_replacer_transform);
   };
-  all_passes["paren_remover"] = []() {
+  all_passes["paren_remover"] = [](Context &) {
     return std::make_unique<DefaultSinglePass>(paren_remover_transform);
   };
-  all_passes["elim_identical_lhs_rhs"] = []() {
+  all_passes["elim_identical_lhs_rhs"] = [](Context &) {
     return std::make_unique<DefaultSinglePass>(
         elim_identical_lhs_rhs_transform);
   };
-  all_passes["cse"] = []() {
+  all_passes["cse"] = [](Context &) {
     return std::make_unique<
         FixedPointPass<CompoundPass, std::vector<DefaultTransformer>>>(
         std::vector<DefaultTransformer>(
@@ -102,82 +124,158 @@ void populate_passes() {
                        AlgebraicSimplifier(), _1),
              csi_transform, cse_transform /*, dce_transform*/}));
   };
-  all_passes["redundancy_remover"] = []() {
+  all_passes["redundancy_remover"] = [](Context &) {
     return std::make_unique<
         FixedPointPass<DefaultSinglePass, DefaultTransformer>>(
         redundancy_remover_transform);
   };
-  all_passes["array_validator"] = []() {
+  all_passes["array_validator"] = [](Context &) {
     return std::make_unique<DefaultSinglePass>(
         std::bind(&ArrayValidator::ast_visit_transform, ArrayValidator(), _1));
   };
-  all_passes["validator"] = []() {
+  all_passes["validator"] = [](Context &) {
     return std::make_unique<DefaultSinglePass>(
         std::bind(&Validator::ast_visit_transform, Validator(), _1));
   };
-  all_passes["int_type_checker"] = []() {
+  all_passes["int_type_checker"] = [](Context &) {
     return std::make_unique<DefaultSinglePass>(
         std::bind(&IntTypeChecker::ast_visit_transform, IntTypeChecker(), _1));
   };
-  all_passes["desugar_comp_asgn"] = []() {
+  all_passes["desugar_comp_asgn"] = [](Context &) {
     return std::make_unique<DefaultSinglePass>(
         std::bind(&DesugarCompAssignment::ast_visit_transform,
                   DesugarCompAssignment(), _1));
   };
-  all_passes["if_converter"] = []() {
+  all_passes["if_converter"] = [](Context &ctx) {
     return std::make_unique<DefaultSinglePass>(
-        std::bind(&IfConversionHandler::transform, IfConversionHandler(), _1));
+        std::bind(&IfConversionHandler::transform, IfConversionHandler(ctx), _1));
   };
-  all_passes["algebra_simplify"] = []() {
+  all_passes["algebra_simplify"] = [](Context &) {
     return std::make_unique<
         FixedPointPass<DefaultSinglePass, DefaultTransformer>>(std::bind(
         &AlgebraicSimplifier::ast_visit_transform, AlgebraicSimplifier(), _1));
   };
-  all_passes["bool_to_int"] = []() {
+  all_passes["bool_to_int"] = [](Context &) {
     return std::make_unique<DefaultSinglePass>(
         std::bind(&BoolToInt::ast_visit_transform, BoolToInt(), _1));
   };
-  all_passes["expr_flattener"] = []() {
+  all_passes["expr_flattener"] = [](Context &ctx) {
     return std::make_unique<
         FixedPointPass<DefaultSinglePass, DefaultTransformer>>(std::bind(
-        &ExprFlattenerHandler::transform, ExprFlattenerHandler(), _1));
+        &ExprFlattenerHandler::transform, ExprFlattenerHandler(ctx), _1));
   };
-  all_passes["expr_propagater"] = []() {
+  all_passes["expr_propagater"] = [](Context &) {
     return std::make_unique<DefaultSinglePass>(expr_prop_transform);
   };
-  all_passes["stateful_flanks"] = []() {
-    return std::make_unique<DefaultSinglePass>(stateful_flank_transform);
+  all_passes["stateful_flanks"] = [](Context &ctx) {
+    return std::make_unique<DefaultSinglePass>(
+        std::bind(stateful_flank_transform, _1, std::ref(ctx)));
   };
-  all_passes["ssa"] = []() {
-    return std::make_unique<DefaultSinglePass>(ssa_transform);
+  all_passes["ssa"] = [](Context &ctx) {
+    return std::make_unique<DefaultSinglePass>(
+        std::bind(ssa_transform, _1, std::ref(ctx)));
   };
-  all_passes["echo"] = []() {
+  all_passes["echo"] = [](Context &) {
     return std::make_unique<DefaultSinglePass>(clang_decl_printer);
   };
-  all_passes["gen_used_fields"] = []() {
+  all_passes["gen_used_fields"] = [](Context &) {
     return std::make_unique<DefaultSinglePass>(gen_used_field_transform);
   };
-  all_passes["const_prop"] = []() {
+  all_passes["const_prop"] = [](Context &ctx) {
     return std::make_unique<
         FixedPointPass<CompoundPass, std::vector<DefaultTransformer>>>(
         std::vector<DefaultTransformer>(
             {std::bind(&AlgebraicSimplifier::ast_visit_transform,
                        AlgebraicSimplifier(), _1),
-             const_prop_transform}));
+             std::bind(const_prop_transform, _1, std::ref(ctx))}));
   };
-  all_passes["dce"] = []() {
+  all_passes["dce"] = [](Context &ctx) {
     return std::make_unique<
-        FixedPointPass<DefaultSinglePass, DefaultTransformer>>(dce_transform);
+        FixedPointPass<DefaultSinglePass, DefaultTransformer>>(
+        std::bind(dce_transform, _1, std::ref(ctx)));
   };
-  all_passes["dde"] = []() {
-    return std::make_unique<DefaultSinglePass>(dde_transform);
+  all_passes["dde"] = [](Context &ctx) {
+    return std::make_unique<DefaultSinglePass>(
+        std::bind(dde_transform, _1, std::ref(ctx)));
   };
-  all_passes["rename_pkt_fields"] = []() {
-    return std::make_unique<DefaultSinglePass>(rename_pkt_fields_transform);
+  all_passes["rename_pkt_fields"] = [](Context &ctx) {
+    return std::make_unique<DefaultSinglePass>(
+        std::bind(rename_pkt_fields_transform, _1, std::ref(ctx)));
   };
-  all_passes["flow_ite_simplify"] = []() {
-    return std::make_unique<DefaultSinglePass>(flow_based_ite_simplify_transform);
+  all_passes["flow_ite_simplify"] = [](Context &ctx) {
+    return std::make_unique<DefaultSinglePass>(
+        std::bind(flow_based_ite_simplify_transform, _1, std::ref(ctx)));
   };
+
+  // Every IR pass declares what it requires of its input and which
+  // analyses (ir_analysis.h) stay valid when it changes the program
+  using A = IrAnalysis;
+  all_ir_passes["stateful_flanks"] = ir_pass("stateful_flanks", ir_stateful_flanks_transform, {}, {});
+  all_ir_passes["algebra_simplify"] = ir_pass("algebra_simplify", ir_algebra_simplify_transform, {}, {A::SSA, A::CENSUS});
+  all_ir_passes["egraph"] = ir_pass("egraph", ir_egraph_transform, {}, {A::SSA, A::CENSUS});
+  all_ir_passes["elim_identical_lhs_rhs"] = ir_pass("elim_identical_lhs_rhs", ir_elim_identical_lhs_rhs_transform,
+                                                    {}, {A::SSA, A::FLAT, A::CENSUS});
+  all_ir_passes["ssa"] = ir_pass("ssa", ir_ssa_transform, {}, {});
+  all_ir_passes["expr_propagater"] = ir_pass("expr_propagater", ir_expr_prop_transform, {A::SSA}, {A::SSA, A::CENSUS});
+  all_ir_passes["paren_remover"] = ir_pass("paren_remover", ir_paren_remover_transform, {}, {A::SSA, A::CENSUS});
+  all_ir_passes["create_branch_var"] = ir_pass("create_branch_var", ir_branch_var_creator_transform, {}, {A::SSA});
+  all_ir_passes["dce"] = ir_pass("dce", ir_dce_transform, {A::SSA}, {A::SSA, A::FLAT, A::CENSUS});
+  all_ir_passes["dde"] = ir_pass("dde", ir_dde_transform, {}, {A::SSA, A::FLAT, A::DEF_USE});
+  all_ir_passes["flow_ite_simplify"] = ir_pass("flow_ite_simplify", ir_flow_ite_simplify_transform,
+                                               {A::SSA}, {A::SSA, A::CENSUS});
+  all_ir_passes["rename_pkt_fields"] = ir_pass("rename_pkt_fields", ir_rename_pkt_fields_transform,
+                                               {A::SSA}, {A::SSA, A::FLAT, A::CENSUS, A::DEF_USE});
+  all_ir_passes["expr_flattener"] = ir_fixed_point(ir_pass("expr_flattener", ir_expr_flattener_transform, {}, {A::SSA}),
+                                                   "expr_flattener");
+  const auto algebra_simplify = all_ir_passes.at("algebra_simplify");
+  all_ir_passes["const_prop"] = ir_fixed_point(ir_sequence({algebra_simplify,
+                                                            ir_pass("const_prop", ir_const_prop_transform,
+                                                                    {A::SSA}, {A::SSA, A::CENSUS})}),
+                                               "const_prop");
+  all_ir_passes["canonicalize"] = ir_pass("canonicalize", ir_canonicalize_transform,
+                                          {}, {A::SSA, A::FLAT, A::CENSUS});
+  all_ir_passes["cse"] = ir_fixed_point(ir_sequence({algebra_simplify,
+                                                     all_ir_passes.at("canonicalize"),
+                                                     ir_pass("gvn", ir_gvn_transform, {A::SSA}, {A::CENSUS}),
+                                                     ir_pass("cse", ir_cse_transform, {}, {A::CENSUS})}),
+                                        "cse");
+}
+
+/// Register the rules in file_name (ir_rules.h) as the IR pass "rules",
+/// returning their text, which keys the cache along with the binary
+std::string load_rules(const std::string &file_name) {
+  const auto text = file_to_str(file_name);
+  const auto rules = std::make_shared<const IrRuleSet>(text, file_name);
+  all_ir_passes["rules"] = ir_pass("rules",
+                                   [rules](IrProgram &program, Context &ctx) {
+                                     return ir_rules_transform(*rules, program, ctx);
+                                   },
+                                   {}, {IrAnalysis::SSA});
+  return text;
+}
+
+/// pass_list with the rules pass after every algebra_simplify, if rules are
+/// loaded and pass_list doesn't say where they run already
+std::vector<std::string> with_rules(const std::vector<std::string> &pass_list) {
+  if (all_ir_passes.find("rules") == all_ir_passes.end() or
+      std::find(pass_list.begin(), pass_list.end(), "rules") != pass_list.end())
+    return pass_list;
+  std::vector<std::string> ret;
+  for (const auto &pass_name : pass_list) {
+    ret.emplace_back(pass_name);
+    if (pass_name == "algebra_simplify") ret.emplace_back("rules");
+  }
+  return ret;
+}
+
+/// Pipeline model of --pipeline STAGES,STATELESS,STATEFUL, e.g., 12,16,4
+PipelineModel parse_pipeline_model(const std::string &spec) {
+  const auto fields = split(spec, ",");
+  if (fields.size() != 3 or fields.at(0).empty() or
+      std::any_of(spec.begin(), spec.end(), [](const char c) { return c != ',' and not std::isdigit(static_cast<unsigned char>(c)); }))
+    throw std::logic_error("--pipeline expects STAGES,STATELESS,STATEFUL, got " + spec);
+  return {static_cast<uint32_t>(std::stoul(fields.at(0))), static_cast<uint32_t>(std::stoul(fields.at(1))),
+          static_cast<uint32_t>(std::stoul(fields.at(2)))};
 }
 
 PassFunctor get_pass_functor(const std::string &pass_name,
@@ -200,11 +298,218 @@ std::string all_passes_as_string(const PassFactory &pass_factory) {
 void print_usage() {
   std::cerr << "You are using the domino preprocessor for the CaT project."
             << std::endl;
-  std::cerr << "Usage: domino_preprocessor <source_file> " << std::endl;
+  std::cerr << "Usage: domino_preprocessor <source_file> [--debug|--noopt] [--cache DIR] [--rules FILE] [--time-passes] [--time-passes-json FILE] [--dep-graphs PREFIX [--pipeline STAGES,STATELESS,STATEFUL]]" << std::endl;
+  std::cerr << "       domino_preprocessor --batch <directory|manifest> [--jobs N] [--output-dir DIR] [--noopt] [--cache DIR] [--rules FILE]" << std::endl;
+  std::cerr << "       domino_preprocessor --server [socket_path] [--jobs N] [--cache DIR] [--rules FILE]" << std::endl;
   std::cerr << "List of passes: " << std::endl;
   std::cerr << all_passes_as_string(all_passes);
 }
 
+/// Called after every pass with its name and the program it produced
+typedef std::function<void(const std::string &, const std::string &)> PassLogger;
+
+/// One step of run_passes: a clang pass, or a run of IR passes
+struct PipelineStep {
+  /// Name of the pass, or of all passes in the run, also naming the step in PassCache
+  std::string name;
+
+  /// Creates the pass
+  PassFunctor functor;
+
+  /// A run of IR passes reports each of its passes itself
+  bool reports_each_pass;
+};
+
+/// Run the passes in pass_list on string_to_parse, one after the other,
+/// with ctx holding what they learn about the program along the way.
+/// Steps found in cache, if given, are replayed instead of run.
+std::string run_passes(const std::string &string_to_parse,
+                       const std::vector<std::string> &pass_list,
+                       Context &ctx, const PassLogger &log_pass,
+                       const PassCache *cache = nullptr) {
+  const IrPassObserver ir_observer = [log_pass, &ctx](const std::string &pass_name,
+                                                      const IrProgram &program) {
+    log_pass(pass_name, ir_print_program(program, ctx));
+  };
+
+  // add all preprocessing passes.
+  // A run of consecutive passes that all have an IR implementation
+  // becomes a single IrPipelinePass: one parse, one print.
+  std::vector<PipelineStep> passes_to_run;
+  std::vector<std::pair<std::string, IrTransformer>> ir_run;
+  const auto flush_ir_run = [&passes_to_run, &ir_run, ir_observer]() {
+    if (ir_run.empty()) return;
+    const auto transforms = ir_run;
+    std::string name;
+    for (const auto &transform : transforms)
+      name += (name.empty() ? "" : ",") + transform.first;
+    passes_to_run.emplace_back(PipelineStep{
+        "ir(" + name + ")",
+        [transforms, ir_observer](Context &pass_ctx) {
+          return std::make_unique<IrPipelinePass>(transforms, pass_ctx, ir_observer);
+        },
+        true});
+    ir_run.clear();
+  };
+  for (const auto &pass_name : pass_list) {
+    if (all_ir_passes.find(pass_name) != all_ir_passes.end()) {
+      ir_run.emplace_back(pass_name, all_ir_passes.at(pass_name));
+    } else {
+      flush_ir_run();
+      passes_to_run.emplace_back(PipelineStep{pass_name, get_pass_functor(pass_name, all_passes), false});
+    }
+  }
+  flush_ir_run();
+
+  /// Process them one after the other
+  return std::accumulate(
+      passes_to_run.begin(), passes_to_run.end(), string_to_parse,
+      [log_pass, cache, &ctx](const auto &current_output, const auto &step) {
+        const auto run_step = [&step, &ctx](const std::string &input) {
+          return (*step.functor(ctx))(input);
+        };
+        auto *profiler = PassProfiler::active();
+        if (profiler) profiler->begin_pass(step.name, current_output);
+        const auto p = cache ? cache->run(step.name, current_output, ctx, run_step)
+                             : run_step(current_output);
+        if (profiler) profiler->end_pass(p);
+        if (not step.reports_each_pass) log_pass(step.name, p);
+        return p;
+      });
+}
+
+/// Preprocess string_to_parse the way domino <source_file> does,
+/// writing what it prints on stdout to out, and return the preprocessed program
+std::string preprocess(const std::string &string_to_parse,
+                const std::vector<std::string> &pass_list,
+                const bool require_printout, Context &ctx, std::ostream &out,
+                const PassCache *cache) {
+  // Print progress after each pass when debugging
+  size_t i = 0;
+  const auto log_pass = [require_printout, &i, &out](const std::string &pass_name,
+                                                     const std::string &program) {
+    if (DEBUG || require_printout) {
+      out << "processing pass " << i << ": " << pass_name
+          << std::endl;
+      out << "program: " << program << std::endl;
+      out << "...pass " << i + 1 << " done.\n";
+    }
+    i++;
+  };
+
+  // A cached run of IR passes can't show the program after each of its passes
+  const auto result = run_passes(string_to_parse, pass_list, ctx, log_pass,
+                                 (DEBUG || require_printout) ? nullptr : cache);
+  out << result << std::endl;
+  return result;
+}
+
+/// Preprocess every program in a directory or manifest on a thread pool,
+/// writing one output and one log file per program
+int run_batch_mode(int argc, const char **argv,
+                   const std::vector<std::string> &default_pass_list,
+                   const std::vector<std::string> &no_opt_pass_list) {
+  assert_exception(argc >= 2 and std::string(argv[1]) == "--batch");
+  if (argc < 3) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+  const std::string dir_or_manifest = argv[2];
+  std::string output_dir = "batch_out";
+  unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+  bool no_opt = false;
+  std::string cache_dir;
+  std::string rules_file;
+  for (int i = 3; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--noopt") {
+      no_opt = true;
+    } else if (arg == "--cache" and i + 1 < argc) {
+      cache_dir = argv[++i];
+    } else if (arg == "--rules" and i + 1 < argc) {
+      rules_file = argv[++i];
+    } else if (arg == "--jobs" and i + 1 < argc and std::stoi(argv[i + 1]) >= 1) {
+      num_threads = std::stoi(argv[++i]);
+    } else if (arg == "--output-dir" and i + 1 < argc) {
+      output_dir = argv[++i];
+    } else {
+      std::cerr << "err: malformed arguments" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  const auto rules = rules_file.empty() ? "" : load_rules(rules_file);
+  const auto cache = cache_dir.empty() ? nullptr : std::make_unique<PassCache>(cache_dir, rules);
+  const auto pass_list = with_rules(no_opt ? no_opt_pass_list : default_pass_list);
+  const auto jobs = batch_jobs(batch_inputs(dir_or_manifest), output_dir);
+  const auto start = std::chrono::steady_clock::now();
+  const auto results = run_batch(
+      jobs,
+      [&pass_list, &cache](const std::string &string_to_parse, Context &ctx) {
+        return run_passes(string_to_parse, pass_list, ctx,
+                          [](const std::string &, const std::string &) {}, cache.get());
+      },
+      num_threads);
+  const double wall_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return print_batch_summary(std::cout, results, wall_seconds) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/// Keep the passes registered and clang warm in a long-lived process,
+/// preprocessing programs sent by domino_client over a Unix domain socket
+int run_server_mode(int argc, const char **argv,
+                    const std::vector<std::string> &default_pass_list,
+                    const std::vector<std::string> &no_opt_pass_list) {
+  assert_exception(argc >= 2 and std::string(argv[1]) == "--server");
+  std::string socket_path = default_socket_path();
+  unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string cache_dir;
+  std::string rules_file;
+  for (int i = 2; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--jobs" and i + 1 < argc and std::stoi(argv[i + 1]) >= 1) {
+      num_threads = std::stoi(argv[++i]);
+    } else if (arg == "--cache" and i + 1 < argc) {
+      cache_dir = argv[++i];
+    } else if (arg == "--rules" and i + 1 < argc) {
+      rules_file = argv[++i];
+    } else if (i == 2 and arg.substr(0, 2) != "--") {
+      socket_path = arg;
+    } else {
+      std::cerr << "err: malformed arguments" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  const auto rules = rules_file.empty() ? "" : load_rules(rules_file);
+  const auto cache = cache_dir.empty() ? nullptr : std::make_unique<PassCache>(cache_dir, rules);
+  const auto default_passes = with_rules(default_pass_list);
+  const auto no_opt_passes = with_rules(no_opt_pass_list);
+
+  // Every request gets a Context of its own, like a standalone run,
+  // and its rename maps and errors are sent back instead of printed.
+  serve(socket_path,
+        [&default_passes, &no_opt_passes, &cache](const ServerRequest &request) {
+          Context ctx;
+          std::ostringstream output;
+          std::ostringstream log;
+          ctx.SetLog(log);
+          try {
+            const auto pass_list = not request.pass_list.empty() ? with_rules(split(request.pass_list, ","))
+                                   : request.no_opt             ? no_opt_passes
+                                                                : default_passes;
+            preprocess(request.program, pass_list, request.debug, ctx, output, cache.get());
+            return ServerResponse{true, output.str(), log.str()};
+          } catch (const std::exception &e) {
+            log << "domino_preprocessor: Caught exception in main " << std::endl
+                << e.what() << std::endl;
+            return ServerResponse{false, output.str(), log.str()};
+          }
+        },
+        num_threads);
+  return EXIT_FAILURE;
+}
+
 int main(int argc, const char **argv) {
   try {
     // Populate all passes
@@ -214,8 +519,8 @@ int main(int argc, const char **argv) {
         "desugar_comp_asgn,array_replacer,array_validator,initial_pass,int_"
         "type_checker,if_converter,stateful_flanks,algebra_simplify,elim_"
         "identical_lhs_rhs,ssa,expr_"
-        "propagater,algebra_simplify,paren_remover,create_branch_var,algebra_"
-        "simplify,dce,dde,flow_ite_simplify,rename_pkt_fields"; 
+        "propagater,algebra_simplify,paren_remover,create_branch_var,"
+        "dce,dde,flow_ite_simplify,rename_pkt_fields"; 
     
     
     const auto no_opt_pass_list = "desugar_comp_asgn,array_replacer,array_validator,initial_pass,int_"
@@ -224,18 +529,46 @@ int main(int argc, const char **argv) {
         "propagater,paren_remover,create_branch_var,"
         "rename_pkt_fields"; 
     
-    // Usage: domino <source_file>
+    // Usage: domino --batch <directory|manifest> [options]
+    if (argc >= 2 and std::string(argv[1]) == "--batch") {
+      return run_batch_mode(argc, argv, split(default_pass_list, ","), split(no_opt_pass_list, ","));
+    }
+
+    // Usage: domino --server [socket_path] [options]
+    if (argc >= 2 and std::string(argv[1]) == "--server") {
+      return run_server_mode(argc, argv, split(default_pass_list, ","), split(no_opt_pass_list, ","));
+    }
+
+    // Usage: domino <source_file> [options]
     bool require_printout = false;
     if (argc >= 2) {
       // Get cmdline args
       int no_opt = 0;
+      std::string cache_dir;
+      std::string rules_file;
+      bool time_passes = false;
+      std::string timing_json_file;
+      std::string dep_graph_prefix;
+      PipelineModel pipeline = kDefaultPipelineModel;
 
-      if (argc == 3) {
-        std::string arg3 = std::string(argv[2]);
-        if (arg3 == "--debug")
+      for (int i = 2; i < argc; i++) {
+        std::string arg = std::string(argv[i]);
+        if (arg == "--debug")
           require_printout = true;
-        else if (arg3 == "--noopt") {
+        else if (arg == "--noopt") {
           no_opt = 1;
+        } else if (arg == "--cache" and i + 1 < argc) {
+          cache_dir = argv[++i];
+        } else if (arg == "--rules" and i + 1 < argc) {
+          rules_file = argv[++i];
+        } else if (arg == "--time-passes") {
+          time_passes = true;
+        } else if (arg == "--time-passes-json" and i + 1 < argc) {
+          timing_json_file = argv[++i];
+        } else if (arg == "--dep-graphs" and i + 1 < argc) {
+          dep_graph_prefix = argv[++i];
+        } else if (arg == "--pipeline" and i + 1 < argc) {
+          pipeline = parse_pipeline_model(argv[++i]);
         } else {
           std::cerr << "err: malformed arguments" << std::endl;
           return EXIT_FAILURE;
@@ -243,42 +576,44 @@ int main(int argc, const char **argv) {
       }
 
       const auto string_to_parse = file_to_str(std::string(argv[1]));
-      const auto pass_list = no_opt ? split(no_opt_pass_list, ",") : split(default_pass_list, ",");
-
-
-      // add all preprocessing passes
-      PassFunctorVector passes_to_run;
-      for (const auto &pass_name : pass_list)
-        passes_to_run.emplace_back(get_pass_functor(pass_name, all_passes));
-
-      // Some sanity checks...
-      assert(pass_list.size() == passes_to_run.size());
-
-      /// Process them one after the other
-      size_t i = 0;
-      const auto &result = std::accumulate(
-          passes_to_run.begin(), passes_to_run.end(), string_to_parse,
-          [require_printout, &i, &pass_list](const auto &current_output,
-                                             const auto &pass_functor
-                                             __attribute__((unused))) {
-            if (DEBUG || require_printout) {
-              std::cout << "processing pass " << i << ": " << pass_list[i]
-                        << std::endl;
-            }
-            i++;
-            const auto p = (*pass_functor())(current_output);
-            if (DEBUG || require_printout) {
-              std::cout << "program: " << p << std::endl;
-              std::cout << "...pass " << i << " done.\n";
-            }
-            return p;
-          });
+      const auto rules = rules_file.empty() ? "" : load_rules(rules_file);
+      const auto cache = cache_dir.empty() ? nullptr : std::make_unique<PassCache>(cache_dir, rules);
+      const auto pass_list = with_rules(no_opt ? split(no_opt_pass_list, ",") : split(default_pass_list, ","));
+
+
+      // Every pass run on this thread reports to profiler while profiling is set
+      PassProfiler profiler;
+      std::unique_ptr<PassProfiler::Scope> profiling;
+      if (time_passes or not timing_json_file.empty()) {
+        profiling = std::make_unique<PassProfiler::Scope>(profiler);
+        // Otherwise the first clang pass would pay for setting up clang
+        profiler.begin_pass("clang_setup", "");
+        const auto start = std::chrono::steady_clock::now();
+        ParseSession::get();
+        profiler.add_parse(seconds_since(start));
+        profiler.end_pass("");
+      }
+
+      Context ctx;
+      const auto result = preprocess(string_to_parse, pass_list, require_printout, ctx, std::cout, cache.get());
+
+      // Final stage: dependency graphs of the preprocessed program for CaT
+      if (not dep_graph_prefix.empty()) {
+        if (profiling) profiler.begin_pass("dep_graphs", result);
+        write_dependency_graphs(result, dep_graph_prefix, pipeline);
+        if (profiling) profiler.end_pass(result);
+      }
+
+      if (time_passes) print_timing_table(std::cerr, profiler.timings());
+      if (not timing_json_file.empty()) {
+        std::ofstream json(timing_json_file);
+        if (not json.good()) throw std::logic_error("Cannot write to " + timing_json_file);
+        print_timing_json(json, profiler.timings());
+      }
 
       if (DEBUG) {
-        std::cout << "result: " << result << std::endl;
 
         std::cout << " ------------- context: ---------\n";
-        Context &ctx = Context::GetContext();
         ctx.Print();
       }
 
@@ -0,0 +1,44 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "domino_server.h"
+#include "util.h"
+
+void print_usage() {
+  std::cerr << "Client for a preprocessor started with domino --server." << std::endl;
+  std::cerr << "Usage: domino_client <source_file> [--debug|--noopt|--passes pass1,pass2,...]" << std::endl;
+  std::cerr << "Connects to " << kDefaultSocketPath << " unless DOMINO_SOCKET is set." << std::endl;
+}
+
+int main(int argc, const char **argv) {
+  try {
+    if (argc < 2 or argc > 4) {
+      print_usage();
+      return EXIT_FAILURE;
+    }
+
+    ServerRequest request = {file_to_str(std::string(argv[1])), "", false, false};
+    const std::string arg2 = argc >= 3 ? argv[2] : "";
+    if (argc == 3 and arg2 == "--debug") {
+      request.debug = true;
+    } else if (argc == 3 and arg2 == "--noopt") {
+      request.no_opt = true;
+    } else if (argc == 4 and arg2 == "--passes") {
+      request.pass_list = argv[3];
+    } else if (argc != 2) {
+      std::cerr << "err: malformed arguments" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Print exactly what domino <source_file> would have printed
+    const auto response = send_request(default_socket_path(), request);
+    std::cout << response.output << std::flush;
+    std::cerr << response.log << std::flush;
+    return response.ok ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (const std::exception &e) {
+    std::cerr << "domino_client: Caught exception in main " << std::endl
+              << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
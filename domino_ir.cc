@@ -0,0 +1,436 @@
+#include "domino_ir.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "third_party/assert_exception.h"
+
+IrExprPtr ir_int(const int64_t value) {
+  return std::make_shared<const IrExpr>(IrExpr{IrExprKind::INT_LITERAL, "", value, {}});
+}
+
+IrExprPtr ir_pkt_field(const std::string & field) {
+  return std::make_shared<const IrExpr>(IrExpr{IrExprKind::PKT_FIELD, field, 0, {}});
+}
+
+IrExprPtr ir_state_var(const std::string & var) {
+  return std::make_shared<const IrExpr>(IrExpr{IrExprKind::STATE_VAR, var, 0, {}});
+}
+
+IrExprPtr ir_unary(const std::string & op, const IrExprPtr & sub) {
+  assert_exception(sub);
+  return std::make_shared<const IrExpr>(IrExpr{IrExprKind::UNARY, op, 0, {sub}});
+}
+
+IrExprPtr ir_binary(const std::string & op, const IrExprPtr & lhs, const IrExprPtr & rhs) {
+  assert_exception(lhs and rhs);
+  return std::make_shared<const IrExpr>(IrExpr{IrExprKind::BINARY, op, 0, {lhs, rhs}});
+}
+
+IrExprPtr ir_ternary(const IrExprPtr & cond, const IrExprPtr & true_expr, const IrExprPtr & false_expr) {
+  assert_exception(cond and true_expr and false_expr);
+  return std::make_shared<const IrExpr>(IrExpr{IrExprKind::TERNARY, "", 0, {cond, true_expr, false_expr}});
+}
+
+IrExprPtr ir_call(const std::string & callee, const std::vector<IrExprPtr> & args) {
+  return std::make_shared<const IrExpr>(IrExpr{IrExprKind::CALL, callee, 0, args});
+}
+
+IrExprPtr ir_paren(const IrExprPtr & sub) {
+  assert_exception(sub);
+  return std::make_shared<const IrExpr>(IrExpr{IrExprKind::PAREN, "", 0, {sub}});
+}
+
+const IrExprPtr & ir_strip_parens(const IrExprPtr & expr) {
+  assert_exception(expr);
+  return (expr->kind == IrExprKind::PAREN) ? ir_strip_parens(expr->operands.at(0)) : expr;
+}
+
+bool ir_is_var(const IrExprPtr & expr) {
+  assert_exception(expr);
+  return expr->kind == IrExprKind::PKT_FIELD or expr->kind == IrExprKind::STATE_VAR;
+}
+
+bool ir_is_int(const IrExprPtr & expr, const int64_t value) {
+  assert_exception(expr);
+  return expr->kind == IrExprKind::INT_LITERAL and expr->value == value;
+}
+
+bool ir_is_atomic(const IrExprPtr & expr) {
+  const auto & stripped = ir_strip_parens(expr);
+  return ir_is_var(stripped) or stripped->kind == IrExprKind::INT_LITERAL or stripped->kind == IrExprKind::CALL;
+}
+
+bool ir_is_flat(const IrExprPtr & expr) {
+  const auto & stripped = ir_strip_parens(expr);
+  switch (stripped->kind) {
+    case IrExprKind::UNARY:
+    case IrExprKind::BINARY:
+    case IrExprKind::TERNARY:
+      return std::all_of(stripped->operands.begin(), stripped->operands.end(), ir_is_atomic);
+    default:
+      return ir_is_atomic(stripped);
+  }
+}
+
+bool ir_equal(const IrExprPtr & a, const IrExprPtr & b) {
+  assert_exception(a and b);
+  if (a == b) return true;
+  if (a->kind != b->kind or a->name != b->name or a->value != b->value or
+      a->operands.size() != b->operands.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a->operands.size(); i++) {
+    if (not ir_equal(a->operands.at(i), b->operands.at(i))) return false;
+  }
+  return true;
+}
+
+namespace {
+
+/// C precedence levels, higher binds tighter
+const int kTernaryPrecedence = 3;
+const int kUnaryPrecedence   = 14;
+const int kPrimaryPrecedence = 16;
+
+int binary_precedence(const std::string & op) {
+  static const std::map<std::string, int> precedence = {
+    {"||", 4}, {"&&", 5}, {"|", 6}, {"^", 7}, {"&", 8},
+    {"==", 9}, {"!=", 9},
+    {"<", 10}, {">", 10}, {"<=", 10}, {">=", 10},
+    {"<<", 11}, {">>", 11},
+    {"+", 12}, {"-", 12},
+    {"*", 13}, {"/", 13}, {"%", 13}};
+  if (precedence.find(op) == precedence.end()) {
+    throw std::logic_error("Domino IR does not support binary operator " + op);
+  }
+  return precedence.at(op);
+}
+
+int precedence(const IrExprPtr & expr) {
+  switch (expr->kind) {
+    case IrExprKind::BINARY:  return binary_precedence(expr->name);
+    case IrExprKind::TERNARY: return kTernaryPrecedence;
+    case IrExprKind::UNARY:   return kUnaryPrecedence;
+    // A negative literal prints as a unary minus
+    case IrExprKind::INT_LITERAL: return expr->value < 0 ? kUnaryPrecedence : kPrimaryPrecedence;
+    default: return kPrimaryPrecedence;
+  }
+}
+
+std::string print(const IrExprPtr & expr, const std::string & pkt_prefix, const IrPrintStyle style);
+
+/// Print sub, parenthesizing it if its precedence is below min_precedence
+std::string print_operand(const IrExprPtr & sub, const int min_precedence,
+                          const std::string & pkt_prefix, const IrPrintStyle style) {
+  const std::string sub_str = print(sub, pkt_prefix, style);
+  return precedence(sub) < min_precedence ? "(" + sub_str + ")" : sub_str;
+}
+
+/// Parenthesize operand_str if gluing it to op_str would lex differently,
+/// e.g., a-(-1) must not come out as a--1.
+std::string glue_operand(const std::string & op_str, const std::string & operand_str) {
+  const bool ambiguous = (not op_str.empty()) and (not operand_str.empty()) and
+                         (op_str.back() == '-' or op_str.back() == '+') and
+                         operand_str.front() == op_str.back();
+  return ambiguous ? "(" + operand_str + ")" : operand_str;
+}
+
+std::string print(const IrExprPtr & expr, const std::string & pkt_prefix, const IrPrintStyle style) {
+  assert_exception(expr);
+  const auto & ops = expr->operands;
+  switch (expr->kind) {
+    case IrExprKind::INT_LITERAL:
+      return std::to_string(expr->value);
+
+    case IrExprKind::PKT_FIELD:
+      return pkt_prefix + expr->name;
+
+    case IrExprKind::STATE_VAR:
+      return expr->name;
+
+    case IrExprKind::PAREN:
+      return "(" + print(ops.at(0), pkt_prefix, style) + ")";
+
+    case IrExprKind::UNARY:
+      return expr->name + glue_operand(expr->name, print_operand(ops.at(0), kUnaryPrecedence, pkt_prefix, style));
+
+    case IrExprKind::BINARY: {
+      // All binary operators are left associative:
+      // the right operand needs parentheses even at equal precedence.
+      const int prec = binary_precedence(expr->name);
+      const std::string op_str = style == IrPrintStyle::CLANG ? " " + expr->name + " " : expr->name;
+      return print_operand(ops.at(0), prec, pkt_prefix, style) + op_str +
+             glue_operand(op_str, print_operand(ops.at(1), prec + 1, pkt_prefix, style));
+    }
+
+    case IrExprKind::TERNARY:
+      // The condition binds tighter than ?:, while ?: nests to the right.
+      return print_operand(ops.at(0), kTernaryPrecedence + 1, pkt_prefix, style) + " ? " +
+             print(ops.at(1), pkt_prefix, style) + " : " +
+             print_operand(ops.at(2), kTernaryPrecedence, pkt_prefix, style);
+
+    case IrExprKind::CALL: {
+      std::string ret = expr->name + "(";
+      for (size_t i = 0; i < ops.size(); i++) {
+        ret += (i == 0 ? "" : (style == IrPrintStyle::CLANG ? ", " : ",")) + print(ops.at(i), pkt_prefix, style);
+      }
+      return ret + ")";
+    }
+  }
+  assert_exception(false);
+  return "";
+}
+
+}  // namespace
+
+std::string ir_print_expr(const IrExprPtr & expr, const std::string & pkt_prefix, const IrPrintStyle style) {
+  return print(expr, pkt_prefix, style);
+}
+
+std::string ir_var_name(const IrExprPtr & var, const std::string & pkt_name) {
+  assert_exception(ir_is_var(var));
+  return var->kind == IrExprKind::PKT_FIELD ? pkt_name + "." + var->name : var->name;
+}
+
+void ir_collect_vars(const IrExprPtr & expr, const std::string & pkt_name,
+                     std::set<std::string> & vars,
+                     const bool packet, const bool state) {
+  assert_exception(expr);
+  if (expr->kind == IrExprKind::PKT_FIELD) {
+    if (packet) vars.emplace(ir_var_name(expr, pkt_name));
+  } else if (expr->kind == IrExprKind::STATE_VAR) {
+    if (state) vars.emplace(ir_var_name(expr, pkt_name));
+  } else {
+    for (const auto & operand : expr->operands) ir_collect_vars(operand, pkt_name, vars, packet, state);
+  }
+}
+
+Symbol ir_var_symbol(const IrExprPtr & var, const std::string & pkt_name, SymbolTable & symbols) {
+  return symbols.intern(ir_var_name(var, pkt_name));
+}
+
+void ir_collect_var_symbols(const IrExprPtr & expr, const std::string & pkt_name,
+                            SymbolTable & symbols, std::vector<Symbol> & vars,
+                            const bool packet, const bool state) {
+  assert_exception(expr);
+  if (expr->kind == IrExprKind::PKT_FIELD) {
+    if (packet) vars.emplace_back(ir_var_symbol(expr, pkt_name, symbols));
+  } else if (expr->kind == IrExprKind::STATE_VAR) {
+    if (state) vars.emplace_back(ir_var_symbol(expr, pkt_name, symbols));
+  } else {
+    for (const auto & operand : expr->operands) ir_collect_var_symbols(operand, pkt_name, symbols, vars, packet, state);
+  }
+}
+
+IrExprPtr ir_replace_vars(const IrExprPtr & expr,
+                          const std::function<IrExprPtr(const IrExprPtr &)> & replace) {
+  assert_exception(expr);
+  if (ir_is_var(expr)) {
+    const auto replacement = replace(expr);
+    return replacement ? replacement : expr;
+  }
+
+  bool changed = false;
+  std::vector<IrExprPtr> new_operands;
+  for (const auto & operand : expr->operands) {
+    new_operands.emplace_back(ir_replace_vars(operand, replace));
+    changed = changed or (new_operands.back() != operand);
+  }
+  if (not changed) return expr;
+  return std::make_shared<const IrExpr>(IrExpr{expr->kind, expr->name, expr->value, new_operands});
+}
+
+bool ir_evaluate(const IrExprPtr & expr, int64_t & result) {
+  assert_exception(expr);
+
+  // Truncate to a 32-bit int the way C arithmetic on int wraps in practice
+  const auto to_int = [] (const int64_t v) { return static_cast<int64_t>(static_cast<int32_t>(static_cast<uint32_t>(v))); };
+
+  const auto & ops = expr->operands;
+  switch (expr->kind) {
+    case IrExprKind::INT_LITERAL:
+      result = expr->value;
+      return true;
+
+    case IrExprKind::PAREN:
+      return ir_evaluate(ops.at(0), result);
+
+    case IrExprKind::UNARY: {
+      int64_t sub;
+      if (not ir_evaluate(ops.at(0), sub)) return false;
+      if (expr->name == "-") result = to_int(-sub);
+      else if (expr->name == "+") result = sub;
+      else if (expr->name == "!") result = !sub;
+      else if (expr->name == "~") result = to_int(~sub);
+      else return false;
+      return true;
+    }
+
+    case IrExprKind::TERNARY: {
+      int64_t cond;
+      if (not ir_evaluate(ops.at(0), cond)) return false;
+      return ir_evaluate(cond ? ops.at(1) : ops.at(2), result);
+    }
+
+    case IrExprKind::BINARY: {
+      const auto & op = expr->name;
+      int64_t l, r;
+      const bool l_ok = ir_evaluate(ops.at(0), l);
+      const bool r_ok = ir_evaluate(ops.at(1), r);
+
+      // Domino expressions have no side effects,
+      // so either operand alone can decide && and ||.
+      if (op == "&&") {
+        if ((l_ok and not l) or (r_ok and not r)) { result = 0; return true; }
+        if (l_ok and r_ok) { result = 1; return true; }
+        return false;
+      }
+      if (op == "||") {
+        if ((l_ok and l) or (r_ok and r)) { result = 1; return true; }
+        if (l_ok and r_ok) { result = 0; return true; }
+        return false;
+      }
+
+      if (not (l_ok and r_ok)) return false;
+      if      (op == "+")  result = to_int(l + r);
+      else if (op == "-")  result = to_int(l - r);
+      else if (op == "*")  result = to_int(l * r);
+      else if (op == "/")  { if (r == 0) return false; result = to_int(l / r); }
+      else if (op == "%")  { if (r == 0) return false; result = to_int(l % r); }
+      else if (op == "<<") { if (r < 0 or r >= 32) return false; result = to_int(l << r); }
+      else if (op == ">>") { if (r < 0 or r >= 32) return false; result = l >> r; }
+      else if (op == "&")  result = l & r;
+      else if (op == "|")  result = l | r;
+      else if (op == "^")  result = l ^ r;
+      else if (op == "==") result = l == r;
+      else if (op == "!=") result = l != r;
+      else if (op == "<")  result = l < r;
+      else if (op == ">")  result = l > r;
+      else if (op == "<=") result = l <= r;
+      else if (op == ">=") result = l >= r;
+      else return false;
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+std::set<std::string> ir_pkt_field_census(const IrProgram & program) {
+  std::set<std::string> ret;
+  for (const auto & field : program.fields) ret.emplace(field.name);
+  return ret;
+}
+
+std::set<std::string> ir_state_var_census(const IrProgram & program) {
+  std::set<std::string> ret;
+  for (const auto & state_var : program.state_vars) ret.emplace(state_var.name);
+  return ret;
+}
+
+std::set<std::string> ir_identifier_census(const IrProgram & program) {
+  std::set<std::string> ret = program.func_identifiers;
+  for (const auto & field : program.fields) ret.emplace(field.name);
+  for (const auto & state_var : program.state_vars) ret.emplace(state_var.name);
+  return ret;
+}
+
+bool ir_is_in_ssa(const IrProgram & program) {
+  std::set<std::string> assigned_vars;
+  for (const auto & stmt : program.body) {
+    if (not assigned_vars.emplace(ir_var_name(ir_strip_parens(stmt.lhs), program.pkt_name)).second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ir_equal(const std::vector<IrStmt> & a, const std::vector<IrStmt> & b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (not ir_equal(a.at(i).lhs, b.at(i).lhs) or not ir_equal(a.at(i).rhs, b.at(i).rhs)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ir_equal(const IrProgram & a, const IrProgram & b) {
+  if (a.fields.size() != b.fields.size() or
+      a.state_vars.size() != b.state_vars.size() or
+      a.pkt_fields_renamed != b.pkt_fields_renamed or
+      not ir_equal(a.body, b.body)) {
+    return false;
+  }
+  for (size_t i = 0; i < a.fields.size(); i++) {
+    if (a.fields.at(i).name != b.fields.at(i).name) return false;
+  }
+  for (size_t i = 0; i < a.state_vars.size(); i++) {
+    if (a.state_vars.at(i).name != b.state_vars.at(i).name) return false;
+  }
+  return true;
+}
+
+std::string ir_print_stmt(const IrStmt & stmt, const std::string & pkt_name) {
+  return ir_print_expr(stmt.lhs, pkt_name + ".") + " = " + ir_print_expr(stmt.rhs, pkt_name + ".");
+}
+
+namespace {
+
+/// Print program in the form rename_pkt_fields hands over to CaT:
+/// declarations of all variables with packet fields flattened to p_field,
+/// followed by one statement per line.
+std::string print_renamed_program(const IrProgram & program, Context & ctx) {
+  const std::string pkt_prefix = program.pkt_name + "_";
+
+  std::ostringstream out;
+  std::set<std::string> branch_vars;
+  for (const auto & field : ir_pkt_field_census(program)) {
+    if (ctx.GetType(field) == D_BIT) {
+      branch_vars.insert(field);
+    } else {
+      out << "int " << pkt_prefix << field << ";" << std::endl;
+    }
+  }
+  out << "# state variables start" << std::endl;
+  for (const auto & state_var : ir_state_var_census(program)) {
+    out << "int " << state_var << ";" << std::endl;
+  }
+  out << "# state variables end" << std::endl;
+  for (const auto & branch_var : branch_vars) {
+    out << "bit " << pkt_prefix << branch_var << ";" << std::endl;
+  }
+  out << "# packet vars start" << std::endl;
+  ctx.PrintPktVars(out, pkt_prefix);
+  out << "# declarations end" << std::endl;
+
+  for (const auto & stmt : program.body) {
+    out << ir_print_expr(stmt.lhs, pkt_prefix, IrPrintStyle::COMPACT) << " = "
+        << ir_print_expr(stmt.rhs, pkt_prefix, IrPrintStyle::COMPACT) << ";\n";
+  }
+  return out.str();
+}
+
+}  // namespace
+
+std::string ir_print_program(const IrProgram & program, Context & ctx) {
+  if (program.pkt_fields_renamed) return print_renamed_program(program, ctx);
+
+  std::string state_var_str = "";
+  for (const auto & state_var : program.state_vars) state_var_str += state_var.decl + ";";
+
+  std::string record_decl_str = "struct " + program.record_name + "{\n";
+  for (const auto & field : program.fields) record_decl_str += field.type + " " + field.name + ";";
+  record_decl_str += "};";
+
+  std::string body_str = "";
+  for (const auto & stmt : program.body) body_str += ir_print_stmt(stmt, program.pkt_name) + ";";
+
+  const std::string pkt_func_str = program.func_return_type + " " + program.func_name +
+                                   "( " + program.pkt_type + " " + program.pkt_name + ") " +
+                                   "{" + body_str + "}";
+
+  return state_var_str + program.scalar_funcs + record_decl_str + pkt_func_str;
+}
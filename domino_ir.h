@@ -0,0 +1,219 @@
+#ifndef DOMINO_IR_H_
+#define DOMINO_IR_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "context.h"
+#include "symbol_table.h"
+
+/// In-memory representation of a Domino program once if_converter has
+/// run: a single packet function whose body is a straight-line list of
+/// assignments over packet fields and state variables.
+/// Passes over this form rewrite the program directly instead of
+/// printing C and having the next pass parse it again with clang,
+/// so a chain of such passes costs one parse and one print in total.
+
+/// Kinds of nodes in an expression tree
+enum class IrExprKind { INT_LITERAL, PKT_FIELD, STATE_VAR, UNARY, BINARY, TERNARY, CALL, PAREN };
+
+struct IrExpr;
+
+/// Expression trees are immutable and freely shared between statements,
+/// so rewriting an expression means building new nodes on top of old ones.
+typedef std::shared_ptr<const IrExpr> IrExprPtr;
+
+/// One node of an expression tree
+struct IrExpr {
+  /// What kind of node this is
+  IrExprKind kind;
+
+  /// Field name without the packet prefix (PKT_FIELD), variable name (STATE_VAR),
+  /// callee name (CALL), or operator spelling (UNARY, BINARY)
+  std::string name = "";
+
+  /// Value of an INT_LITERAL
+  int64_t value = 0;
+
+  /// Sub expressions: one for UNARY and PAREN, lhs and rhs for BINARY,
+  /// condition, true and false expressions for TERNARY, arguments for CALL
+  std::vector<IrExprPtr> operands = {};
+};
+
+/// Node constructors
+IrExprPtr ir_int(const int64_t value);
+IrExprPtr ir_pkt_field(const std::string & field);
+IrExprPtr ir_state_var(const std::string & var);
+IrExprPtr ir_unary(const std::string & op, const IrExprPtr & sub);
+IrExprPtr ir_binary(const std::string & op, const IrExprPtr & lhs, const IrExprPtr & rhs);
+IrExprPtr ir_ternary(const IrExprPtr & cond, const IrExprPtr & true_expr, const IrExprPtr & false_expr);
+IrExprPtr ir_call(const std::string & callee, const std::vector<IrExprPtr> & args);
+IrExprPtr ir_paren(const IrExprPtr & sub);
+
+/// Strip off parentheses, the IR counterpart of clang's IgnoreParenImpCasts
+const IrExprPtr & ir_strip_parens(const IrExprPtr & expr);
+
+/// Is this a variable (packet field or state variable)?
+bool ir_is_var(const IrExprPtr & expr);
+
+/// Is this an integer literal with the given value?
+bool ir_is_int(const IrExprPtr & expr, const int64_t value);
+
+/// Is this an expression the flattener leaves in place as an operand:
+/// a variable, an integer literal or a call?
+bool ir_is_atomic(const IrExprPtr & expr);
+
+/// Is this already of the form x, op x, x op y, or x ? y : z,
+/// with x, y and z atomic?
+bool ir_is_flat(const IrExprPtr & expr);
+
+/// Structural equality of two expression trees
+bool ir_equal(const IrExprPtr & a, const IrExprPtr & b);
+
+/// Printing styles
+/// CLANG mimics clang's pretty printer (a + b, f(a, b)),
+/// COMPACT mimics replace_vars in clang_utility_functions (a+b, f(a,b)).
+/// Both insert parentheses that are not in the tree
+/// wherever C precedence would otherwise change the meaning.
+enum class IrPrintStyle { CLANG, COMPACT };
+
+/// Print an expression, prefixing packet fields with pkt_prefix (e.g., "p.")
+std::string ir_print_expr(const IrExprPtr & expr, const std::string & pkt_prefix,
+                          const IrPrintStyle style = IrPrintStyle::CLANG);
+
+/// Name of a variable as clang would print it: pkt_name.field or the state variable
+std::string ir_var_name(const IrExprPtr & var, const std::string & pkt_name);
+
+/// Collect names (as printed by ir_var_name) of all variables within expr,
+/// the IR counterpart of gen_var_list
+void ir_collect_vars(const IrExprPtr & expr, const std::string & pkt_name,
+                     std::set<std::string> & vars,
+                     const bool packet = true, const bool state = true);
+
+/// Interned name of a variable, as printed by ir_var_name
+Symbol ir_var_symbol(const IrExprPtr & var, const std::string & pkt_name, SymbolTable & symbols);
+
+/// Same as ir_collect_vars, appending the interned names of the variables
+/// to vars in the order they occur, repeats included
+void ir_collect_var_symbols(const IrExprPtr & expr, const std::string & pkt_name,
+                            SymbolTable & symbols, std::vector<Symbol> & vars,
+                            const bool packet = true, const bool state = true);
+
+/// Rebuild expr, replacing every variable for which replace returns
+/// a non-null expression. Subtrees without replacements are shared, not copied.
+IrExprPtr ir_replace_vars(const IrExprPtr & expr,
+                          const std::function<IrExprPtr(const IrExprPtr &)> & replace);
+
+/// Evaluate a variable-free expression as a C int (32 bits, wrapping),
+/// returning false if that is not possible (variables, division by zero, ...)
+bool ir_evaluate(const IrExprPtr & expr, int64_t & result);
+
+/// An assignment lhs = rhs, lhs is a packet field or a state variable
+struct IrStmt {
+  IrExprPtr lhs;
+  IrExprPtr rhs;
+};
+
+/// A state variable, printed back exactly as it was declared
+struct IrStateVar {
+  std::string name;
+  std::string decl;
+  std::string type;
+  bool is_array;
+};
+
+/// A field of the packet structure
+struct IrField {
+  std::string type;
+  std::string name;
+};
+
+class IrDefUse;
+
+/// Analyses of an IrProgram, cached in it by the functions in ir_analysis.h
+/// until a pass that changes the program doesn't preserve them
+struct IrAnalysisCache {
+  /// Is the body in SSA form (ir_is_in_ssa) and flat (ir_is_flat)?
+  std::optional<bool> in_ssa = {};
+  std::optional<bool> flat = {};
+
+  /// All identifiers in the program (ir_identifier_census)
+  std::shared_ptr<const std::set<std::string>> census = nullptr;
+
+  /// Def-use index of the body (ir_def_use.h)
+  std::shared_ptr<const IrDefUse> def_use = nullptr;
+
+  /// Have all identifiers been reserved in the Context's NameAllocator?
+  /// Every identifier passes add comes from that allocator,
+  /// so unlike the others this never goes stale.
+  bool names_reserved = false;
+};
+
+/// A whole Domino program: state variables, scalar functions,
+/// the packet structure, and the body of the packet function
+struct IrProgram {
+  /// State variables in declaration order
+  std::vector<IrStateVar> state_vars = {};
+
+  /// Scalar (non-packet) functions, passed through untouched
+  std::string scalar_funcs = "";
+
+  /// Names of scalar functions, packet functions and their parameters,
+  /// needed so that new identifiers don't clash with them
+  std::set<std::string> func_identifiers = {};
+
+  /// Name of the packet structure and its fields
+  std::string record_name = "Packet";
+  std::vector<IrField> fields = {};
+
+  /// Signature of the packet function
+  std::string func_return_type = "void";
+  std::string func_name = "func";
+  std::string pkt_type = "struct Packet";
+  std::string pkt_name = "p";
+
+  /// Body of the packet function
+  std::vector<IrStmt> body = {};
+
+  /// Set by rename_pkt_fields: the program is then printed in the
+  /// flattened p_field form handed to CaT instead of as C.
+  bool pkt_fields_renamed = false;
+
+  /// Analyses of the program so far
+  mutable IrAnalysisCache analyses = {};
+};
+
+/// Names of all packet fields, sorted
+std::set<std::string> ir_pkt_field_census(const IrProgram & program);
+
+/// Names of all state variables, sorted
+std::set<std::string> ir_state_var_census(const IrProgram & program);
+
+/// All identifiers in a program, the IR counterpart of identifier_census
+std::set<std::string> ir_identifier_census(const IrProgram & program);
+
+/// Check if program body is in SSA form
+bool ir_is_in_ssa(const IrProgram & program);
+
+/// Check if two statement lists are structurally identical
+bool ir_equal(const std::vector<IrStmt> & a, const std::vector<IrStmt> & b);
+
+/// Check if two programs have structurally identical bodies and declarations
+bool ir_equal(const IrProgram & a, const IrProgram & b);
+
+/// Print one statement in the style of clang_stmt_printer
+std::string ir_print_stmt(const IrStmt & stmt, const std::string & pkt_name);
+
+/// Print a program, either as a C translation unit laid out like
+/// pkt_func_transform does, or, once pkt_fields_renamed is set, in the
+/// declarations-plus-statements form produced by rename_pkt_fields,
+/// which needs ctx for the types and opt levels of packet fields.
+std::string ir_print_program(const IrProgram & program, Context & ctx);
+
+#endif  // DOMINO_IR_H_
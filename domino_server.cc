@@ -0,0 +1,163 @@
+#include "domino_server.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "third_party/assert_exception.h"
+#include "third_party/file_descriptor.hh"
+
+#include "util.h"
+
+std::string default_socket_path() {
+  const char * from_env = std::getenv("DOMINO_SOCKET");
+  return (from_env != nullptr and std::string(from_env) != "") ? std::string(from_env) : kDefaultSocketPath;
+}
+
+namespace {
+
+/// Both sides write one message, fields packed with encode_fields,
+/// and then close (or half-close) their end of the connection,
+/// so a message is everything up to EOF.
+std::string read_to_eof(FileDescriptor & fd) {
+  std::string ret;
+  while (not fd.eof()) ret += fd.read();
+  return ret;
+}
+
+/// Turn a failed system call into an exception
+void check_syscall(const int return_value, const std::string & attempt) {
+  if (return_value < 0) throw std::logic_error(attempt + ": " + std::strerror(errno));
+}
+
+sockaddr_un socket_address(const std::string & socket_path) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.empty() or socket_path.size() >= sizeof(address.sun_path)) {
+    throw std::logic_error("Socket path " + socket_path + " is empty or too long");
+  }
+  std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+  return address;
+}
+
+/// Connect to socket_path, returning -1 if nobody is listening there
+int connect_to(const std::string & socket_path) {
+  const auto address = socket_address(socket_path);
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  check_syscall(fd, "socket");
+  if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+const std::string kRequestTag = "domino-request-1";
+const std::string kResponseTag = "domino-response-1";
+
+/// Answer the request on one accepted connection
+void answer(FileDescriptor & connection, const RequestHandler & handler) {
+  const auto message = read_to_eof(connection);
+  // A server checking whether this one is alive connects and hangs up at once
+  if (message.empty()) return;
+
+  ServerResponse response;
+  try {
+    const auto fields = decode_fields(message, 5);
+    if (fields.at(0) != kRequestTag) throw std::logic_error("Malformed message: not a domino request");
+    response = handler(ServerRequest{fields.at(4), fields.at(1), fields.at(2) == "1", fields.at(3) == "1"});
+  } catch (const std::exception & e) {
+    response = ServerResponse{false, "", std::string("domino server: ") + e.what() + "\n"};
+  }
+  connection.write(encode_fields({kResponseTag, response.ok ? "1" : "0", response.output, response.log}));
+}
+
+}  // namespace
+
+void serve(const std::string & socket_path, const RequestHandler & handler, const unsigned num_threads) {
+  assert_exception(num_threads >= 1);
+
+  // A client that goes away before reading its response
+  // should fail that write, not kill the server.
+  signal(SIGPIPE, SIG_IGN);
+
+  // Replace the socket file of a server that has exited,
+  // but never steal the socket of one that is still running.
+  struct stat socket_stat;
+  if (stat(socket_path.c_str(), &socket_stat) == 0) {
+    if (not S_ISSOCK(socket_stat.st_mode)) throw std::logic_error(socket_path + " exists and is not a socket");
+    const int live = connect_to(socket_path);
+    if (live >= 0) {
+      close(live);
+      throw std::logic_error("Another server is already listening on " + socket_path);
+    }
+    check_syscall(unlink(socket_path.c_str()), "unlink " + socket_path);
+  }
+
+  const auto address = socket_address(socket_path);
+  const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  check_syscall(listen_fd, "socket");
+  FileDescriptor listener(listen_fd);
+  check_syscall(bind(listener.fd_num(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)),
+                "bind " + socket_path);
+  check_syscall(listen(listener.fd_num(), SOMAXCONN), "listen " + socket_path);
+  std::cerr << "domino server: listening on " << socket_path << " with " << num_threads << " threads" << std::endl;
+
+  // Every worker blocks in accept on the same socket, and serves
+  // the connections it gets one at a time, until accept fails for good.
+  std::mutex error_mutex;
+  std::string error;
+  const auto worker = [&listener, &handler, &error_mutex, &error] () {
+    while (true) {
+      const int fd = accept(listener.fd_num(), nullptr, nullptr);
+      if (fd < 0) {
+        if (errno == EINTR or errno == ECONNABORTED) continue;
+        std::lock_guard<std::mutex> lock(error_mutex);
+        error = std::string("accept: ") + std::strerror(errno);
+        return;
+      }
+      try {
+        FileDescriptor connection(fd);
+        answer(connection, handler);
+      } catch (const std::exception & e) {
+        // Only this connection is affected, e.g., the client hung up
+        std::cerr << "domino server: dropped a connection: " << e.what() << std::endl;
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned i = 0; i < num_threads; i++) pool.emplace_back(worker);
+  for (auto & thread : pool) thread.join();
+  throw std::logic_error("domino server stopped: " + error);
+}
+
+ServerResponse send_request(const std::string & socket_path, const ServerRequest & request) {
+  const int fd = connect_to(socket_path);
+  if (fd < 0) {
+    throw std::logic_error("Cannot connect to a domino server on " + socket_path +
+                           ", start one with domino --server " + socket_path);
+  }
+  FileDescriptor connection(fd);
+  connection.write(encode_fields({kRequestTag, request.pass_list, request.no_opt ? "1" : "0",
+                                  request.debug ? "1" : "0", request.program}));
+  // Tell the server the request is complete
+  check_syscall(shutdown(connection.fd_num(), SHUT_WR), "shutdown");
+
+  const auto fields = decode_fields(read_to_eof(connection), 4);
+  if (fields.at(0) != kResponseTag) throw std::logic_error("Malformed message: not a domino response");
+  return ServerResponse{fields.at(1) == "1", fields.at(2), fields.at(3)};
+}
@@ -0,0 +1,56 @@
+#ifndef DOMINO_SERVER_H_
+#define DOMINO_SERVER_H_
+
+#include <functional>
+#include <string>
+
+/// Socket that domino --server listens on and domino_client connects to,
+/// unless overridden by the DOMINO_SOCKET environment variable
+const std::string kDefaultSocketPath = "/tmp/domino.sock";
+
+/// kDefaultSocketPath, or DOMINO_SOCKET if it is set
+std::string default_socket_path();
+
+/// One program for the server to preprocess
+struct ServerRequest {
+  /// Text of the Domino program
+  std::string program;
+
+  /// Comma-separated passes to run; empty to pick
+  /// the default or the --noopt pipeline based on no_opt
+  std::string pass_list;
+
+  /// Same as --noopt on the command line
+  bool no_opt;
+
+  /// Same as --debug on the command line
+  bool debug;
+};
+
+/// What the server sends back for a ServerRequest
+struct ServerResponse {
+  /// Whether preprocessing succeeded, i.e., the exit status of a standalone run
+  bool ok;
+
+  /// What a standalone run prints to stdout
+  std::string output;
+
+  /// What a standalone run prints to stderr,
+  /// e.g., the rename maps and any error
+  std::string log;
+};
+
+/// Preprocess one request, never throwing
+typedef std::function<ServerResponse(const ServerRequest &)> RequestHandler;
+
+/// Listen on the Unix domain socket socket_path, replacing a stale socket
+/// file left behind by an earlier server, and answer one request per connection
+/// on a pool of num_threads threads. Each thread keeps its own clang state warm
+/// across requests (parse_session.h). Only returns by throwing.
+void serve(const std::string & socket_path, const RequestHandler & handler, const unsigned num_threads);
+
+/// Send request to the server listening on socket_path and wait for its response.
+/// Throws std::logic_error if there is no server or the connection breaks.
+ServerResponse send_request(const std::string & socket_path, const ServerRequest & request);
+
+#endif  // DOMINO_SERVER_H_
@@ -40,9 +40,9 @@ ExprFlattenerHandler::flatten_body(const Stmt *function_body,
     DominoType lhs_type;
     if (isa<MemberExpr>(lhs)) {
       const auto * lhs_decl = dyn_cast<MemberExpr>(lhs)->getMemberDecl();
-      lhs_type = Context::GetContext().GetType(lhs_decl->getNameAsString());
+      lhs_type = ctx_.GetType(lhs_decl->getNameAsString());
     } else if (isa<DeclRefExpr>(lhs)) {
-      lhs_type = Context::GetContext().GetType(clang_stmt_printer(lhs));
+      lhs_type = ctx_.GetType(clang_stmt_printer(lhs));
     } else {
       std::cout << "Error: encountered lhs that is neither MemberExpr nor DeclRefExpr. It is " << clang_expr_printer(lhs) << std::endl;
       assert_exception(false);
@@ -201,10 +201,10 @@ FlattenResult ExprFlattenerHandler::flatten_to_atomic_expr(
     const auto flat_var_member = unique_identifiers_.get_unique_identifier();
 
     // Add flat_var_member to context.
-    Context::GetContext().SetType(flat_var_member, expr_type);
-    Context::GetContext().SetVarKind(flat_var_member, D_TMP);
-    Context::GetContext().Derive(flat_var_member, flat_var_member);
-    Context::GetContext().SetOptLevel(flat_var_member, D_OPT);
+    ctx_.SetType(flat_var_member, expr_type);
+    ctx_.SetVarKind(flat_var_member, D_TMP);
+    ctx_.Derive(flat_var_member, flat_var_member);
+    ctx_.SetOptLevel(flat_var_member, D_OPT);
 
     // Add flat_var_member to running list of newly created decls.
     const auto flat_var_decl =
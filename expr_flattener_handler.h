@@ -25,6 +25,9 @@ struct FlattenResult {
 /// statement is of the form x = y op z, where x, y, z are atomic
 class ExprFlattenerHandler {
 public:
+  /// Construct an ExprFlattenerHandler recording new temporaries in ctx
+  explicit ExprFlattenerHandler(Context &ctx) : ctx_(ctx) {}
+
   /// Function supplied to SinglePass
   std::string transform(const clang::TranslationUnitDecl *tu_decl);
 
@@ -74,6 +77,9 @@ private:
   /// Object that generates unique identifiers
   UniqueIdentifiers unique_identifiers_ =
       UniqueIdentifiers(std::set<std::string>());
+
+  /// Context of the program being flattened
+  Context &ctx_;
 };
 
 #endif // EXPR_FLATTENER_HANDLER_H_
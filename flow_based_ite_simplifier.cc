@@ -11,10 +11,10 @@
 using namespace clang;
 
 
-std::string flow_based_ite_simplify_transform(const clang::TranslationUnitDecl *tu_decl) {
+std::string flow_based_ite_simplify_transform(const clang::TranslationUnitDecl *tu_decl, Context &ctx) {
   return pkt_func_transform(
       tu_decl, std::bind(&flow_based_ite_simplifier_transform_body, std::placeholders::_1,
-                         std::placeholders::_2, &(tu_decl->getASTContext())));
+                         std::placeholders::_2, &(tu_decl->getASTContext()), std::ref(ctx)));
 }
 
 bool isPktVar(const std::string & a, const std::string& pkt_name) {
@@ -43,7 +43,7 @@ std::string strReplaceAll(std::string str, const std::string& from, const std::s
     return str;
 }
 
-std::string processFocusedSubexpression(const clang::Expr * lhs, const clang::Expr * rhs, clang::BinaryOperatorKind bopKind, const std::string& pkt_name) {
+std::string processFocusedSubexpression(const clang::Expr * lhs, const clang::Expr * rhs, clang::BinaryOperatorKind bopKind, const std::string& pkt_name, Context & ctx) {
 
   std::string l = "", r = "";
 
@@ -64,10 +64,10 @@ std::string processFocusedSubexpression(const clang::Expr * lhs, const clang::Ex
   if (notInLHS.size() == 1 && notInRHS.size() == 1) {
     const std::string lhs_var = *(notInRHS.begin());
     const std::string rhs_var = *(notInLHS.begin());
-    // std::cout << " left base: " << Context::GetContext().GetBase(removePktPrefix(lhs_var, pkt_name));
-    // std::cout << " right base: " << Context::GetContext().GetBase(removePktPrefix(rhs_var, pkt_name));
+    // std::cout << " left base: " << ctx.GetBase(removePktPrefix(lhs_var, pkt_name));
+    // std::cout << " right base: " << ctx.GetBase(removePktPrefix(rhs_var, pkt_name));
     if (isPktVar(lhs_var, pkt_name) && isPktVar(rhs_var, pkt_name)) {
-      if (Context::GetContext().GetBase(removePktPrefix(lhs_var, pkt_name)) == Context::GetContext().GetBase(removePktPrefix(rhs_var, pkt_name))) {
+      if (ctx.GetBase(removePktPrefix(lhs_var, pkt_name)) == ctx.GetBase(removePktPrefix(rhs_var, pkt_name))) {
         // can skip right
         // std::cout << " \nleft==right\n";
 
@@ -117,15 +117,15 @@ std::string processFocusedSubexpression(const clang::Expr * lhs, const clang::Ex
   return "";
 }
 
-std::string processFocus(const clang::BinaryOperator* focus, const clang::Expr* lhs, const clang::Stmt* child, const std::string & pkt_name) {
+std::string processFocus(const clang::BinaryOperator* focus, const clang::Expr* lhs, const clang::Stmt* child, const std::string & pkt_name, Context & ctx) {
 
   // std::cout << "  simplify candidate found: " << clang_stmt_printer(child) << std::endl;
 
   if (focus->getOpcode() == clang::BinaryOperatorKind::BO_LAnd) {
-    std::string processed = processFocusedSubexpression(focus->getLHS()->IgnoreParenImpCasts(), focus->getRHS()->IgnoreParenImpCasts(), focus->getOpcode(), pkt_name);
+    std::string processed = processFocusedSubexpression(focus->getLHS()->IgnoreParenImpCasts(), focus->getRHS()->IgnoreParenImpCasts(), focus->getOpcode(), pkt_name, ctx);
     return clang_stmt_printer(lhs) + " = " + processed + ";\n";
   } else if (focus->getOpcode() == clang::BinaryOperatorKind::BO_LOr) {
-    std::string processed =processFocusedSubexpression(focus->getLHS()->IgnoreParenImpCasts(), focus->getRHS()->IgnoreParenImpCasts(), focus->getOpcode(), pkt_name);
+    std::string processed =processFocusedSubexpression(focus->getLHS()->IgnoreParenImpCasts(), focus->getRHS()->IgnoreParenImpCasts(), focus->getOpcode(), pkt_name, ctx);
     return clang_stmt_printer(lhs) + " = " + processed + ";\n";
   } else return clang_stmt_printer(child) + ";\n";
 }
@@ -133,7 +133,8 @@ std::string processFocus(const clang::BinaryOperator* focus, const clang::Expr*
 std::pair<std::string, std::vector<std::string>>
 flow_based_ite_simplifier_transform_body(const CompoundStmt *function_body,
                   const std::string &pkt_name,
-                  clang::ASTContext * _ctx) {
+                  clang::ASTContext * _ctx,
+                  Context &ctx) {
   // Do not run if this is not in SSA
   if (not is_in_ssa(function_body)) {
     throw std::logic_error("Flow-based ITE simplification can be run only after SSA. "
@@ -156,17 +157,17 @@ flow_based_ite_simplifier_transform_body(const CompoundStmt *function_body,
     // std::cout << "  testing if lhs is branch temp: " << lhsStr << std::endl;
 
 
-    if (Context::GetContext().GetType(removePktPrefix(lhsStr, pkt_name)) == D_BIT) {
+    if (ctx.GetType(removePktPrefix(lhsStr, pkt_name)) == D_BIT) {
       // only conservatively parse (a <OP> b) && (a <OP> b'), (a' <OP> b) && (a <OP> b) 
       // or neg ((a <OP> b) && (a <OP> b')), neg ((a' <OP> b) && (a <OP> b))    
       if (isa<BinaryOperator>(rhs)) {
         const auto * focus = dyn_cast<BinaryOperator>(rhs);
-        transformed_body += processFocus(focus, lhs, child, pkt_name);
+        transformed_body += processFocus(focus, lhs, child, pkt_name, ctx);
        } else if (isa<UnaryOperator>(rhs)) {
         const auto * un_op = dyn_cast<UnaryOperator>(rhs);
         if (isa<BinaryOperator>(un_op->getSubExpr())) {
           const auto * focus = dyn_cast<BinaryOperator>(un_op->getSubExpr());
-          transformed_body += processFocus(focus, lhs, child, pkt_name);
+          transformed_body += processFocus(focus, lhs, child, pkt_name, ctx);
         } else transformed_body += clang_stmt_printer(child) + ";";
       } 
     } else transformed_body += clang_stmt_printer(child) + ";";
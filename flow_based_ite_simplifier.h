@@ -9,9 +9,10 @@
 #include "ast_visitor.h"
 #include "clang/AST/AST.h"
 #include "clang_utility_functions.h"
+#include "context.h"
 
 /// Entry point from SinglePass to flow-based ITE simplifier, calls expr_prop_fn_body immediately
-std::string flow_based_ite_simplify_transform(const clang::TranslationUnitDecl *tu_decl);
+std::string flow_based_ite_simplify_transform(const clang::TranslationUnitDecl *tu_decl, Context &ctx);
 
 /// Flow-based branch condition simplification:
 /// because we do SSA after if-conversion, we end up value-numbering sequentially
@@ -29,7 +30,8 @@ std::string flow_based_ite_simplify_transform(const clang::TranslationUnitDecl *
 std::pair<std::string, std::vector<std::string>>
 flow_based_ite_simplifier_transform_body(const clang::CompoundStmt *function_body,
                   const std::string &pkt_name __attribute__((unused)),
-                  clang::ASTContext * _ctx);
+                  clang::ASTContext * _ctx,
+                  Context &ctx);
 
 
 #endif // FLOW_BASED_ITE_SIMPLIFIER_H_
@@ -4,28 +4,72 @@
 #include <cstdio>
 
 #include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <numeric>
 #include <ostream>
 #include <set>
 #include <stdexcept>
 #include <string>
-#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "third_party/assert_exception.h"
 
-#include "util.h"
+/// Hash used to intern graph nodes: std::hash, extended to vectors
+/// of hashable elements such as the nodes of Graph::condensation()
+template <class T> struct GraphNodeHash {
+  size_t operator()(const T &x) const { return std::hash<T>()(x); }
+};
+
+template <class T> struct GraphNodeHash<std::vector<T>> {
+  size_t operator()(const std::vector<T> &v) const {
+    size_t seed = v.size();
+    for (const auto &x : v)
+      seed ^= GraphNodeHash<T>()(x) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+  }
+};
 
-/// Adjacency list representation of graph
-/// Store both out and in edges for every node
+/// Directed graph over nodes of type NodeType.
+/// Nodes are interned to dense IDs 0 .. num_nodes() - 1 in the order they are
+/// added, and edges are stored once as pairs of IDs. Adjacency is kept in
+/// compressed sparse row (CSR) form: the successors (predecessors) of node i
+/// are succ_targets_[succ_offsets_[i] .. succ_offsets_[i + 1]), sorted by ID.
+/// The CSR arrays are rebuilt in O(V + E) on the first query after a change,
+/// so build a graph first, then query it. Adding a node or an edge is O(1)
+/// amortized, and so is exists_edge, no matter how long the nodes are.
 /// N.B. In many methods, returning a Graph is ok
 /// because of C++11's move semantics
 /// and the likely move elision from the compiler
 template <class NodeType> class Graph {
 public:
+  /// Dense ID of a node
+  typedef uint32_t NodeId;
+
+  /// Edge between two node IDs
+  typedef std::pair<NodeId, NodeId> IdEdge;
+
+  /// Contiguous run of node IDs, e.g., the successors of a node
+  class IdRange {
+  public:
+    IdRange(const NodeId *t_first, const NodeId *t_last)
+        : first_(t_first), last_(t_last) {}
+    const NodeId *begin() const { return first_; }
+    const NodeId *end() const { return last_; }
+    size_t size() const { return static_cast<size_t>(last_ - first_); }
+    bool empty() const { return first_ == last_; }
+
+  private:
+    const NodeId *first_;
+    const NodeId *last_;
+  };
+
   /// Comparator type for two NodeType objects
   typedef std::function<bool(const NodeType &, const NodeType &)> Comparator;
 
@@ -42,15 +86,24 @@ public:
           [](const auto &x __attribute__((unused))) { return "white"; })
       : node_printer_(node_printer), node_crayon_(node_crayon){};
 
-  /// Add node alone to existing graph, check that node doesn't already exist
-  void add_node(const NodeType &node);
+  /// Add node alone to existing graph, check that node doesn't already exist.
+  /// Returns the node's ID.
+  NodeId add_node(const NodeType &node);
 
-  /// Remove node from existing graph, checking that it does exist
+  /// Remove node from existing graph, checking that it does exist.
+  /// Nodes added after it move down one ID. O(V + E).
   void remove_singleton_node(const NodeType &node);
 
   /// Add edge to existing graph, check that both from_node and to_node exist
   void add_edge(const NodeType &from_node, const NodeType &to_node);
 
+  /// Same as add_edge, on node IDs
+  void add_edge_by_id(const NodeId from, const NodeId to);
+
+  /// Bulk-add edges between node IDs, silently skipping duplicates,
+  /// in time linear in the number of edges
+  void add_edges_by_id(const std::vector<IdEdge> &edges);
+
   /// Copy over graph and clear out all edges
   Graph<NodeType> copy_and_clear() const;
 
@@ -61,197 +114,314 @@ public:
 
     out << "digraph graph_output {splines=true node [shape = box "
            "style=\"rounded,filled\"];\n";
-    for (const auto &node : graph.node_set_) {
-      out << hash_string(graph.node_printer_(node)) << " [label = \""
-          << graph.node_printer_(node) << "\" "
-          << " fillcolor=" << graph.node_crayon_(node) + "];\n";
+    for (NodeId i = 0; i < graph.num_nodes(); i++) {
+      out << "n" << i << " [label = \""
+          << graph.node_printer_(graph.node(i)) << "\" "
+          << " fillcolor=" << graph.node_crayon_(graph.node(i)) + "];\n";
     }
 
-    for (const auto &node_pair : graph.succ_map_)
-      for (const auto &neighbor : node_pair.second)
-        out << hash_string(graph.node_printer_(node_pair.first)) << " -> "
-            << hash_string(graph.node_printer_(neighbor)) << " ;\n";
+    for (NodeId i = 0; i < graph.num_nodes(); i++)
+      for (const auto neighbor : graph.succ(i))
+        out << "n" << i << " -> n" << neighbor << " ;\n";
     out << "}";
 
     return out;
   }
 
-  /// Used for unit tests that check expected graph output
+  /// Used for unit tests that check expected graph output.
+  /// Compares nodes and edges by value, regardless of IDs.
   bool operator==(const Graph<NodeType> &b) const;
 
   /// Graph union restricted to graphs with identical vertex sets
   Graph<NodeType> operator+(const Graph<NodeType> &b) const;
 
-  /// Accessors
-  const auto &node_set() const { return node_set_; }
-  const auto &succ_map() const { return succ_map_; }
-  const auto &pred_map() const { return pred_map_; }
+  /// Number of nodes and edges
+  size_t num_nodes() const { return nodes_.size(); }
+  size_t num_edges() const { return edges_.size(); }
+
+  /// Whether node is in the graph
+  bool has_node(const NodeType &node) const {
+    return ids_.find(node) != ids_.end();
+  }
+
+  /// ID of node, which must be in the graph
+  NodeId id(const NodeType &node) const {
+    const auto it = ids_.find(node);
+    if (it == ids_.end()) throw std::logic_error("Node doesn't exist in graph\n");
+    return it->second;
+  }
+
+  /// Node with ID id
+  const NodeType &node(const NodeId id) const { return nodes_.at(id); }
+
+  /// All nodes, indexed by ID
+  const std::vector<NodeType> &nodes() const { return nodes_; }
+
+  /// Printer for nodes, as used in dot output
+  const NodePrinter &node_printer() const { return node_printer_; }
+
+  /// All edges, in the order they were added
+  const std::vector<IdEdge> &edges() const { return edges_; }
+
+  /// Successors and predecessors of the node with ID id, sorted by ID
+  IdRange succ(const NodeId id) const {
+    build_csr();
+    return IdRange(csr_.succ_targets.data() + csr_.succ_offsets.at(id),
+                   csr_.succ_targets.data() + csr_.succ_offsets.at(id + 1));
+  }
+  IdRange pred(const NodeId id) const {
+    build_csr();
+    return IdRange(csr_.pred_targets.data() + csr_.pred_offsets.at(id),
+                   csr_.pred_targets.data() + csr_.pred_offsets.at(id + 1));
+  }
+
+  /// Accessors by value, built on demand in O((V + E) log V):
+  /// prefer the ID-based accessors above in new code.
+  const std::set<NodeType> &node_set() const {
+    build_value_maps();
+    return value_maps_.node_set;
+  }
+  const std::map<NodeType, std::vector<NodeType>> &succ_map() const {
+    build_value_maps();
+    return value_maps_.succ_map;
+  }
+  const std::map<NodeType, std::vector<NodeType>> &pred_map() const {
+    build_value_maps();
+    return value_maps_.pred_map;
+  }
 
   /// Check if an edge exists from a to b
   bool exists_edge(const NodeType &a, const NodeType &b) const {
-    return (std::find(succ_map_.at(a).begin(), succ_map_.at(a).end(), b) !=
-                succ_map_.at(a).end() and
-            std::find(pred_map_.at(b).begin(), pred_map_.at(b).end(), a) !=
-                pred_map_.at(b).end());
+    return edge_keys_.count(edge_key(id(a), id(b))) != 0;
   }
 
-  /// Check if there is a directed path from a to b
-  bool exists_path(const NodeType &a, const NodeType &b) const {
-    auto dfs_prop_map = init_dfs_map();
-    std::vector<NodeType> visited_nodes;
-    std::tie(std::ignore, visited_nodes) = dfs_visit(a, dfs_prop_map, 0);
-    return std::find(visited_nodes.begin(), visited_nodes.end(), b) !=
-           visited_nodes.end();
+  /// Same as exists_edge, on node IDs
+  bool exists_edge_by_id(const NodeId a, const NodeId b) const {
+    return edge_keys_.count(edge_key(a, b)) != 0;
   }
 
-  /// Strongly Connected Components (Kosaraju's algorithm)
-  auto scc() const;
+  /// Check if there is a directed path from a to b
+  bool exists_path(const NodeType &a, const NodeType &b) const;
+
+  /// Strongly connected components, as the component of every node by ID.
+  /// Components are numbered in topological order of the condensation,
+  /// i.e., every edge between two components goes from a lower to a higher
+  /// number. Iterative Tarjan: O(V + E) and no recursion, however deep the graph.
+  std::vector<uint32_t> scc_ids() const;
+
+  /// Strongly connected components, in the topological order of scc_ids()
+  std::vector<std::vector<NodeType>> scc() const;
 
   /// Condense a graph into a DAG by collapsing its strongly connected
-  /// components into larger meta nodes. Takes a function to order nodes within
-  /// a strongly connected component for printing
+  /// components into larger meta nodes, in O(V + E). Takes a function to order
+  /// nodes within a strongly connected component for printing.
+  /// Node i of the result is component i of scc_ids().
   Graph<std::vector<NodeType>> condensation(
       const std::function<bool(const NodeType &a, const NodeType &b)> &cmp)
       const;
 
-  /// Critical path scheduling (This is almost folklore now:
-  /// https://en.wikipedia.org/wiki/Critical_path_method) but goes back to
-  /// Kelley and Walker (1959): http://dl.acm.org/citation.cfm?id=1460318 We
-  /// also assume that all edges between nodes are of length 1 meaning that each
-  /// node needs to be scheduled exactly one time step after its predecessor.
-  std::map<NodeType, uint32_t> critical_path_schedule() const;
+  /// Node IDs in a topological order, found with Kahn's algorithm in
+  /// O(V + E): sources first, by ID, then breadth first.
+  /// Throws if the graph has a cycle: condense it first.
+  std::vector<NodeId> topological_order() const;
 
 private:
-  /// Dfs properties, auxiliary data structure for Depth First Search
-  struct DfsProps {
-    NodeType parent = NodeType();
-    int discovery_time = -1;
-    int finish_time = -1;
-    enum class Color { WHITE, BLACK, GRAY } color = Color::WHITE;
-  };
+  /// Key of the edge from a to b in edge_keys_
+  static uint64_t edge_key(const NodeId a, const NodeId b) {
+    return (static_cast<uint64_t>(a) << 32) | b;
+  }
 
-  /// Return from DFS visit: Current time after visiting, and vector of visited
-  /// nodes
-  typedef std::pair<int, std::vector<NodeType>> DfsResult;
-
-  /// Book-keeping data structure to keep track of DFS properties for each node
-  typedef std::map<NodeType, DfsProps> DfsPropMap;
-
-  /// Find the graph transpose G', i.e. for every edge u-->v in G,
-  /// there is an edge v-->u in G'
-  Graph<NodeType> transpose() const;
-
-  /// Depth First Search of graph
-  DfsPropMap dfs(const Comparator &comparator = std::less<NodeType>()) const;
-
-  /// Depth First Forest of a graph
-  auto dfs_forest(const Comparator &comparator = std::less<NodeType>()) const;
-
-  /// Depth First Search recursive helper method, visit all nodes starting from
-  /// node
-  DfsResult dfs_visit(const NodeType &node,
-                      std::map<NodeType, DfsProps> &dfs_prop_map,
-                      const int time) const;
-
-  /// Initialize DFS map for all nodes using node_set_
-  DfsPropMap init_dfs_map() const {
-    DfsPropMap ret;
-    for (const auto &node : node_set_) {
-      ret[node] = DfsProps();
-      ret[node].parent = NodeType();
-      ret[node].discovery_time = -1;
-      ret[node].finish_time = -1;
-      ret[node].color = DfsProps::Color::WHITE;
-    }
-    return ret;
+  /// Invalidate everything derived from nodes_ and edges_
+  void invalidate() {
+    csr_.valid = false;
+    value_maps_.valid = false;
   }
 
-  /// Set of all nodes in the graph
-  std::set<NodeType> node_set_ = {};
+  /// Rebuild the CSR arrays if the graph changed since they were built
+  void build_csr() const;
+
+  /// Rebuild node_set(), succ_map() and pred_map() if the graph changed
+  void build_value_maps() const;
+
+  /// Nodes, indexed by ID
+  std::vector<NodeType> nodes_ = {};
+
+  /// ID of each node
+  std::unordered_map<NodeType, NodeId, GraphNodeHash<NodeType>> ids_ = {};
 
-  /// Successor map from a node to all successor nodes (outgoing edges)
-  std::map<NodeType, std::vector<NodeType>> succ_map_ = {};
+  /// Edges, in the order they were added
+  std::vector<IdEdge> edges_ = {};
 
-  /// Predecessor map from a node to all predecessor nodes (incoming edges)
-  std::map<NodeType, std::vector<NodeType>> pred_map_ = {};
+  /// edge_key() of every edge, to find duplicates in O(1)
+  std::unordered_set<uint64_t> edge_keys_ = {};
+
+  /// Adjacency in CSR form, derived from edges_ on demand
+  mutable struct {
+    bool valid = false;
+    std::vector<uint32_t> succ_offsets = {};
+    std::vector<NodeId> succ_targets = {};
+    std::vector<uint32_t> pred_offsets = {};
+    std::vector<NodeId> pred_targets = {};
+  } csr_;
+
+  /// Adjacency by value, derived on demand for node_set(), succ_map() and pred_map()
+  mutable struct {
+    bool valid = false;
+    std::set<NodeType> node_set = {};
+    std::map<NodeType, std::vector<NodeType>> succ_map = {};
+    std::map<NodeType, std::vector<NodeType>> pred_map = {};
+  } value_maps_;
 
   /// Node printer function
   NodePrinter node_printer_;
 
   /// Node crayon function, to color nodes for dot output
   NodeCrayon node_crayon_;
-
-  /// Data structure to track dot labels for each node
-  std::map<NodeType, std::string> dot_labels_ = {};
 };
 
-template <class NodeType> void Graph<NodeType>::add_node(const NodeType &node) {
-  // Add node to node_set_
-  if (node_set_.find(node) != node_set_.end()) {
+template <class NodeType>
+typename Graph<NodeType>::NodeId Graph<NodeType>::add_node(const NodeType &node) {
+  if (has_node(node)) {
     throw std::logic_error(
-        "Trying to insert node that already exists in node_set_\n");
+        "Trying to insert node that already exists in graph\n");
   }
-  node_set_.insert(node);
-  succ_map_[node] = std::vector<NodeType>();
-  pred_map_[node] = std::vector<NodeType>();
+  assert_exception(nodes_.size() < std::numeric_limits<NodeId>::max());
+  const auto node_id = static_cast<NodeId>(nodes_.size());
+  nodes_.emplace_back(node);
+  ids_.emplace(node, node_id);
+  invalidate();
+  return node_id;
 }
 
 template <class NodeType>
 void Graph<NodeType>::remove_singleton_node(const NodeType &node) {
   // Make sure node does exist
-  if (node_set_.find(node) == node_set_.end()) {
+  if (not has_node(node)) {
     throw std::logic_error("Trying to remove a node that doesn't exist\n");
   }
 
   // Make sure node doesn't point to anyone else
   // or isn't pointed to by anyone else
-  assert_exception(succ_map_.at(node).empty());
-  assert_exception(pred_map_.at(node).empty());
-
-  // Remove all traces of node
-  node_set_.erase(node);
-  succ_map_.erase(node);
-  pred_map_.erase(node);
+  const auto removed = id(node);
+  assert_exception(succ(removed).empty());
+  assert_exception(pred(removed).empty());
+
+  // Remove all traces of node, and close the gap in the IDs
+  nodes_.erase(nodes_.begin() + removed);
+  ids_.erase(node);
+  for (NodeId i = removed; i < nodes_.size(); i++) ids_.at(nodes_.at(i)) = i;
+  edge_keys_.clear();
+  for (auto &edge : edges_) {
+    if (edge.first > removed) edge.first--;
+    if (edge.second > removed) edge.second--;
+    edge_keys_.insert(edge_key(edge.first, edge.second));
+  }
+  invalidate();
 }
 
 template <class NodeType>
 void Graph<NodeType>::add_edge(const NodeType &from_node,
                                const NodeType &to_node) {
-  if (node_set_.find(from_node) == node_set_.end()) {
-    throw std::logic_error("from_node doesn't exist in node_set_\n");
+  if (not has_node(from_node)) {
+    throw std::logic_error("from_node doesn't exist in graph\n");
   }
 
-  if (node_set_.find(to_node) == node_set_.end()) {
-    throw std::logic_error("to_node doesn't exist in node_set_\n");
+  if (not has_node(to_node)) {
+    throw std::logic_error("to_node doesn't exist in graph\n");
   }
 
+  add_edge_by_id(id(from_node), id(to_node));
+}
+
+template <class NodeType>
+void Graph<NodeType>::add_edge_by_id(const NodeId from, const NodeId to) {
+  assert_exception(from < nodes_.size() and to < nodes_.size());
+
   // If edge already exists, return
-  if (std::find(succ_map_.at(from_node).begin(), succ_map_.at(from_node).end(),
-                to_node) != succ_map_.at(from_node).end()) {
-    assert_exception(std::find(pred_map_.at(to_node).begin(),
-                               pred_map_.at(to_node).end(),
-                               from_node) != pred_map_.at(to_node).end());
+  if (not edge_keys_.insert(edge_key(from, to)).second) {
     std::cerr << "// Warning: edge already exists, ignoring add_edge command\n";
     return;
   }
+  edges_.emplace_back(from, to);
+  invalidate();
+}
+
+template <class NodeType>
+void Graph<NodeType>::add_edges_by_id(const std::vector<IdEdge> &edges) {
+  edges_.reserve(edges_.size() + edges.size());
+  edge_keys_.reserve(edge_keys_.size() + edges.size());
+  for (const auto &edge : edges) {
+    assert_exception(edge.first < nodes_.size() and edge.second < nodes_.size());
+    if (edge_keys_.insert(edge_key(edge.first, edge.second)).second)
+      edges_.emplace_back(edge);
+  }
+  invalidate();
+}
+
+template <class NodeType> void Graph<NodeType>::build_csr() const {
+  if (csr_.valid) return;
+
+  // Two passes of counting sort: first bucket edges by target, then
+  // stably by source, so every row of succ_targets comes out sorted
+  // by ID, and likewise for pred_targets. O(V + E) in all.
+  const auto bucket = [this](const std::vector<IdEdge> &edges, const bool by_source,
+                             std::vector<uint32_t> &offsets) {
+    offsets.assign(nodes_.size() + 1, 0);
+    for (const auto &edge : edges) offsets.at((by_source ? edge.first : edge.second) + 1)++;
+    for (size_t i = 0; i < nodes_.size(); i++) offsets.at(i + 1) += offsets.at(i);
+    std::vector<IdEdge> sorted(edges.size());
+    auto next = offsets;
+    for (const auto &edge : edges) sorted.at(next.at(by_source ? edge.first : edge.second)++) = edge;
+    return sorted;
+  };
 
-  succ_map_.at(from_node).emplace_back(to_node);
-  pred_map_.at(to_node).emplace_back(from_node);
+  std::vector<uint32_t> scratch;
+  const auto by_source = bucket(bucket(edges_, false, scratch), true, csr_.succ_offsets);
+  csr_.succ_targets.resize(by_source.size());
+  for (size_t i = 0; i < by_source.size(); i++) csr_.succ_targets.at(i) = by_source.at(i).second;
 
-  // Keep these lists sorted to ensure the equality comparison works
-  std::sort(succ_map_.at(from_node).begin(), succ_map_.at(from_node).end());
-  std::sort(pred_map_.at(to_node).begin(), pred_map_.at(to_node).end());
+  const auto by_target = bucket(bucket(edges_, true, scratch), false, csr_.pred_offsets);
+  csr_.pred_targets.resize(by_target.size());
+  for (size_t i = 0; i < by_target.size(); i++) csr_.pred_targets.at(i) = by_target.at(i).first;
+
+  csr_.valid = true;
+}
+
+template <class NodeType> void Graph<NodeType>::build_value_maps() const {
+  if (value_maps_.valid) return;
+  value_maps_.node_set = std::set<NodeType>(nodes_.begin(), nodes_.end());
+  value_maps_.succ_map.clear();
+  value_maps_.pred_map.clear();
+  for (const auto &node : nodes_) {
+    value_maps_.succ_map[node] = {};
+    value_maps_.pred_map[node] = {};
+  }
+  for (const auto &edge : edges_) {
+    value_maps_.succ_map.at(nodes_.at(edge.first)).emplace_back(nodes_.at(edge.second));
+    value_maps_.pred_map.at(nodes_.at(edge.second)).emplace_back(nodes_.at(edge.first));
+  }
+  // Sorted by value, as the adjacency lists of the value-based
+  // representation this replaces were
+  for (auto &pair : value_maps_.succ_map) std::sort(pair.second.begin(), pair.second.end());
+  for (auto &pair : value_maps_.pred_map) std::sort(pair.second.begin(), pair.second.end());
+  value_maps_.valid = true;
 }
 
 template <class NodeType>
 bool Graph<NodeType>::operator==(const Graph<NodeType> &b) const {
-  return (this->node_set_ == b.node_set_) and
-         (this->succ_map_ == b.succ_map_) and (this->pred_map_ == b.pred_map_);
+  if (num_nodes() != b.num_nodes() or num_edges() != b.num_edges()) return false;
+  for (const auto &node : nodes_)
+    if (not b.has_node(node)) return false;
+  for (const auto &edge : edges_)
+    if (not b.exists_edge(nodes_.at(edge.first), nodes_.at(edge.second))) return false;
+  return true;
 }
 
 template <class NodeType>
 Graph<NodeType> Graph<NodeType>::operator+(const Graph<NodeType> &b) const {
-  if (this->node_set_ != b.node_set_) {
+  bool same_nodes = (num_nodes() == b.num_nodes());
+  for (const auto &node : nodes_) same_nodes = same_nodes and b.has_node(node);
+  if (not same_nodes) {
     throw std::logic_error(
         "Graph union is only supported on graphs with identical node sets\n");
   }
@@ -259,134 +429,115 @@ Graph<NodeType> Graph<NodeType>::operator+(const Graph<NodeType> &b) const {
   // Copy down nodes, clear out edges
   Graph<NodeType> result = this->copy_and_clear();
 
-  // Start adding edges
-  for (const auto &graph : {this, &b})
-    for (const auto &node : graph->succ_map_)
-      for (const auto &neighbor : node.second)
-        result.add_edge(node.first, neighbor);
+  // Start adding edges, translating b's IDs into ours
+  std::vector<IdEdge> edges = edges_;
+  for (const auto &edge : b.edges_)
+    edges.emplace_back(id(b.nodes_.at(edge.first)), id(b.nodes_.at(edge.second)));
+  result.add_edges_by_id(edges);
 
   return result;
 }
 
-template <class NodeType> Graph<NodeType> Graph<NodeType>::transpose() const {
-  Graph transpose_graph = copy_and_clear();
-
-  // Flip edges
-  for (const auto &node : succ_map_) {
-    for (const auto &neighbor : node.second) {
-      // The original graph has an edge from node to neighbor, flip that around
-      transpose_graph.succ_map_.at(neighbor).emplace_back(node.first);
-      transpose_graph.pred_map_.at(node.first).emplace_back(neighbor);
-    }
-  }
-  return transpose_graph;
-}
-
 template <class NodeType>
 Graph<NodeType> Graph<NodeType>::copy_and_clear() const {
   Graph copy(*this);
-  // Clear out succ_map_ and pred_map_
-  for (const auto &node : copy.node_set_) {
-    copy.succ_map_.at(node).clear();
-    copy.pred_map_.at(node).clear();
-  }
+  // Clear out the edges, keeping node IDs
+  copy.edges_.clear();
+  copy.edge_keys_.clear();
+  copy.invalidate();
   return copy;
 }
 
 template <class NodeType>
-std::map<NodeType, typename Graph<NodeType>::DfsProps>
-Graph<NodeType>::dfs(const Comparator &comparator) const {
-  // Map to store DFS properties
-  auto dfs_prop_map = init_dfs_map();
-
-  // Sort node sets using comparator
-  std::vector<NodeType> node_vector(node_set_.begin(), node_set_.end());
-  std::sort(node_vector.begin(), node_vector.end(), comparator);
-
-  int passed_time = 0;
-  for (const auto &node : node_vector) {
-    if (dfs_prop_map.at(node).color == DfsProps::Color::WHITE) {
-      std::tie(passed_time, std::ignore) =
-          dfs_visit(node, dfs_prop_map, passed_time);
-    }
-  }
-
-  return dfs_prop_map;
-}
-
-template <class NodeType>
-std::pair<int, std::vector<NodeType>>
-Graph<NodeType>::dfs_visit(const NodeType &node,
-                           std::map<NodeType, DfsProps> &dfs_prop_map,
-                           const int passed_time) const {
-  std::vector<NodeType> ret{node}, child_vec{};
-  int time = passed_time + 1;
-  dfs_prop_map.at(node).discovery_time = time;
-  dfs_prop_map.at(node).color = DfsProps::Color::GRAY;
-  for (const auto &neighbor : succ_map_.at(node)) {
-    if (dfs_prop_map.at(neighbor).color == DfsProps::Color::WHITE) {
-      dfs_prop_map.at(neighbor).parent = node;
-      std::tie(time, child_vec) = dfs_visit(neighbor, dfs_prop_map, time);
-      ret.insert(ret.end(), child_vec.begin(), child_vec.end());
+bool Graph<NodeType>::exists_path(const NodeType &a, const NodeType &b) const {
+  const auto target = id(b);
+  std::vector<bool> visited(num_nodes(), false);
+  std::vector<NodeId> to_visit = {id(a)};
+  visited.at(id(a)) = true;
+  while (not to_visit.empty()) {
+    const auto current = to_visit.back();
+    to_visit.pop_back();
+    if (current == target) return true;
+    for (const auto neighbor : succ(current)) {
+      if (not visited.at(neighbor)) {
+        visited.at(neighbor) = true;
+        to_visit.emplace_back(neighbor);
+      }
     }
   }
-  dfs_prop_map.at(node).color = DfsProps::Color::BLACK;
-  time = time + 1;
-  dfs_prop_map.at(node).finish_time = time;
-  return std::make_pair(time, ret);
+  return false;
 }
 
 template <class NodeType>
-auto Graph<NodeType>::dfs_forest(const Comparator &comparator) const {
-  Graph<NodeType> ret(node_printer_);
+std::vector<uint32_t> Graph<NodeType>::scc_ids() const {
+  const uint32_t kUnvisited = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> index(num_nodes(), kUnvisited);
+  std::vector<uint32_t> low_link(num_nodes(), 0);
+  std::vector<bool> on_stack(num_nodes(), false);
+  std::vector<NodeId> stack;
+  std::vector<uint32_t> component(num_nodes(), kUnvisited);
+  uint32_t next_index = 0;
+  uint32_t num_components = 0;
+
+  // Explicit DFS call stack: each frame is a node and
+  // how many of its successors have been looked at
+  std::vector<std::pair<NodeId, uint32_t>> frames;
+  const auto visit = [&](const NodeId node) {
+    index.at(node) = low_link.at(node) = next_index++;
+    stack.emplace_back(node);
+    on_stack.at(node) = true;
+    frames.emplace_back(node, 0);
+  };
 
-  const auto dfs_map = dfs(comparator);
-  for (const auto &pair : dfs_map) {
-    ret.add_node(pair.first);
-  }
+  for (NodeId root = 0; root < num_nodes(); root++) {
+    if (index.at(root) != kUnvisited) continue;
+    visit(root);
+    while (not frames.empty()) {
+      const auto node = frames.back().first;
+      const auto successors = succ(node);
+      if (frames.back().second < successors.size()) {
+        const auto neighbor = *(successors.begin() + frames.back().second++);
+        if (index.at(neighbor) == kUnvisited) {
+          visit(neighbor);
+        } else if (on_stack.at(neighbor)) {
+          low_link.at(node) = std::min(low_link.at(node), index.at(neighbor));
+        }
+        continue;
+      }
 
-  for (const auto &pair : dfs_map) {
-    if (pair.second.parent != NodeType()) {
-      ret.add_edge(pair.second.parent, pair.first);
-      ret.add_edge(pair.first, pair.second.parent);
+      // Done with node: fold its low link into its parent's,
+      // and pop its component if it is the component's root
+      frames.pop_back();
+      if (not frames.empty()) {
+        const auto parent = frames.back().first;
+        low_link.at(parent) = std::min(low_link.at(parent), low_link.at(node));
+      }
+      if (low_link.at(node) == index.at(node)) {
+        NodeId member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          on_stack.at(member) = false;
+          component.at(member) = num_components;
+        } while (member != node);
+        num_components++;
+      }
     }
   }
-  return ret;
-}
-
-template <class NodeType> auto Graph<NodeType>::scc() const {
-  // Call DFS and print out result
-  const auto dfs_map = dfs();
-
-  // Compute transpose graph
-  const auto graph_transpose = transpose();
 
-  // Call DFS on transpose graph, using decreasing order of finish times from
-  // the previous DFS as the comparator
-  const auto rev_dfs_forest = graph_transpose.dfs_forest(
-      [&dfs_map](const NodeType &n1, const NodeType &n2) {
-        return dfs_map.at(n1).finish_time > dfs_map.at(n2).finish_time;
-      });
-
-  // Get vector of nodes in rev_dfs_forest
-  std::vector<NodeType> node_vector;
-  for (const auto &node : rev_dfs_forest.node_set())
-    node_vector.emplace_back(node);
+  // Tarjan completes a component only after every component reachable from it,
+  // i.e., in reverse topological order
+  for (auto &c : component) c = num_components - 1 - c;
+  return component;
+}
 
-  // Now generate components of the rev_dfs_forest, which then become SCCs
+template <class NodeType>
+std::vector<std::vector<NodeType>> Graph<NodeType>::scc() const {
+  const auto component = scc_ids();
   std::vector<std::vector<NodeType>> sccs;
-  while (not node_vector.empty()) {
-    const auto &front_node = node_vector.front();
-    auto dfs_prop_map = init_dfs_map();
-    std::vector<NodeType> visited_nodes;
-    std::tie(std::ignore, visited_nodes) =
-        rev_dfs_forest.dfs_visit(front_node, dfs_prop_map, 0);
-    for (const auto &visited : visited_nodes) {
-      node_vector.erase(
-          std::remove(node_vector.begin(), node_vector.end(), visited),
-          node_vector.end());
-    }
-    sccs.emplace_back(visited_nodes);
+  for (NodeId i = 0; i < num_nodes(); i++) {
+    if (component.at(i) >= sccs.size()) sccs.resize(component.at(i) + 1);
+    sccs.at(component.at(i)).emplace_back(nodes_.at(i));
   }
   return sccs;
 }
@@ -396,6 +547,7 @@ Graph<std::vector<NodeType>> Graph<NodeType>::condensation(
     const std::function<bool(const NodeType &a, const NodeType &b)> &cmp)
     const {
   // Extract sccs of this graph
+  const auto component = scc_ids();
   auto sccs = scc();
 
   // Put statements within an SCC in the order specified by cmp
@@ -403,76 +555,50 @@ Graph<std::vector<NodeType>> Graph<NodeType>::condensation(
     std::sort(scc.begin(), scc.end(), cmp);
   }
 
-  // Graph condensation: Add SCCs as nodes
+  // Graph condensation: Add SCCs as nodes.
+  // Copy the node printer: the condensed graph may outlive this one.
+  const auto node_printer = node_printer_;
   Graph<std::vector<NodeType>> condensed_graph(
-      [this](const std::vector<NodeType> &node_vector) {
+      [node_printer](const std::vector<NodeType> &node_vector) {
         std::string ret;
         for (const auto &node : node_vector)
-          ret += node_printer_(node) + "\n";
+          ret += node_printer(node) + "\n";
         return ret;
       });
-  for (uint32_t i = 0; i < sccs.size(); i++) {
-    condensed_graph.add_node(sccs.at(i));
+  for (const auto &scc : sccs) {
+    condensed_graph.add_node(scc);
   }
 
-  // Graph condensation: Add edges between distinct SCCs
-  for (uint32_t i = 0; i < sccs.size(); i++) {
-    for (uint32_t j = 0; j < sccs.size(); j++) {
-      for (const auto &node_i : sccs.at(i)) {
-        for (const auto &node_j : sccs.at(j)) {
-          // If there's an edge between any two nodes in two different sccs in
-          // the original graph
-          if (exists_edge(node_i, node_j) and (i != j)) {
-            condensed_graph.add_edge(sccs.at(i), sccs.at(j));
-          }
-        }
-      }
-    }
+  // Graph condensation: Add an edge between two SCCs for every edge
+  // between nodes in them, duplicates being dropped by add_edges_by_id
+  std::vector<typename Graph<std::vector<NodeType>>::IdEdge> condensed_edges;
+  for (const auto &edge : edges_) {
+    if (component.at(edge.first) != component.at(edge.second))
+      condensed_edges.emplace_back(component.at(edge.first), component.at(edge.second));
   }
+  condensed_graph.add_edges_by_id(condensed_edges);
   return condensed_graph;
 }
 
 template <class NodeType>
-std::map<NodeType, uint32_t> Graph<NodeType>::critical_path_schedule() const {
-  // TODO: Check that graph is acyclic
-  // Initialize list of nodes that need to be scheduled
-  std::vector<NodeType> to_schedule(node_set_.begin(), node_set_.end());
-
-  // The scheduler is a map from NodeType to timestamp telling us when each node
-  // of type NodeType is scheduled
-  std::map<NodeType, uint32_t> schedule;
-
-  // Keep scheduling the next node until you run out of nodes
-  while (not to_schedule.empty()) {
-    // Find next node
-    // i.e. a node all of whose predecessors have been scheduled
-    NodeType next_node;
-    for (const auto &candidate : to_schedule) {
-      if (std::accumulate(pred_map_.at(candidate).begin(),
-                          pred_map_.at(candidate).end(), true,
-                          [&to_schedule](const auto &acc, const auto &x) {
-                            return acc and (std::find(to_schedule.begin(),
-                                                      to_schedule.end(),
-                                                      x) == to_schedule.end());
-                          })) {
-        next_node = candidate;
-        break;
-      }
-    }
-
-    // Find time for next_node, assume all edges are of length 1
-    const uint32_t next_node_time = std::accumulate(
-        pred_map_.at(next_node).begin(), pred_map_.at(next_node).end(),
-        static_cast<uint32_t>(0), [&schedule](const auto &acc, const auto &x) {
-          return std::max(acc, schedule.at(x) + 1);
-        });
-
-    // append to schedule, remove from to_schedule
-    schedule[next_node] = next_node_time;
-    to_schedule.erase(
-        std::remove(to_schedule.begin(), to_schedule.end(), next_node));
+std::vector<typename Graph<NodeType>::NodeId>
+Graph<NodeType>::topological_order() const {
+  std::vector<uint32_t> in_degree(num_nodes());
+  for (NodeId i = 0; i < num_nodes(); i++) in_degree.at(i) = pred(i).size();
+
+  // order doubles as the FIFO queue of ready nodes:
+  // order[done ..] have all their predecessors in order[.. done)
+  std::vector<NodeId> order;
+  order.reserve(num_nodes());
+  for (NodeId i = 0; i < num_nodes(); i++)
+    if (in_degree.at(i) == 0) order.emplace_back(i);
+  for (size_t done = 0; done < order.size(); done++) {
+    for (const auto neighbor : succ(order.at(done)))
+      if (--in_degree.at(neighbor) == 0) order.emplace_back(neighbor);
   }
-  return schedule;
+  if (order.size() != num_nodes())
+    throw std::logic_error("Graph has a cycle, there is no topological order\n");
+  return order;
 }
 
 #endif // GRAPH_H_
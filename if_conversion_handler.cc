@@ -17,11 +17,8 @@ using namespace clang;
 using std::placeholders::_1;
 using std::placeholders::_2;
 
-static ASTContext *_ctx;
-
 std::string IfConversionHandler::transform(const TranslationUnitDecl *tu_decl) {
-  _ctx = &(tu_decl->getASTContext());
-  unique_identifiers_ = UniqueIdentifiers(identifier_census(tu_decl));
+  ctx_.Names().reserve(identifier_census(tu_decl));
   return pkt_func_transform(
       tu_decl, std::bind(&IfConversionHandler::if_convert_body, this, _1, _2));
 }
@@ -56,13 +53,13 @@ void IfConversionHandler::if_convert(std::string &current_stream,
                              "portion of an if\n");
     }
 
-    auto br_tmp_var = unique_identifiers_.get_unique_identifier("_br_tmp");
+    auto br_tmp_var = ctx_.Names().allocate("_br_tmp");
     auto pkt_br_tmp_var = pkt_name + "." + br_tmp_var;
     current_decls.push_back("int " + br_tmp_var + ";");
-    Context::GetContext().SetType(br_tmp_var, D_BIT);
-    Context::GetContext().SetVarKind(br_tmp_var, D_TMP);
-    Context::GetContext().Derive(br_tmp_var, br_tmp_var);
-    Context::GetContext().SetOptLevel(br_tmp_var, D_OPT);
+    ctx_.SetType(br_tmp_var, D_BIT);
+    ctx_.SetVarKind(br_tmp_var, D_TMP);
+    ctx_.Derive(br_tmp_var, br_tmp_var);
+    ctx_.SetOptLevel(br_tmp_var, D_OPT);
 
     current_stream += pkt_br_tmp_var + " = " + clang_stmt_printer(if_stmt->getCond()) + ";";
 
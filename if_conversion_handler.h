@@ -10,7 +10,7 @@
 #include "clang/AST/Stmt.h"
 #include "clang/AST/Expr.h"
 
-#include "unique_identifiers.h"
+#include "context.h"
 
 #include <map>
 
@@ -18,6 +18,9 @@
 /// and recursively get rid of all branches.
 class IfConversionHandler {
  public:
+  /// Construct an IfConversionHandler recording branch temporaries in ctx
+  explicit IfConversionHandler(Context & ctx) : ctx_(ctx) {}
+
   /// Transform function itself, entry point to SinglePass
   std::string transform(const clang::TranslationUnitDecl * tu_decl);
 
@@ -40,8 +43,9 @@ class IfConversionHandler {
   std::string if_convert_atomic_stmt(const clang::BinaryOperator * stmt,
                                      const std::string & predicate) const;
 
-  /// Unique identifier generator
-  UniqueIdentifiers unique_identifiers_ = UniqueIdentifiers(std::set<std::string>());
+  /// Context of the program being if-converted,
+  /// whose NameAllocator names the branch temporaries
+  Context & ctx_;
 };
 
 #endif  // IF_CONVERSION_HANDLER_H_
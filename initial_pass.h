@@ -7,8 +7,10 @@
 
 #include "clang/AST/Decl.h"
 
+#include "context.h"
 
-std::string initial_pass_transform(const clang::TranslationUnitDecl * tu_decl);
+
+std::string initial_pass_transform(const clang::TranslationUnitDecl * tu_decl, Context & ctx);
 
 
 #endif
\ No newline at end of file
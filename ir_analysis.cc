@@ -0,0 +1,61 @@
+#include "ir_analysis.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+bool ir_in_ssa(const IrProgram & program) {
+  if (not program.analyses.in_ssa) program.analyses.in_ssa = ir_is_in_ssa(program);
+  return *program.analyses.in_ssa;
+}
+
+bool ir_in_flat_form(const IrProgram & program) {
+  if (not program.analyses.flat) {
+    program.analyses.flat = std::all_of(program.body.begin(), program.body.end(),
+                                        [] (const IrStmt & stmt) { return ir_is_flat(stmt.rhs); });
+  }
+  return *program.analyses.flat;
+}
+
+const std::set<std::string> & ir_census(const IrProgram & program) {
+  if (program.analyses.census == nullptr) {
+    program.analyses.census = std::make_shared<const std::set<std::string>>(ir_identifier_census(program));
+  }
+  return *program.analyses.census;
+}
+
+NameAllocator & ir_names(const IrProgram & program, Context & ctx) {
+  if (not program.analyses.names_reserved) {
+    ctx.Names().reserve(ir_census(program));
+    program.analyses.names_reserved = true;
+  }
+  return ctx.Names();
+}
+
+void ir_invalidate_analyses(const IrProgram & program, const IrAnalysisSet & preserved) {
+  auto & analyses = program.analyses;
+  if (preserved.count(IrAnalysis::SSA) == 0) analyses.in_ssa.reset();
+  if (preserved.count(IrAnalysis::FLAT) == 0) analyses.flat.reset();
+  if (preserved.count(IrAnalysis::CENSUS) == 0) analyses.census = nullptr;
+  if (preserved.count(IrAnalysis::DEF_USE) == 0) analyses.def_use = nullptr;
+}
+
+IrTransformer ir_pass(const std::string & pass_name, const IrTransformer & transform,
+                      const IrAnalysisSet & required, const IrAnalysisSet & preserved) {
+  return [pass_name, transform, required, preserved] (IrProgram & program, Context & ctx) {
+#ifdef DOMINO_CHECKED
+    if (required.count(IrAnalysis::SSA) != 0 and not ir_in_ssa(program)) {
+      throw std::logic_error(pass_name + " can be run only after SSA. "
+                             "It relies on variables not being redefined\n");
+    }
+    if (required.count(IrAnalysis::FLAT) != 0 and not ir_in_flat_form(program)) {
+      throw std::logic_error(pass_name + " can be run only after expr_flattener\n");
+    }
+#else
+    static_cast<void>(required);
+#endif
+    const bool changed = transform(program, ctx);
+    if (changed) ir_invalidate_analyses(program, preserved);
+    return changed;
+  };
+}
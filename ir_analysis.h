@@ -0,0 +1,43 @@
+#ifndef IR_ANALYSIS_H_
+#define IR_ANALYSIS_H_
+
+#include <set>
+#include <string>
+
+#include "context.h"
+#include "domino_ir.h"
+#include "name_allocator.h"
+#include "ir_transforms.h"
+
+/// Analyses of an IrProgram that passes share. Each is computed at most
+/// once per version of the program and cached in it (IrProgram::analyses)
+/// instead of every pass recomputing what it needs on entry.
+/// SSA and FLAT double as properties a pass can require of its input.
+enum class IrAnalysis { SSA, FLAT, CENSUS, DEF_USE };
+
+typedef std::set<IrAnalysis> IrAnalysisSet;
+
+/// Cached ir_is_in_ssa(program)
+bool ir_in_ssa(const IrProgram & program);
+
+/// Cached check that every right-hand side in program is ir_is_flat
+bool ir_in_flat_form(const IrProgram & program);
+
+/// Cached ir_identifier_census(program)
+const std::set<std::string> & ir_census(const IrProgram & program);
+
+/// NameAllocator of ctx, with all identifiers of program reserved in it
+NameAllocator & ir_names(const IrProgram & program, Context & ctx);
+
+/// Forget the analyses of program that aren't in preserved
+void ir_invalidate_analyses(const IrProgram & program, const IrAnalysisSet & preserved);
+
+/// Wrap transform as the pass pass_name, declaring what it requires of the
+/// program it runs on and which analyses stay valid when it changes it.
+/// Whenever transform changes the program, the analyses it doesn't preserve
+/// are invalidated. Only checked builds (configure --enable-checked) verify
+/// required, throwing std::logic_error naming pass_name if it doesn't hold.
+IrTransformer ir_pass(const std::string & pass_name, const IrTransformer & transform,
+                      const IrAnalysisSet & required, const IrAnalysisSet & preserved);
+
+#endif  // IR_ANALYSIS_H_
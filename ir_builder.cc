@@ -0,0 +1,154 @@
+#include "ir_builder.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "clang/AST/ASTConsumer.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Expr.h"
+
+#include "third_party/assert_exception.h"
+
+#include "clang_utility_functions.h"
+#include "parse_session.h"
+#include "pkt_func_transform.h"
+
+using namespace clang;
+
+namespace {
+
+IrExprPtr build_expr(const Expr * expr) {
+  assert_exception(expr);
+  if (isa<ParenExpr>(expr)) {
+    return ir_paren(build_expr(dyn_cast<ParenExpr>(expr)->getSubExpr()));
+  } else if (isa<CastExpr>(expr)) {
+    return build_expr(dyn_cast<CastExpr>(expr)->getSubExpr());
+  } else if (isa<IntegerLiteral>(expr)) {
+    return ir_int(dyn_cast<IntegerLiteral>(expr)->getValue().getSExtValue());
+  } else if (isa<MemberExpr>(expr)) {
+    return ir_pkt_field(dyn_cast<MemberExpr>(expr)->getMemberDecl()->getNameAsString());
+  } else if (isa<DeclRefExpr>(expr)) {
+    return ir_state_var(dyn_cast<DeclRefExpr>(expr)->getDecl()->getNameAsString());
+  } else if (isa<UnaryOperator>(expr)) {
+    const auto * un_op = dyn_cast<UnaryOperator>(expr);
+    assert_exception(un_op->isArithmeticOp());
+    return ir_unary(std::string(UnaryOperator::getOpcodeStr(un_op->getOpcode())),
+                    build_expr(un_op->getSubExpr()));
+  } else if (isa<BinaryOperator>(expr)) {
+    const auto * bin_op = dyn_cast<BinaryOperator>(expr);
+    if (bin_op->isAssignmentOp() or bin_op->isCommaOp()) {
+      throw std::logic_error("Domino IR cannot handle side effects within expression " + clang_stmt_printer(expr));
+    }
+    return ir_binary(std::string(bin_op->getOpcodeStr()),
+                     build_expr(bin_op->getLHS()), build_expr(bin_op->getRHS()));
+  } else if (isa<ConditionalOperator>(expr)) {
+    const auto * cond_op = dyn_cast<ConditionalOperator>(expr);
+    return ir_ternary(build_expr(cond_op->getCond()),
+                      build_expr(cond_op->getTrueExpr()),
+                      build_expr(cond_op->getFalseExpr()));
+  } else if (isa<CallExpr>(expr)) {
+    const auto * call_expr = dyn_cast<CallExpr>(expr);
+    std::vector<IrExprPtr> args;
+    for (const auto * arg : call_expr->arguments()) args.emplace_back(build_expr(arg));
+    return ir_call(clang_stmt_printer(call_expr->getCallee()), args);
+  } else {
+    throw std::logic_error("Domino IR cannot handle expr " + clang_stmt_printer(expr) +
+                           " of type " + std::string(expr->getStmtClassName()));
+  }
+}
+
+/// Names of a function and its parameters, for the identifier census
+void add_func_identifiers(const FunctionDecl * func_decl, IrProgram & program) {
+  program.func_identifiers.emplace(func_decl->getNameAsString());
+  for (const auto * parm_decl : func_decl->parameters()) {
+    program.func_identifiers.emplace(parm_decl->getNameAsString());
+  }
+}
+
+void build_pkt_func(const FunctionDecl * function_decl, IrProgram & program) {
+  assert_exception(function_decl->getNumParams() >= 1);
+  const auto * pkt_param = function_decl->getParamDecl(0);
+  program.func_return_type = function_decl->getReturnType().getAsString();
+  program.func_name = function_decl->getNameInfo().getName().getAsString();
+  program.pkt_type = pkt_param->getType().getAsString();
+  program.pkt_name = clang_value_decl_printer(pkt_param);
+
+  assert_exception(isa<CompoundStmt>(function_decl->getBody()));
+  for (const auto * child : function_decl->getBody()->children()) {
+    if (not (isa<BinaryOperator>(child) and dyn_cast<BinaryOperator>(child)->getOpcode() == BO_Assign)) {
+      throw std::logic_error("Domino IR needs a packet function made up of assignments alone (run if_converter first), got " +
+                             clang_stmt_printer(child));
+    }
+    const auto * bin_op = dyn_cast<BinaryOperator>(child);
+    program.body.emplace_back(IrStmt{build_expr(bin_op->getLHS()), build_expr(bin_op->getRHS())});
+  }
+}
+
+}  // namespace
+
+IrProgram ir_build_program(const TranslationUnitDecl * tu_decl) {
+  assert_exception(tu_decl);
+  std::vector<const Decl*> all_decls;
+  for (const auto * decl : dyn_cast<DeclContext>(tu_decl)->decls())
+    all_decls.emplace_back(decl);
+
+  std::stable_sort(all_decls.begin(),
+            all_decls.end(),
+            [] (const auto * decl1, const auto * decl2)
+            { return get_order(decl1) < get_order(decl2); });
+
+  IrProgram program;
+  bool seen_pkt_func = false;
+  bool seen_record = false;
+  for (const auto * child_decl : all_decls) {
+    if (isa<VarDecl>(child_decl)) {
+      const auto * var_decl = dyn_cast<VarDecl>(child_decl);
+      program.state_vars.emplace_back(IrStateVar{var_decl->getNameAsString(),
+                                                 clang_decl_printer(child_decl),
+                                                 var_decl->getType().getAsString(),
+                                                 isa<ConstantArrayType>(var_decl->getType().getTypePtrOrNull())});
+    } else if (isa<FunctionDecl>(child_decl) and (not is_packet_func(dyn_cast<FunctionDecl>(child_decl)))) {
+      program.scalar_funcs += generate_scalar_func_def(dyn_cast<FunctionDecl>(child_decl));
+      add_func_identifiers(dyn_cast<FunctionDecl>(child_decl), program);
+    } else if (isa<FunctionDecl>(child_decl)) {
+      if (seen_pkt_func) throw std::logic_error("Domino IR supports only one packet function");
+      seen_pkt_func = true;
+      build_pkt_func(dyn_cast<FunctionDecl>(child_decl), program);
+      add_func_identifiers(dyn_cast<FunctionDecl>(child_decl), program);
+    } else if (isa<RecordDecl>(child_decl)) {
+      assert_exception(dyn_cast<RecordDecl>(child_decl)->isStruct());
+      if (seen_record) throw std::logic_error("Domino IR supports only one packet structure");
+      seen_record = true;
+      program.record_name = dyn_cast<RecordDecl>(child_decl)->getNameAsString();
+      for (const auto * field_decl : dyn_cast<DeclContext>(child_decl)->decls()) {
+        program.fields.emplace_back(IrField{dyn_cast<ValueDecl>(field_decl)->getType().getAsString(),
+                                            clang_value_decl_printer(dyn_cast<ValueDecl>(field_decl))});
+      }
+    }
+  }
+  return program;
+}
+
+namespace {
+
+/// ASTConsumer that builds the IR for the translation unit it's handed
+class IrBuilderConsumer : public ASTConsumer {
+ public:
+  void HandleTranslationUnit(ASTContext & context) override {
+    program_ = ir_build_program(context.getTranslationUnitDecl());
+  }
+
+  /// Get the IR built by the last parse
+  const IrProgram & program() const { return program_; }
+
+ private:
+  IrProgram program_ = {};
+};
+
+}  // namespace
+
+IrProgram ir_parse_program(const std::string & string_to_parse) {
+  IrBuilderConsumer consumer;
+  ParseSession::get().parse(string_to_parse, consumer);
+  return consumer.program();
+}
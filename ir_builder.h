@@ -0,0 +1,19 @@
+#ifndef IR_BUILDER_H_
+#define IR_BUILDER_H_
+
+#include <string>
+
+#include "clang/AST/Decl.h"
+
+#include "domino_ir.h"
+
+/// Build the IR for a translation unit that has been through if_converter:
+/// the packet function must be a list of assignments, and arrays must
+/// have been replaced by scalars (array_replacer).
+/// Throws std::logic_error on anything else.
+IrProgram ir_build_program(const clang::TranslationUnitDecl * tu_decl);
+
+/// Parse string_to_parse with the shared ParseSession and build its IR
+IrProgram ir_parse_program(const std::string & string_to_parse);
+
+#endif  // IR_BUILDER_H_
@@ -0,0 +1,36 @@
+#include "ir_def_use.h"
+
+#include "third_party/assert_exception.h"
+
+IrDefUse::IrDefUse(const IrProgram & program, SymbolTable & symbols)
+    : stmts_(program.body), pkt_name_(program.pkt_name) {
+  std::vector<Symbol> var_list;
+  for (const auto & stmt : stmts_) {
+    var_list.clear();
+    ir_collect_var_symbols(ir_strip_parens(stmt.rhs), pkt_name_, symbols, var_list);
+    used_.emplace_back(var_list);
+    defined_.emplace_back(ir_var_symbol(ir_strip_parens(stmt.lhs), pkt_name_, symbols));
+  }
+
+  defs_.assign(symbols.size(), kNoDef);
+  uses_.resize(symbols.size());
+  for (size_t i = 0; i < stmts_.size(); i++) {
+    for (const auto var : used_.at(i)) uses_.at(var).emplace_back(i);
+    defs_.at(defined_.at(i)) = i;
+  }
+}
+
+bool IrDefUse::describes(const IrProgram & program) const {
+  if (program.pkt_name != pkt_name_ or program.body.size() != stmts_.size()) return false;
+  for (size_t i = 0; i < stmts_.size(); i++) {
+    if (program.body[i].lhs != stmts_[i].lhs or program.body[i].rhs != stmts_[i].rhs) return false;
+  }
+  return true;
+}
+
+std::shared_ptr<const IrDefUse> ir_def_use(const IrProgram & program, SymbolTable & symbols) {
+  if (program.analyses.def_use == nullptr or not program.analyses.def_use->describes(program)) {
+    program.analyses.def_use = std::make_shared<const IrDefUse>(program, symbols);
+  }
+  return program.analyses.def_use;
+}
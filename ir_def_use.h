@@ -0,0 +1,68 @@
+#ifndef IR_DEF_USE_H_
+#define IR_DEF_USE_H_
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "domino_ir.h"
+#include "symbol_table.h"
+
+/// Def-use index of the body of an IrProgram: for every statement, the
+/// variable it defines and the variables it reads, and for every variable,
+/// the statement defining it and the statements reading it, all by Symbol.
+/// Passes after ssa used to rebuild these maps from printed names with a
+/// walk over the whole body each; ir_def_use builds them once per body.
+class IrDefUse {
+ public:
+  /// def() of variables that no statement defines
+  static constexpr size_t kNoDef = std::numeric_limits<size_t>::max();
+
+  /// Index program.body, interning variable names into symbols
+  IrDefUse(const IrProgram & program, SymbolTable & symbols);
+
+  /// Is this the index of program's body as it is now? Expressions are
+  /// immutable, so it is if every statement still holds the same lhs and rhs.
+  bool describes(const IrProgram & program) const;
+
+  /// Number of statements
+  size_t size() const { return stmts_.size(); }
+
+  /// Variable defined by statement i
+  Symbol defined(const size_t i) const { return defined_.at(i); }
+
+  /// Variables read by statement i
+  const SymbolSet & used(const size_t i) const { return used_.at(i); }
+
+  /// Statement defining var, the last one if there are several (outside SSA),
+  /// or kNoDef if it's only read
+  size_t def(const Symbol var) const { return var < defs_.size() ? defs_[var] : kNoDef; }
+
+  /// Statements reading var, in increasing order, each once
+  const std::vector<size_t> & uses(const Symbol var) const {
+    return var < uses_.size() ? uses_[var] : no_uses_;
+  }
+
+ private:
+  /// Statements indexed, which keep their expressions alive for describes()
+  std::vector<IrStmt> stmts_;
+  std::string pkt_name_;
+
+  /// By statement
+  std::vector<Symbol> defined_ = {};
+  std::vector<SymbolSet> used_ = {};
+
+  /// By variable
+  std::vector<size_t> defs_ = {};
+  std::vector<std::vector<size_t>> uses_ = {};
+  const std::vector<size_t> no_uses_ = {};
+};
+
+/// Def-use index of program.body, built only if the body changed since the
+/// last call. Hold on to the result for as long as it's used: a later call
+/// on a changed body replaces the cached index.
+std::shared_ptr<const IrDefUse> ir_def_use(const IrProgram & program, SymbolTable & symbols);
+
+#endif  // IR_DEF_USE_H_
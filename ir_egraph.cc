@@ -0,0 +1,472 @@
+#include "ir_egraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <tuple>
+
+#include "third_party/assert_exception.h"
+
+namespace {
+
+/// Rules of ir_egraph_rules. Each only has to hold in one direction:
+/// commutativity lets associativity reach every grouping, and extraction
+/// is free to pick the original side of any of them. && and || keep the
+/// order of their operands, because the left one may guard the right one,
+/// e.g., p.x != 0 && 10 / p.x > 1, so they get associativity both ways.
+const char * const kEGraphRules = R"(
+# Commutativity and associativity
+?x + ?y => ?y + ?x
+?x * ?y => ?y * ?x
+?x & ?y => ?y & ?x
+?x | ?y => ?y | ?x
+?x ^ ?y => ?y ^ ?x
+?x == ?y => ?y == ?x
+?x != ?y => ?y != ?x
+(?x + ?y) + ?z => ?x + (?y + ?z)
+(?x * ?y) * ?z => ?x * (?y * ?z)
+(?x & ?y) & ?z => ?x & (?y & ?z)
+(?x | ?y) | ?z => ?x | (?y | ?z)
+(?x ^ ?y) ^ ?z => ?x ^ (?y ^ ?z)
+(?x && ?y) && ?z => ?x && (?y && ?z)
+?x && (?y && ?z) => (?x && ?y) && ?z
+(?x || ?y) || ?z => ?x || (?y || ?z)
+?x || (?y || ?z) => (?x || ?y) || ?z
+
+# Subtraction, exact in wrapping arithmetic
+(?x + ?y) - ?z => ?x + (?y - ?z)
+?x + (?y - ?z) => (?x + ?y) - ?z
+(?x - ?y) - ?z => ?x - (?y + ?z)
+?x - (?y + ?z) => (?x - ?y) - ?z
+?x - (?y - ?z) => (?x - ?y) + ?z
+?x + -?y => ?x - ?y
+?x - -?y => ?x + ?y
+-(?x - ?y) => ?y - ?x
+-(-?x) => ?x
+
+# Identities and annihilators
+?x + 0 => ?x
+?x - 0 => ?x
+?x - ?x => 0
+?x * 1 => ?x
+?x * 0 => 0
+?x & 0 => 0
+?x & ?x => ?x
+?x | 0 => ?x
+?x | ?x => ?x
+?x ^ 0 => ?x
+?x ^ ?x => 0
+?x << 0 => ?x
+?x >> 0 => ?x
+?x && 0 => 0
+?x || #c => 1 if #c != 0
+
+# Factoring
+?x * ?y + ?x * ?z => ?x * (?y + ?z)
+?x * ?y - ?x * ?z => ?x * (?y - ?z)
+?x * ?y + ?x => ?x * (?y + 1)
+(?x & ?y) | (?x & ?z) => ?x & (?y | ?z)
+(?x | ?y) & (?x | ?z) => ?x | (?y & ?z)
+
+# Comparisons
+?x > ?y => ?y < ?x
+?x >= ?y => ?y <= ?x
+?x == ?x => 1
+?x != ?x => 0
+?x < ?x => 0
+?x <= ?x => 1
+!(?x < ?y) => ?y <= ?x
+!(?x <= ?y) => ?y < ?x
+!(?x == ?y) => ?x != ?y
+!(?x != ?y) => ?x == ?y
+
+# Muxes
+#c ? ?x : ?y => ?x if #c != 0
+#c ? ?x : ?y => ?y if #c == 0
+?c ? ?x : ?x => ?x
+!?c ? ?x : ?y => ?c ? ?y : ?x
+(?a != ?b) ? ?x : ?y => (?a == ?b) ? ?y : ?x
+?c ? (?c ? ?x : ?y) : ?z => ?c ? ?x : ?z
+?c ? ?x : (?c ? ?y : ?z) => ?c ? ?x : ?z
+?a ? (?b ? ?x : ?y) : ?y => ?a && ?b ? ?x : ?y
+?a ? ?x : (?b ? ?x : ?y) => ?a || ?b ? ?x : ?y
+?c ? ?x + ?y : ?x + ?z => ?x + (?c ? ?y : ?z)
+?c ? ?x - ?y : ?x - ?z => ?x - (?c ? ?y : ?z)
+?c ? ?y - ?x : ?z - ?x => (?c ? ?y : ?z) - ?x
+?c ? ?x * ?y : ?x * ?z => ?x * (?c ? ?y : ?z)
+(?x < ?y) ? 1 : 0 => ?x < ?y
+(?x <= ?y) ? 1 : 0 => ?x <= ?y
+(?x == ?y) ? 1 : 0 => ?x == ?y
+(?x != ?y) ? 1 : 0 => ?x != ?y
+?c ? 0 : 1 => !?c
+)";
+
+/// Does a statement touch state, i.e., is it one of stateful_flanks's
+/// reads or writes (or, before stateful_flanks, any stateful code)?
+bool is_stateful(const IrExprPtr & expr) {
+  if (expr->kind == IrExprKind::STATE_VAR) return true;
+  return std::any_of(expr->operands.begin(), expr->operands.end(), is_stateful);
+}
+
+/// Is every literal in expr an int? The e-graph computes on ints as
+/// ir_evaluate does, wrapping at 32 bits, but C gives a literal such as
+/// 2147483648 a wider type, in which, e.g., p.x < 2147483648 always holds.
+bool has_int_literals_only(const IrExprPtr & expr) {
+  if (expr->kind == IrExprKind::INT_LITERAL) {
+    return expr->value >= INT32_MIN and expr->value <= INT32_MAX;
+  }
+  return std::all_of(expr->operands.begin(), expr->operands.end(), has_int_literals_only);
+}
+
+}  // namespace
+
+IrCost ir_cost(const IrExprPtr & expr) {
+  const auto & subject = ir_strip_parens(expr);
+  if (subject->operands.empty() and subject->kind != IrExprKind::CALL) return {0, 0};
+  IrCost ret = {1, 1};
+  for (const auto & operand : subject->operands) {
+    const auto cost = ir_cost(operand);
+    ret.alus += cost.alus;
+    ret.depth = std::max(ret.depth, cost.depth + 1);
+  }
+  return ret;
+}
+
+std::map<std::string, int64_t> IrEGraph::Substitution::const_values() const {
+  std::map<std::string, int64_t> ret;
+  for (const auto & binding : consts) ret.emplace(*binding.first, binding.second);
+  return ret;
+}
+
+bool IrEGraph::Node::operator<(const Node & other) const {
+  return std::tie(kind, name, value, operands) < std::tie(other.kind, other.name, other.value, other.operands);
+}
+
+IrEGraph::ClassId IrEGraph::find(ClassId id) const {
+  while (parents_.at(id) != id) {
+    parents_.at(id) = parents_.at(parents_.at(id));
+    id = parents_.at(id);
+  }
+  return id;
+}
+
+IrEGraph::ClassId IrEGraph::add(const IrExprPtr & expr) {
+  const auto & subject = ir_strip_parens(expr);
+  Node node = {subject->kind, subject->name, subject->kind == IrExprKind::INT_LITERAL ? subject->value : 0, {}};
+  for (const auto & operand : subject->operands) node.operands.emplace_back(add(operand));
+  return add(node);
+}
+
+IrEGraph::ClassId IrEGraph::add(Node node) {
+  for (auto & operand : node.operands) operand = find(operand);
+  const auto it = memo_.find(node);
+  if (it != memo_.end()) return find(it->second);
+
+  const ClassId id = parents_.size();
+  parents_.emplace_back(id);
+  classes_.push_back({node});
+  memo_.emplace(node, id);
+  best_.clear();
+  return id;
+}
+
+bool IrEGraph::merge(ClassId a, ClassId b) {
+  a = find(a);
+  b = find(b);
+  if (a == b) return false;
+
+  // Never give one class two values. Leaving out an equality
+  // only ever costs an optimization.
+  int64_t value_a, value_b;
+  if (constant(a, value_a) and constant(b, value_b) and value_a != value_b) return false;
+  if (classes_.at(a).size() < classes_.at(b).size()) std::swap(a, b);
+  parents_.at(b) = a;
+  auto & nodes = classes_.at(a);
+  nodes.insert(nodes.end(), classes_.at(b).begin(), classes_.at(b).end());
+  classes_.at(b).clear();
+  best_.clear();
+  return true;
+}
+
+void IrEGraph::rebuild() {
+  // Merging classes can make two nodes equal, whose classes must then be
+  // merged in turn, so canonicalize everything until that stops
+  best_.clear();
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    memo_.clear();
+    for (ClassId id = 0; id < classes_.size(); id++) {
+      auto & nodes = classes_.at(id);
+      for (auto & node : nodes) {
+        for (auto & operand : node.operands) operand = find(operand);
+      }
+      std::sort(nodes.begin(), nodes.end());
+      nodes.erase(std::unique(nodes.begin(), nodes.end(),
+                              [] (const Node & a, const Node & b) { return not (a < b) and not (b < a); }),
+                  nodes.end());
+    }
+    for (ClassId id = 0; id < classes_.size(); id++) {
+      for (const auto & node : std::vector<Node>(classes_.at(id))) {
+        const auto it = memo_.emplace(node, id).first;
+        merged = merge(it->second, id) or merged;
+      }
+    }
+  }
+}
+
+bool IrEGraph::constant(const ClassId id, int64_t & value) const {
+  for (const auto & node : classes_.at(find(id))) {
+    if (node.kind == IrExprKind::INT_LITERAL) {
+      value = node.value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IrEGraph::fold_constants() {
+  std::vector<std::pair<ClassId, int64_t>> folded;
+  for (ClassId id = 0; id < classes_.size(); id++) {
+    int64_t value;
+    if (classes_.at(id).empty() or constant(id, value)) continue;
+    for (const auto & node : classes_.at(id)) {
+      if (node.operands.empty() or node.kind == IrExprKind::CALL) continue;
+      std::vector<IrExprPtr> operands;
+      for (const auto operand : node.operands) {
+        if (not constant(operand, value)) break;
+        operands.emplace_back(ir_int(value));
+      }
+      if (operands.size() == node.operands.size() and
+          ir_evaluate(std::make_shared<const IrExpr>(IrExpr{node.kind, node.name, 0, operands}), value)) {
+        folded.emplace_back(id, value);
+        break;
+      }
+    }
+  }
+  for (const auto & fold : folded) merge(fold.first, add(Node{IrExprKind::INT_LITERAL, "", fold.second, {}}));
+  return not folded.empty();
+}
+
+void IrEGraph::ematch(const IrRuleSet::Pattern & pattern, const ClassId id, const Substitution & substitution,
+                      const size_t limit, std::vector<Substitution> & matches) const {
+  typedef IrRuleSet::Pattern::Kind Kind;
+  if (matches.size() > limit) return;
+  switch (pattern.kind) {
+    case Kind::ANY: {
+      const auto bound = std::find_if(substitution.classes.begin(), substitution.classes.end(),
+                                      [&pattern] (const auto & binding) { return *binding.first == pattern.var; });
+      if (bound == substitution.classes.end()) {
+        matches.emplace_back(substitution);
+        matches.back().classes.emplace_back(&pattern.var, find(id));
+      } else if (find(bound->second) == find(id)) {
+        matches.emplace_back(substitution);
+      }
+      return;
+    }
+    case Kind::CONST: {
+      int64_t value;
+      if (not constant(id, value)) return;
+      const auto bound = std::find_if(substitution.consts.begin(), substitution.consts.end(),
+                                      [&pattern] (const auto & binding) { return *binding.first == pattern.var; });
+      if (bound == substitution.consts.end()) {
+        matches.emplace_back(substitution);
+        matches.back().consts.emplace_back(&pattern.var, value);
+      } else if (bound->second == value) {
+        matches.emplace_back(substitution);
+      }
+      return;
+    }
+    case Kind::EXPR:
+      for (const auto & node : classes_.at(find(id))) {
+        if (matches.size() > limit) return;
+        if (node.kind != pattern.expr_kind or node.name != pattern.name or
+            node.operands.size() != pattern.operands.size() or
+            (node.kind == IrExprKind::INT_LITERAL and node.value != pattern.value)) continue;
+
+        // Match the operands left to right, each against every partial match so far
+        std::vector<Substitution> partial = {substitution};
+        for (size_t i = 0; i < node.operands.size() and not partial.empty(); i++) {
+          std::vector<Substitution> extended;
+          for (const auto & candidate : partial) {
+            ematch(pattern.operands.at(i), node.operands.at(i), candidate, limit - matches.size(), extended);
+          }
+          partial.swap(extended);
+        }
+        matches.insert(matches.end(), partial.begin(), partial.end());
+      }
+      return;
+  }
+}
+
+IrEGraph::ClassId IrEGraph::instantiate(const IrRuleSet::Pattern & replacement, const Substitution & substitution,
+                                        const std::map<std::string, int64_t> & const_values) {
+  int64_t value;
+  if (IrRuleSet::evaluate(replacement, const_values, value)) return add(Node{IrExprKind::INT_LITERAL, "", value, {}});
+  assert_exception(replacement.kind != IrRuleSet::Pattern::Kind::CONST);
+  if (replacement.kind == IrRuleSet::Pattern::Kind::ANY) {
+    for (const auto & binding : substitution.classes) {
+      if (*binding.first == replacement.var) return binding.second;
+    }
+    assert_exception(false);
+  }
+  Node node = {replacement.expr_kind, replacement.name, replacement.value, {}};
+  for (const auto & operand : replacement.operands) {
+    node.operands.emplace_back(instantiate(operand, substitution, const_values));
+  }
+  return add(node);
+}
+
+bool IrEGraph::apply(const IrRuleSet & rules, const size_t round, const IrEGraphBudget & budget,
+                     const Deadline deadline, Schedule & schedule) {
+  // Find all matches before applying any, so that no rule
+  // gets to see (and race ahead on) what another one added this round
+  std::vector<std::tuple<const IrRuleSet::Rule *, ClassId, Substitution>> matches;
+
+  // Patterns are never bare variables, so only classes with a node
+  // like the root of a pattern can match it
+  typedef std::tuple<IrExprKind, std::string, size_t> RootKey;
+  std::map<RootKey, std::vector<ClassId>> roots;
+  for (ClassId id = 0; id < classes_.size(); id++) {
+    for (const auto & node : classes_.at(id)) {
+      auto & with_root = roots[RootKey(node.kind, node.name, node.operands.size())];
+      if (with_root.empty() or with_root.back() != id) with_root.emplace_back(id);
+    }
+  }
+
+  for (size_t i = 0; i < rules.rules().size(); i++) {
+    if (schedule.banned_until.at(i) > round) continue;
+    if (std::chrono::steady_clock::now() >= deadline) break;
+    const auto & rule = rules.rules().at(i);
+    const size_t limit = budget.max_matches << schedule.bans.at(i);
+    const size_t first = matches.size();
+    const auto candidates = roots.find(RootKey(rule.pattern.expr_kind, rule.pattern.name, rule.pattern.operands.size()));
+    if (candidates == roots.end()) continue;
+    for (const auto id : candidates->second) {
+      if (matches.size() - first > limit) break;
+      std::vector<Substitution> substitutions;
+      ematch(rule.pattern, id, Substitution(), limit - (matches.size() - first), substitutions);
+      for (const auto & substitution : substitutions) {
+        const auto const_values = substitution.const_values();
+        const bool holds = std::all_of(rule.conditions.begin(), rule.conditions.end(),
+                                       [&const_values] (const auto & condition) {
+                                         int64_t value;
+                                         return IrRuleSet::evaluate(condition, const_values, value) and value != 0;
+                                       });
+        if (holds) matches.emplace_back(&rule, id, substitution);
+      }
+    }
+    if (matches.size() - first > limit) {
+      matches.resize(first);
+      schedule.banned_until.at(i) = round + 1 + (size_t(1) << schedule.bans.at(i));
+      schedule.bans.at(i)++;
+    }
+  }
+
+  bool changed = false;
+  for (const auto & match : matches) {
+    if (size() >= budget.max_nodes) break;
+    const auto & substitution = std::get<2>(match);
+    const ClassId replaced = instantiate(std::get<0>(match)->replacement, substitution, substitution.const_values());
+    changed = merge(std::get<1>(match), replaced) or changed;
+  }
+  changed = fold_constants() or changed;
+  rebuild();
+  return changed;
+}
+
+bool IrEGraph::saturate(const IrRuleSet & rules, const IrEGraphBudget & budget) {
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(budget.max_seconds));
+  Schedule schedule = {std::vector<size_t>(rules.rules().size(), 0), std::vector<size_t>(rules.rules().size(), 0)};
+  for (size_t round = 0; round < budget.max_rounds; round++) {
+    if (size() >= budget.max_nodes or std::chrono::steady_clock::now() >= deadline) return false;
+    if (apply(rules, round, budget, deadline, schedule)) continue;
+
+    // Nothing changed, but that only means saturation if no rule sat this round out
+    const bool banned = std::any_of(schedule.banned_until.begin(), schedule.banned_until.end(),
+                                    [round] (const size_t until) { return until > round; });
+    if (not banned) return true;
+    std::fill(schedule.banned_until.begin(), schedule.banned_until.end(), 0);
+  }
+  return false;
+}
+
+void IrEGraph::compute_costs() {
+  if (not best_.empty()) return;
+  const IrCost unknown = {SIZE_MAX, SIZE_MAX};
+  best_.assign(classes_.size(), {unknown, nullptr});
+  extracted_.assign(classes_.size(), nullptr);
+
+  // Costs only go down, so this settles even though classes can contain themselves
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (ClassId id = 0; id < classes_.size(); id++) {
+      for (const auto & node : classes_.at(id)) {
+        IrCost cost = {0, 0};
+        if (not node.operands.empty() or node.kind == IrExprKind::CALL) cost = {1, 1};
+        bool known = true;
+        for (const auto operand : node.operands) {
+          const auto & operand_cost = best_.at(find(operand)).first;
+          if (best_.at(find(operand)).second == nullptr) {
+            known = false;
+            break;
+          }
+          cost.alus += operand_cost.alus;
+          cost.depth = std::max(cost.depth, operand_cost.depth + 1);
+        }
+        if (known and cost < best_.at(id).first) {
+          best_.at(id) = {cost, &node};
+          changed = true;
+        }
+      }
+    }
+  }
+}
+
+IrCost IrEGraph::cost(const ClassId id) {
+  compute_costs();
+  return best_.at(find(id)).first;
+}
+
+IrExprPtr IrEGraph::extract(const ClassId id) {
+  compute_costs();
+  const ClassId root = find(id);
+  if (extracted_.at(root) != nullptr) return extracted_.at(root);
+
+  // Every operand of a cheapest node is strictly cheaper than it, so this ends
+  const Node * node = best_.at(root).second;
+  assert_exception(node != nullptr);
+  std::vector<IrExprPtr> operands;
+  for (const auto operand : node->operands) operands.emplace_back(extract(operand));
+  extracted_.at(root) = std::make_shared<const IrExpr>(IrExpr{node->kind, node->name, node->value, operands});
+  return extracted_.at(root);
+}
+
+const IrRuleSet & ir_egraph_rules() {
+  static const IrRuleSet rules(kEGraphRules, "ir_egraph_rules");
+  return rules;
+}
+
+bool ir_egraph_transform(IrProgram & program, Context &) {
+  IrEGraph egraph;
+  std::vector<std::pair<size_t, IrEGraph::ClassId>> roots;
+  for (size_t i = 0; i < program.body.size(); i++) {
+    const auto & stmt = program.body.at(i);
+    if (is_stateful(stmt.lhs) or is_stateful(stmt.rhs) or not has_int_literals_only(stmt.rhs)) continue;
+    roots.emplace_back(i, egraph.add(stmt.rhs));
+  }
+  if (roots.empty()) return false;
+  egraph.saturate(ir_egraph_rules(), kDefaultEGraphBudget);
+
+  bool changed = false;
+  for (const auto & root : roots) {
+    auto & stmt = program.body.at(root.first);
+    if (not (egraph.cost(root.second) < ir_cost(stmt.rhs))) continue;
+    stmt = IrStmt{stmt.lhs, egraph.extract(root.second)};
+    changed = true;
+  }
+  return changed;
+}
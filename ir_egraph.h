@@ -0,0 +1,171 @@
+#ifndef IR_EGRAPH_H_
+#define IR_EGRAPH_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "context.h"
+#include "domino_ir.h"
+#include "ir_rules.h"
+
+/// Cost of an expression as CaT sees it: ALUs (operators and calls) first,
+/// then the depth of the longest chain of them. Variables and literals are free.
+struct IrCost {
+  size_t alus;
+  size_t depth;
+
+  bool operator<(const IrCost & other) const {
+    return alus != other.alus ? alus < other.alus : depth < other.depth;
+  }
+};
+
+/// Cost of expr as it stands; parentheses are free
+IrCost ir_cost(const IrExprPtr & expr);
+
+/// Limits on one saturation. Rewriting stops at the first one reached,
+/// and extraction picks the cheapest of what was found until then.
+struct IrEGraphBudget {
+  /// E-nodes in the graph
+  size_t max_nodes;
+
+  /// Rounds of applying every rule everywhere
+  size_t max_rounds;
+
+  /// Matches of one rule in one round. A rule that has more is left out
+  /// for a few rounds (twice as many every time) and allowed twice as
+  /// many matches when it's back, so that the rules whose matches grow
+  /// fastest, like associativity, can't use up the budget of all the others.
+  size_t max_matches;
+
+  /// Wall time, only there to stop pathological programs:
+  /// for everything else the other limits bind first,
+  /// so that the result doesn't depend on the machine
+  double max_seconds;
+};
+
+const IrEGraphBudget kDefaultEGraphBudget = {2000, 10, 200, 1.0};
+
+/// E-graph of IR expressions: classes of expressions known to be equal,
+/// each holding nodes whose operands are classes, so that a class
+/// represents every combination of its nodes' operands at once. Rules
+/// (ir_rules.h) add equalities instead of replacing expressions, so unlike
+/// greedy rewriting (algebra_simplify, flow_ite_simplify) no rewrite can
+/// rule out a better one, and the result doesn't depend on their order.
+/// Classes with a constant value also get that value as a literal.
+class IrEGraph {
+ public:
+  typedef size_t ClassId;
+
+  /// An expression node whose operands are classes
+  struct Node {
+    IrExprKind kind;
+    std::string name;
+    int64_t value;
+    std::vector<ClassId> operands;
+
+    bool operator<(const Node & other) const;
+  };
+
+  /// Class of expr, adding expr without its parentheses if it's new
+  ClassId add(const IrExprPtr & expr);
+
+  /// Canonical id of the class of id
+  ClassId find(ClassId id) const;
+
+  /// Number of distinct nodes
+  size_t size() const { return memo_.size(); }
+
+  /// Apply rules until nothing changes or budget runs out,
+  /// returning true in the first case, i.e., if the graph is saturated
+  bool saturate(const IrRuleSet & rules, const IrEGraphBudget & budget);
+
+  /// Cheapest expression in the class of id, and its cost
+  IrExprPtr extract(ClassId id);
+  IrCost cost(ClassId id);
+
+ private:
+  typedef std::chrono::steady_clock::time_point Deadline;
+
+  /// Round from which each rule may run again, and how often it was left out
+  struct Schedule {
+    std::vector<size_t> banned_until;
+    std::vector<size_t> bans;
+  };
+
+  /// What a pattern's variables (named by the pattern's own strings,
+  /// which outlive every match) were bound to
+  struct Substitution {
+    std::vector<std::pair<const std::string *, ClassId>> classes = {};
+    std::vector<std::pair<const std::string *, int64_t>> consts = {};
+
+    /// Values of the #variables, as IrRuleSet::evaluate takes them
+    std::map<std::string, int64_t> const_values() const;
+  };
+
+  /// Class of node, adding it if it's new
+  ClassId add(Node node);
+
+  /// Merge the classes of a and b, returning false if they are one already
+  /// or have different constants
+  bool merge(ClassId a, ClassId b);
+
+  /// Restore the invariants merges break: every node in memo_ with
+  /// canonical operands, and equal nodes (hence their classes) merged
+  void rebuild();
+
+  /// Literal value of the class of id, false if it has none
+  bool constant(ClassId id, int64_t & value) const;
+
+  /// Add the value of every node whose operands all have one to its class,
+  /// returning true if that changed anything
+  bool fold_constants();
+
+  /// Extend substitution with every way pattern matches the class of id,
+  /// appending them to matches until that holds more than limit
+  void ematch(const IrRuleSet::Pattern & pattern, ClassId id, const Substitution & substitution,
+              size_t limit, std::vector<Substitution> & matches) const;
+
+  /// Class of replacement under substitution, adding its nodes
+  ClassId instantiate(const IrRuleSet::Pattern & replacement, const Substitution & substitution,
+                      const std::map<std::string, int64_t> & const_values);
+
+  /// One round: find every match of every rule schedule lets run,
+  /// then apply them all, stopping early when budget or the time
+  /// runs out. Returns true if anything changed.
+  bool apply(const IrRuleSet & rules, size_t round, const IrEGraphBudget & budget,
+             Deadline deadline, Schedule & schedule);
+
+  /// Cheapest node of every class, recomputed after the graph changes
+  void compute_costs();
+
+  /// Union-find over class ids
+  mutable std::vector<ClassId> parents_ = {};
+
+  /// Nodes of every canonical class, empty for the others
+  std::vector<std::vector<Node>> classes_ = {};
+
+  /// Class of every node
+  std::map<Node, ClassId> memo_ = {};
+
+  /// Cheapest node of every class and its cost, empty if stale
+  std::vector<std::pair<IrCost, const Node *>> best_ = {};
+  std::vector<IrExprPtr> extracted_ = {};
+};
+
+/// Algebraic rewrites (commutativity, associativity, identities,
+/// factoring, cancellation, comparisons) and mux rewrites (identical arms,
+/// negated and repeated conditions, common operands pulled out of the arms)
+/// that ir_egraph_transform saturates with
+const IrRuleSet & ir_egraph_rules();
+
+/// Saturate the stateless statements, those between stateful_flanks's reads
+/// of state into packet fields and its writes back, in one e-graph with
+/// ir_egraph_rules, and replace every right-hand side with the cheapest
+/// expression equal to it, if that is cheaper than the one it has
+bool ir_egraph_transform(IrProgram & program, Context & ctx);
+
+#endif  // IR_EGRAPH_H_
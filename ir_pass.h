@@ -0,0 +1,79 @@
+#ifndef IR_PASS_H_
+#define IR_PASS_H_
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "compiler_pass.h"
+#include "domino_ir.h"
+#include "ir_builder.h"
+#include "ir_transforms.h"
+#include "pass_profiler.h"
+
+/// Called after every IR transform with its name and the program it produced
+typedef std::function<void(const std::string &, const IrProgram &)> IrPassObserver;
+
+/// A run of passes over the Domino IR, wrapped up as one CompilerPass.
+/// The input is parsed once, each transform rewrites the IR in place,
+/// and the result is printed once, instead of printing and re-parsing
+/// the whole program between every pair of passes.
+class IrPipelinePass : public CompilerPass {
+ public:
+  /// Construct an IrPipelinePass from named transforms, run in order
+  /// on the program whose context is t_ctx
+  IrPipelinePass(const std::vector<std::pair<std::string, IrTransformer>> & t_transforms,
+                 Context & t_ctx,
+                 const IrPassObserver & t_observer = nullptr)
+    : transforms_(t_transforms), ctx_(t_ctx), observer_(t_observer) {}
+
+  /// Execute IrPipelinePass object
+  std::string operator() (const std::string & string_to_parse) final override {
+    auto * profiler = PassProfiler::active();
+    if (profiler) return profiled_run(string_to_parse, *profiler);
+
+    IrProgram program = ir_parse_program(string_to_parse);
+    for (const auto & transform : transforms_) {
+      transform.second(program, ctx_);
+      if (observer_) observer_(transform.first, program);
+    }
+    return ir_print_program(program, ctx_);
+  }
+
+ private:
+  /// Same as operator(), also reporting each transform to profiler. To measure
+  /// what each transform did to the program, the program is printed after
+  /// each of them, which shows up in that transform's print time.
+  std::string profiled_run(const std::string & string_to_parse, PassProfiler & profiler) {
+    auto start = std::chrono::steady_clock::now();
+    IrProgram program = ir_parse_program(string_to_parse);
+    profiler.add_parse(seconds_since(start));
+
+    std::string text = string_to_parse;
+    for (const auto & transform : transforms_) {
+      profiler.begin_pass(transform.first, text);
+      start = std::chrono::steady_clock::now();
+      transform.second(program, ctx_);
+      profiler.add_transform(seconds_since(start));
+      start = std::chrono::steady_clock::now();
+      text = ir_print_program(program, ctx_);
+      profiler.add_print(seconds_since(start));
+      profiler.end_pass(text);
+      if (observer_) observer_(transform.first, program);
+    }
+    return text;
+  }
+
+  /// Transforms and their names, in the order they run
+  std::vector<std::pair<std::string, IrTransformer>> transforms_;
+
+  /// Context of the program being compiled
+  Context & ctx_;
+
+  /// Optional observer, e.g., for --debug
+  IrPassObserver observer_;
+};
+
+#endif  // IR_PASS_H_
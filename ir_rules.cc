@@ -0,0 +1,487 @@
+#include "ir_rules.h"
+
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include <stdexcept>
+
+#include "third_party/assert_exception.h"
+
+#include "ir_transforms.h"
+
+namespace {
+
+struct Token {
+  enum class Type { INT, ANY, CONST, IDENT, OP, END };
+  Type type;
+  std::string text;
+  int64_t value;
+};
+
+/// Operators, longest first so that the tokenizer is greedy
+const std::vector<std::string> kOperators = {"=>", "||", "&&", "==", "!=", "<=", ">=", "<<", ">>",
+                                             "+", "-", "*", "/", "%", "<", ">", "&", "|", "^",
+                                             "!", "~", "?", ":", "(", ")", ","};
+
+/// C precedence levels of binary operators, higher binds tighter
+int binary_precedence(const std::string & op) {
+  static const std::map<std::string, int> precedence = {
+      {"||", 1}, {"&&", 2}, {"|", 3}, {"^", 4}, {"&", 5}, {"==", 6}, {"!=", 6},
+      {"<", 7}, {"<=", 7}, {">", 7}, {">=", 7}, {"<<", 8}, {">>", 8},
+      {"+", 9}, {"-", 9}, {"*", 10}, {"/", 10}, {"%", 10}};
+  const auto it = precedence.find(op);
+  return it == precedence.end() ? 0 : it->second;
+}
+
+bool is_identifier_char(const char c) { return std::isalnum(static_cast<unsigned char>(c)) or c == '_'; }
+
+/// Position of the # starting a comment in line, or npos.
+/// A # directly followed by a name is a #variable instead.
+size_t comment_start(const std::string & line) {
+  for (size_t i = line.find('#'); i != std::string::npos; i = line.find('#', i + 1)) {
+    if (i + 1 == line.size() or not is_identifier_char(line.at(i + 1))) return i;
+  }
+  return std::string::npos;
+}
+
+/// Functions of constants that conditions and replacements can use
+bool is_builtin(const std::string & name) { return name == "pow2" or name == "log2"; }
+
+/// Recursive-descent parser for one line of a rules file
+class IrRuleParser {
+ public:
+  typedef IrRuleSet::Pattern Pattern;
+
+  IrRuleParser(const std::string & line, const std::string & location) : location_(location) {
+    tokenize(line);
+  }
+
+  bool at_end() const { return peek().type == Token::Type::END; }
+
+  bool accept(const std::string & op) {
+    if ((peek().type == Token::Type::OP or peek().type == Token::Type::IDENT) and peek().text == op) {
+      pos_++;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(const std::string & op) {
+    if (not accept(op)) error("expected " + op);
+  }
+
+  [[noreturn]] void error(const std::string & message) const {
+    const auto & token = peek();
+    throw std::logic_error(location_ + ": " + message +
+                           (token.type == Token::Type::END ? " at end of rule" : " before '" + token.text + "'"));
+  }
+
+  /// expr : binary ('?' expr ':' expr)?
+  Pattern parse_expr() {
+    Pattern cond = parse_binary(1);
+    if (not accept("?")) return cond;
+    Pattern true_expr = parse_expr();
+    expect(":");
+    Pattern false_expr = parse_expr();
+    return node(IrExprKind::TERNARY, "", {cond, true_expr, false_expr});
+  }
+
+ private:
+  /// Binary operators binding at least as tight as min_precedence, left associative
+  Pattern parse_binary(const int min_precedence) {
+    Pattern lhs = parse_unary();
+    while (peek().type == Token::Type::OP and binary_precedence(peek().text) >= min_precedence) {
+      const std::string op = peek().text;
+      pos_++;
+      Pattern rhs = parse_binary(binary_precedence(op) + 1);
+      lhs = node(IrExprKind::BINARY, op, {lhs, rhs});
+    }
+    return lhs;
+  }
+
+  Pattern parse_unary() {
+    for (const std::string op : {"-", "+", "!", "~"}) {
+      if (not accept(op)) continue;
+      Pattern operand = parse_unary();
+      // Signed literals are literals in the IR, e.g., -1 is INT_LITERAL(-1)
+      if ((op == "-" or op == "+") and operand.kind == Pattern::Kind::EXPR and
+          operand.expr_kind == IrExprKind::INT_LITERAL) {
+        if (op == "-") operand.value = -operand.value;
+        return operand;
+      }
+      return node(IrExprKind::UNARY, op, {operand});
+    }
+    return parse_primary();
+  }
+
+  Pattern parse_primary() {
+    const Token token = peek();
+    switch (token.type) {
+      case Token::Type::INT: {
+        pos_++;
+        Pattern ret = node(IrExprKind::INT_LITERAL, "", {});
+        ret.value = token.value;
+        return ret;
+      }
+      case Token::Type::ANY:
+      case Token::Type::CONST: {
+        pos_++;
+        Pattern ret = {token.type == Token::Type::ANY ? Pattern::Kind::ANY : Pattern::Kind::CONST,
+                       token.text, IrExprKind::INT_LITERAL, "", 0, {}};
+        return ret;
+      }
+      case Token::Type::IDENT: {
+        pos_++;
+        if (not accept("(")) error("variables must be written ?" + token.text + " or #" + token.text + ", found " + token.text);
+        std::vector<Pattern> args;
+        if (not accept(")")) {
+          do { args.emplace_back(parse_expr()); } while (accept(","));
+          expect(")");
+        }
+        return node(IrExprKind::CALL, token.text, args);
+      }
+      default:
+        if (accept("(")) {
+          Pattern ret = parse_expr();
+          expect(")");
+          return ret;
+        }
+        error("expected an expression");
+    }
+  }
+
+  static Pattern node(const IrExprKind kind, const std::string & name, const std::vector<Pattern> & operands) {
+    return Pattern{Pattern::Kind::EXPR, "", kind, name, 0, operands};
+  }
+
+  const Token & peek() const { return tokens_.at(pos_); }
+
+  void tokenize(const std::string & line) {
+    size_t i = 0;
+    while (i < line.size()) {
+      const char c = line.at(i);
+      if (std::isspace(static_cast<unsigned char>(c))) {
+        i++;
+      } else if (std::isdigit(static_cast<unsigned char>(c))) {
+        size_t end = i;
+        while (end < line.size() and is_identifier_char(line.at(end))) end++;
+        const auto text = line.substr(i, end - i);
+        try {
+          size_t parsed;
+          const int64_t value = std::stoll(text, &parsed, 0);
+          if (parsed != text.size()) throw std::invalid_argument(text);
+          tokens_.emplace_back(Token{Token::Type::INT, text, value});
+        } catch (const std::exception &) {
+          throw std::logic_error(location_ + ": malformed integer " + text);
+        }
+        i = end;
+      } else if ((c == '?' or c == '#') and i + 1 < line.size() and is_identifier_char(line.at(i + 1))) {
+        size_t end = i + 1;
+        while (end < line.size() and is_identifier_char(line.at(end))) end++;
+        tokens_.emplace_back(Token{c == '?' ? Token::Type::ANY : Token::Type::CONST, line.substr(i + 1, end - i - 1), 0});
+        i = end;
+      } else if (is_identifier_char(c)) {
+        size_t end = i;
+        while (end < line.size() and is_identifier_char(line.at(end))) end++;
+        tokens_.emplace_back(Token{Token::Type::IDENT, line.substr(i, end - i), 0});
+        i = end;
+      } else {
+        const auto op = std::find_if(kOperators.begin(), kOperators.end(),
+                                     [&line, i] (const auto & candidate) { return line.compare(i, candidate.size(), candidate) == 0; });
+        if (op == kOperators.end()) throw std::logic_error(location_ + ": unexpected character '" + std::string(1, c) + "'");
+        tokens_.emplace_back(Token{Token::Type::OP, *op, 0});
+        i += op->size();
+      }
+    }
+    tokens_.emplace_back(Token{Token::Type::END, "", 0});
+  }
+
+  std::vector<Token> tokens_ = {};
+  size_t pos_ = 0;
+  const std::string location_;
+};
+
+typedef IrRuleSet::Pattern Pattern;
+
+/// Collect the ?variables (into exprs) and #variables (into consts) of pattern
+void collect_vars(const Pattern & pattern, std::set<std::string> & exprs, std::set<std::string> & consts) {
+  if (pattern.kind == Pattern::Kind::ANY) exprs.emplace(pattern.var);
+  if (pattern.kind == Pattern::Kind::CONST) consts.emplace(pattern.var);
+  for (const auto & operand : pattern.operands) collect_vars(operand, exprs, consts);
+}
+
+/// Does pattern contain no ?variables?
+bool is_constant(const Pattern & pattern) {
+  std::set<std::string> exprs, consts;
+  collect_vars(pattern, exprs, consts);
+  return exprs.empty();
+}
+
+/// Does pattern call a builtin?
+bool calls_builtin(const Pattern & pattern) {
+  if (pattern.kind == Pattern::Kind::EXPR and pattern.expr_kind == IrExprKind::CALL and is_builtin(pattern.name)) return true;
+  return std::any_of(pattern.operands.begin(), pattern.operands.end(), calls_builtin);
+}
+
+/// Check that calls of builtins in pattern only take constants
+void check_builtins(const Pattern & pattern, const std::string & location) {
+  if (pattern.kind == Pattern::Kind::EXPR and pattern.expr_kind == IrExprKind::CALL and is_builtin(pattern.name)) {
+    if (pattern.operands.size() != 1) throw std::logic_error(location + ": " + pattern.name + " takes one argument");
+    if (not is_constant(pattern)) throw std::logic_error(location + ": " + pattern.name + " only takes constants");
+  }
+  for (const auto & operand : pattern.operands) check_builtins(operand, location);
+}
+
+}  // namespace
+
+IrRuleSet::IrRuleSet(const std::string & text, const std::string & source) {
+  trie_.emplace_back();
+  size_t line_number = 0;
+  size_t begin = 0;
+  while (begin <= text.size()) {
+    const size_t end = std::min(text.find('\n', begin), text.size());
+    std::string line = text.substr(begin, end - begin);
+    begin = end + 1;
+    line_number++;
+    line = line.substr(0, comment_start(line));
+    if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+    const std::string location = source + ":" + std::to_string(line_number);
+    IrRuleParser parser(line, location);
+    Rule rule = {parser.parse_expr(), Pattern(), {}, location};
+    parser.expect("=>");
+    rule.replacement = parser.parse_expr();
+    if (parser.accept("if")) {
+      do { rule.conditions.emplace_back(parser.parse_expr()); } while (parser.accept(","));
+    }
+    if (not parser.at_end()) parser.error("expected end of rule");
+
+    // Every rule must say what it matches, and can only use what it matched
+    if (rule.pattern.kind != Pattern::Kind::EXPR) {
+      throw std::logic_error(location + ": a pattern must not be a bare variable, it would match everything");
+    }
+    std::set<std::string> pattern_exprs, pattern_consts;
+    collect_vars(rule.pattern, pattern_exprs, pattern_consts);
+    for (const auto & var : pattern_exprs) {
+      if (pattern_consts.count(var)) throw std::logic_error(location + ": ?" + var + " and #" + var + " in one pattern");
+    }
+    std::set<std::string> exprs, consts;
+    collect_vars(rule.replacement, exprs, consts);
+    for (const auto & condition : rule.conditions) {
+      if (not is_constant(condition)) throw std::logic_error(location + ": conditions may only use #variables");
+      collect_vars(condition, exprs, consts);
+      check_builtins(condition, location);
+    }
+    for (const auto & var : exprs) {
+      if (not pattern_exprs.count(var)) throw std::logic_error(location + ": ?" + var + " isn't bound by the pattern");
+    }
+    for (const auto & var : consts) {
+      if (not pattern_consts.count(var)) throw std::logic_error(location + ": #" + var + " isn't bound by the pattern");
+    }
+    check_builtins(rule.replacement, location);
+
+    rules_.emplace_back(rule);
+    const size_t leaf = insert(0, rules_.back().pattern);
+    trie_.at(leaf).rules.emplace_back(rules_.size() - 1);
+  }
+}
+
+IrRuleSet::Symbol IrRuleSet::symbol(const IrExprPtr & expr) {
+  return Symbol(expr->kind, expr->name, expr->kind == IrExprKind::INT_LITERAL ? expr->value : 0, expr->operands.size());
+}
+
+size_t IrRuleSet::insert(const size_t node, const Pattern & pattern) {
+  switch (pattern.kind) {
+    case Pattern::Kind::ANY:
+      if (trie_.at(node).any_child == kNoChild) {
+        trie_.emplace_back();
+        trie_.at(node).any_child = trie_.size() - 1;
+      }
+      return trie_.at(node).any_child;
+    case Pattern::Kind::CONST:
+      if (trie_.at(node).const_child == kNoChild) {
+        trie_.emplace_back();
+        trie_.at(node).const_child = trie_.size() - 1;
+      }
+      return trie_.at(node).const_child;
+    case Pattern::Kind::EXPR: {
+      const Symbol key(pattern.expr_kind, pattern.name, pattern.value, pattern.operands.size());
+      if (trie_.at(node).children.find(key) == trie_.at(node).children.end()) {
+        trie_.emplace_back();
+        trie_.at(node).children[key] = trie_.size() - 1;
+      }
+      size_t next = trie_.at(node).children.at(key);
+      for (const auto & operand : pattern.operands) next = insert(next, operand);
+      return next;
+    }
+  }
+  assert_exception(false);
+  return kNoChild;
+}
+
+void IrRuleSet::candidates(const size_t node, std::vector<IrExprPtr> pending, std::vector<size_t> & rules) const {
+  const auto & trie_node = trie_.at(node);
+  if (pending.empty()) {
+    rules.insert(rules.end(), trie_node.rules.begin(), trie_node.rules.end());
+    return;
+  }
+  const IrExprPtr subject = ir_strip_parens(pending.back());
+  pending.pop_back();
+
+  // A ?variable takes the whole subexpression, a #variable a literal
+  if (trie_node.any_child != kNoChild) candidates(trie_node.any_child, pending, rules);
+  if (trie_node.const_child != kNoChild and subject->kind == IrExprKind::INT_LITERAL) {
+    candidates(trie_node.const_child, pending, rules);
+  }
+
+  // Anything else must match the node itself, then its operands in order
+  const auto child = trie_node.children.find(symbol(subject));
+  if (child != trie_node.children.end()) {
+    pending.insert(pending.end(), subject->operands.rbegin(), subject->operands.rend());
+    candidates(child->second, pending, rules);
+  }
+}
+
+bool IrRuleSet::match(const Pattern & pattern, const IrExprPtr & expr, Bindings & bindings) {
+  const auto & subject = ir_strip_parens(expr);
+  switch (pattern.kind) {
+    case Pattern::Kind::ANY: {
+      const auto bound = bindings.exprs.emplace(pattern.var, subject);
+      return bound.second or ir_equal(ir_strip_parens(bound.first->second), subject);
+    }
+    case Pattern::Kind::CONST: {
+      if (subject->kind != IrExprKind::INT_LITERAL) return false;
+      const auto bound = bindings.consts.emplace(pattern.var, subject->value);
+      return bound.second or bound.first->second == subject->value;
+    }
+    case Pattern::Kind::EXPR:
+      if (symbol(subject) != Symbol(pattern.expr_kind, pattern.name, pattern.value, pattern.operands.size())) return false;
+      for (size_t i = 0; i < pattern.operands.size(); i++) {
+        if (not match(pattern.operands.at(i), subject->operands.at(i), bindings)) return false;
+      }
+      return true;
+  }
+  return false;
+}
+
+bool IrRuleSet::evaluate(const Pattern & pattern, const std::map<std::string, int64_t> & consts, int64_t & result) {
+  if (pattern.kind == Pattern::Kind::CONST) {
+    const auto it = consts.find(pattern.var);
+    if (it == consts.end()) return false;
+    result = it->second;
+    return true;
+  }
+  if (pattern.kind != Pattern::Kind::EXPR) return false;
+
+  std::vector<IrExprPtr> operands;
+  for (const auto & operand : pattern.operands) {
+    int64_t value;
+    if (not evaluate(operand, consts, value)) return false;
+    operands.emplace_back(ir_int(value));
+  }
+  if (pattern.expr_kind == IrExprKind::CALL and is_builtin(pattern.name)) {
+    const int64_t n = operands.at(0)->value;
+    if (pattern.name == "pow2") {
+      result = n > 0 and (n & (n - 1)) == 0;
+      return true;
+    }
+    if (n <= 0) return false;
+    for (result = 0; (n >> result) > 1; result++) {}
+    return true;
+  }
+  if (pattern.expr_kind == IrExprKind::INT_LITERAL) {
+    result = pattern.value;
+    return true;
+  }
+  return ir_evaluate(std::make_shared<const IrExpr>(IrExpr{pattern.expr_kind, pattern.name, 0, operands}), result);
+}
+
+IrExprPtr IrRuleSet::instantiate(const Pattern & replacement, const Bindings & bindings) {
+  if (is_constant(replacement)) {
+    int64_t value;
+    if (evaluate(replacement, bindings.consts, value)) return ir_int(value);
+    // Builtins only exist in rules, so there is nothing to emit instead
+    if (calls_builtin(replacement)) return nullptr;
+  }
+  switch (replacement.kind) {
+    case Pattern::Kind::ANY:   return bindings.exprs.at(replacement.var);
+    case Pattern::Kind::CONST: return ir_int(bindings.consts.at(replacement.var));
+    case Pattern::Kind::EXPR: {
+      std::vector<IrExprPtr> operands;
+      for (const auto & operand : replacement.operands) {
+        operands.emplace_back(instantiate(operand, bindings));
+        if (operands.back() == nullptr) return nullptr;
+      }
+      return std::make_shared<const IrExpr>(IrExpr{replacement.expr_kind, replacement.name, replacement.value, operands});
+    }
+  }
+  assert_exception(false);
+  return nullptr;
+}
+
+IrExprPtr IrRuleSet::with_rewritten_operands(const IrExprPtr & expr, Memo & memo) const {
+  std::vector<IrExprPtr> operands;
+  bool changed = false;
+  for (const auto & operand : expr->operands) {
+    operands.emplace_back(rewrite(operand, memo));
+    changed = changed or operands.back() != operand;
+  }
+  return changed ? std::make_shared<const IrExpr>(IrExpr{expr->kind, expr->name, expr->value, operands}) : expr;
+}
+
+IrExprPtr IrRuleSet::rewrite_root(const IrExprPtr & expr, size_t & rule_index) const {
+  if (expr->kind == IrExprKind::PAREN) return nullptr;
+  std::vector<size_t> matching;
+  candidates(0, {expr}, matching);
+  std::sort(matching.begin(), matching.end());
+  for (const auto i : matching) {
+    const auto & rule = rules_.at(i);
+    Bindings bindings;
+    if (not match(rule.pattern, expr, bindings)) continue;
+    const bool holds = std::all_of(rule.conditions.begin(), rule.conditions.end(),
+                                   [&bindings] (const auto & condition) {
+                                     int64_t value;
+                                     return evaluate(condition, bindings.consts, value) and value != 0;
+                                   });
+    if (not holds) continue;
+    const auto replaced = instantiate(rule.replacement, bindings);
+    if (replaced != nullptr) {
+      rule_index = i;
+      return replaced;
+    }
+  }
+  return nullptr;
+}
+
+IrExprPtr IrRuleSet::rewrite(const IrExprPtr & expr, Memo & memo) const {
+  const auto memoized = memo.find(expr);
+  if (memoized != memo.end()) return memoized->second;
+
+  IrExprPtr ret = with_rewritten_operands(expr, memo);
+  for (int i = 0; ; i++) {
+    size_t rule;
+    const auto rewritten = rewrite_root(ret, rule);
+    if (rewritten == nullptr) break;
+    if (i == kMaxFixedPointIterations) {
+      throw std::logic_error("rules did not converge after " + std::to_string(kMaxFixedPointIterations) +
+                             " rewrites of " + ir_print_expr(expr, "") + ", the last one by the rule at " +
+                             rules_.at(rule).location);
+    }
+    ret = with_rewritten_operands(rewritten, memo);
+  }
+  memo.emplace(expr, ret);
+  memo.emplace(ret, ret);
+  return ret;
+}
+
+bool ir_rules_transform(const IrRuleSet & rules, IrProgram & program, Context &) {
+  IrRuleSet::Memo memo;
+  bool changed = false;
+  for (auto & stmt : program.body) {
+    const auto rhs = rules.rewrite(stmt.rhs, memo);
+    if (ir_equal(rhs, stmt.rhs)) continue;
+    stmt = IrStmt{stmt.lhs, rhs};
+    changed = true;
+  }
+  return changed;
+}
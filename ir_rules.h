@@ -0,0 +1,140 @@
+#ifndef IR_RULES_H_
+#define IR_RULES_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "context.h"
+#include "domino_ir.h"
+
+/// Peephole rewrite rules over IR expressions, read from a rules file
+/// (domino --rules FILE) instead of being coded into a pass. One rule per
+/// line, and a # that doesn't start a #variable starts a comment:
+///
+///   pattern => replacement [if condition, condition, ...]
+///
+/// Patterns and replacements are C expressions over
+///   ?name  any expression,
+///   #name  any integer literal,
+///   integer literals, operators, ternaries and calls, which match themselves.
+/// A variable occurring twice in a pattern matches equal expressions only.
+/// Conditions and the constant parts of replacements are evaluated over the
+/// #variables, with pow2(n) (is n a power of two?) and log2(n) on top of the
+/// C operators. A rule whose replacement calls log2 of a constant that isn't
+/// positive doesn't apply. A minus sign on a literal is part of it, as in C
+/// source, so -1 matches the literal -1. Parentheses only group. For example:
+///
+///   ?x * #c => ?x << log2(#c) if pow2(#c), #c > 1
+///
+/// All patterns are compiled into one discrimination tree, so finding the
+/// rules that may match an expression takes one walk over the expression's
+/// top, bounded by the size of the patterns, however many rules there are.
+class IrRuleSet {
+ public:
+  /// Normal form of every expression rewritten so far, and of every normal form
+  typedef std::unordered_map<IrExprPtr, IrExprPtr> Memo;
+
+  /// Parse rules from text, naming source in errors.
+  /// Throws std::logic_error on the first malformed rule.
+  IrRuleSet(const std::string & text, const std::string & source);
+
+  /// Number of rules
+  size_t size() const { return rules_.size(); }
+
+  /// Rewrite expr bottom-up: operands first, then the expression itself
+  /// with the first rule (in file order) that matches it, until none does.
+  /// Throws std::logic_error if rules keep rewriting one expression.
+  IrExprPtr rewrite(const IrExprPtr & expr, Memo & memo) const;
+
+  /// Pattern, replacement or condition of a rule, as parsed
+  struct Pattern {
+    enum class Kind { ANY, CONST, EXPR };
+    Kind kind;
+
+    /// Name of an ANY or CONST variable
+    std::string var;
+
+    /// Node an EXPR matches, with its operands as patterns
+    IrExprKind expr_kind;
+    std::string name;
+    int64_t value;
+    std::vector<Pattern> operands;
+  };
+
+  /// A rule, with its file and line for errors
+  struct Rule {
+    Pattern pattern;
+    Pattern replacement;
+    std::vector<Pattern> conditions;
+    std::string location;
+  };
+
+  /// Rules in file order, for matchers of their own (e.g., ir_egraph.h)
+  const std::vector<Rule> & rules() const { return rules_; }
+
+  /// Value of a constant pattern (a condition, or a replacement without
+  /// ?variables) given the values of its #variables, false if it has none
+  static bool evaluate(const Pattern & pattern, const std::map<std::string, int64_t> & consts, int64_t & result);
+
+ private:
+  /// What was bound to the variables of a pattern
+  struct Bindings {
+    std::map<std::string, IrExprPtr> exprs;
+    std::map<std::string, int64_t> consts;
+  };
+
+  /// Edge of the discrimination tree: an EXPR node without its operands
+  typedef std::tuple<IrExprKind, std::string, int64_t, size_t> Symbol;
+
+  static constexpr size_t kNoChild = static_cast<size_t>(-1);
+
+  /// Node of the discrimination tree, which patterns enter in preorder
+  struct TrieNode {
+    std::map<Symbol, size_t> children = {};
+    size_t any_child = kNoChild;
+    size_t const_child = kNoChild;
+
+    /// Rules whose pattern ends here
+    std::vector<size_t> rules = {};
+  };
+
+  static Symbol symbol(const IrExprPtr & expr);
+
+  /// Add pattern to the discrimination tree below node,
+  /// returning the node where it ends
+  size_t insert(size_t node, const Pattern & pattern);
+
+  /// Rules reachable from trie node given the subexpressions still
+  /// to match, innermost last
+  void candidates(size_t node, std::vector<IrExprPtr> pending, std::vector<size_t> & rules) const;
+
+  /// Does pattern match expr, extending bindings?
+  static bool match(const Pattern & pattern, const IrExprPtr & expr, Bindings & bindings);
+
+  /// Replacement with bindings substituted in and constant parts folded,
+  /// or nullptr if a builtin in it can't be evaluated, e.g., log2(0)
+  static IrExprPtr instantiate(const Pattern & replacement, const Bindings & bindings);
+
+  /// expr with its operands rewritten
+  IrExprPtr with_rewritten_operands(const IrExprPtr & expr, Memo & memo) const;
+
+  /// Rewrite expr, whose operands are rewritten already, with the first
+  /// rule that matches and can be instantiated, setting rule to its index,
+  /// or return nullptr if there is none
+  IrExprPtr rewrite_root(const IrExprPtr & expr, size_t & rule) const;
+
+  std::vector<Rule> rules_ = {};
+
+  /// Discrimination tree of all patterns, root first
+  std::vector<TrieNode> trie_ = {};
+};
+
+/// Rewrite the right-hand side of every statement with rules,
+/// returning true if any of them changed
+bool ir_rules_transform(const IrRuleSet & rules, IrProgram & program, Context & ctx);
+
+#endif  // IR_RULES_H_
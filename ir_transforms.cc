@@ -0,0 +1,1040 @@
+#include "ir_transforms.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "third_party/assert_exception.h"
+
+#include "context.h"
+#include "ir_analysis.h"
+#include "ir_def_use.h"
+#include "pass_profiler.h"
+#include "symbol_table.h"
+
+IrTransformer ir_fixed_point(const IrTransformer & transformer, const std::string & pass_name) {
+  return [transformer, pass_name] (IrProgram & program, Context & ctx) {
+    bool changed = false;
+    for (int i = 0; i < kMaxFixedPointIterations; i++) {
+      const auto start = std::chrono::steady_clock::now();
+      const bool iteration_changed = transformer(program, ctx);
+      if (auto * profiler = PassProfiler::active()) profiler->add_iteration(seconds_since(start));
+      if (not iteration_changed) return changed;
+      changed = true;
+    }
+    throw std::logic_error("Pass " + pass_name + " did not converge after " +
+                           std::to_string(kMaxFixedPointIterations) + " iterations, last program:\n" +
+                           ir_print_program(program, ctx));
+  };
+}
+
+IrTransformer ir_sequence(const std::vector<IrTransformer> & transformers) {
+  return [transformers] (IrProgram & program, Context & ctx) {
+    bool changed = false;
+    for (const auto & transformer : transformers) changed = transformer(program, ctx) or changed;
+    return changed;
+  };
+}
+
+bool ir_stateful_flanks_transform(IrProgram & program, Context & ctx) {
+  auto & names = ir_names(program, ctx);
+
+  std::map<std::string, std::string> state_var_types;
+  for (const auto & state_var : program.state_vars) state_var_types[state_var.name] = state_var.type;
+
+  // Map from each state variable that is written to its packet temporary
+  std::map<std::string, std::string> state_var_table;
+  std::vector<IrStmt> read_prologue;
+  std::vector<IrStmt> write_epilogue;
+  for (const auto & stmt : program.body) {
+    const auto & lhs = ir_strip_parens(stmt.lhs);
+    if (lhs->kind == IrExprKind::STATE_VAR and
+        state_var_table.find(lhs->name) == state_var_table.end()) {
+      const auto new_tmp_var = names.allocate(lhs->name);
+      program.fields.emplace_back(IrField{state_var_types.at(lhs->name), new_tmp_var});
+
+      ctx.SetType(new_tmp_var, D_INT);
+      ctx.SetVarKind(new_tmp_var, D_PKT_FIELD);
+      ctx.Derive(new_tmp_var, new_tmp_var);
+
+      read_prologue.emplace_back(IrStmt{ir_pkt_field(new_tmp_var), lhs});
+      write_epilogue.emplace_back(IrStmt{lhs, ir_pkt_field(new_tmp_var)});
+      state_var_table[lhs->name] = new_tmp_var;
+    }
+  }
+
+  const auto replace = [&state_var_table] (const IrExprPtr & var) -> IrExprPtr {
+    if (var->kind == IrExprKind::STATE_VAR and state_var_table.find(var->name) != state_var_table.end()) {
+      return ir_pkt_field(state_var_table.at(var->name));
+    }
+    return nullptr;
+  };
+
+  std::vector<IrStmt> new_body = read_prologue;
+  for (const auto & stmt : program.body) {
+    new_body.emplace_back(IrStmt{ir_replace_vars(stmt.lhs, replace), ir_replace_vars(stmt.rhs, replace)});
+  }
+  new_body.insert(new_body.end(), write_epilogue.begin(), write_epilogue.end());
+  program.body = new_body;
+  return not state_var_table.empty();
+}
+
+namespace {
+
+/// Bottom-up rewrite engine for AlgebraicSimplifier's rules, plus
+/// annihilators and boolean absorption. Operands are normalized before
+/// the expression holding them, and rules are applied at the root until
+/// none applies, so one traversal reaches the normal form that
+/// AlgebraicSimplifier needs a fixed point over whole programs for.
+class IrAlgebraicSimplifier {
+ public:
+  explicit IrAlgebraicSimplifier(const std::string & pkt_name) : pkt_prefix_(pkt_name + ".") {}
+
+  /// Normal form of expr. Normal forms are memoized by node, so subtrees
+  /// shared between expressions, e.g., by expr_propagater, are normalized once.
+  IrExprPtr simplify(const IrExprPtr & expr) const {
+    const auto memoized = normal_forms_.find(expr);
+    if (memoized != normal_forms_.end()) return memoized->second;
+
+    IrExprPtr ret = with_simplified_operands(expr);
+    for (int i = 0; ; i++) {
+      if (i == kMaxFixedPointIterations) {
+        throw std::logic_error("algebra_simplify did not converge after " +
+                               std::to_string(kMaxFixedPointIterations) + " rewrites of " + str(expr));
+      }
+      const auto rewritten = rewrite(ret);
+      if (rewritten == nullptr) break;
+      ret = with_simplified_operands(rewritten);
+    }
+    normal_forms_.emplace(expr, ret);
+    normal_forms_.emplace(ret, ret);
+    return ret;
+  }
+
+ private:
+  std::string str(const IrExprPtr & expr) const { return ir_print_expr(expr, pkt_prefix_); }
+
+  /// expr with its operands replaced by their normal forms
+  IrExprPtr with_simplified_operands(const IrExprPtr & expr) const {
+    std::vector<IrExprPtr> operands;
+    bool changed = false;
+    for (const auto & operand : expr->operands) {
+      operands.emplace_back(simplify(operand));
+      changed = changed or operands.back() != operand;
+    }
+    if (not changed) return expr;
+    switch (expr->kind) {
+      case IrExprKind::PAREN:   return ir_paren(operands.at(0));
+      case IrExprKind::UNARY:   return ir_unary(expr->name, operands.at(0));
+      case IrExprKind::BINARY:  return ir_binary(expr->name, operands.at(0), operands.at(1));
+      case IrExprKind::TERNARY: return ir_ternary(operands.at(0), operands.at(1), operands.at(2));
+      case IrExprKind::CALL:    return ir_call(expr->name, operands);
+      default: return expr;
+    }
+  }
+
+  /// Apply the first rule that matches expr, whose operands are in normal form,
+  /// or return nullptr if none does
+  IrExprPtr rewrite(const IrExprPtr & expr) const {
+    switch (expr->kind) {
+      case IrExprKind::UNARY:   return rewrite_un_op(expr);
+      case IrExprKind::BINARY:  return rewrite_bin_op(expr);
+      case IrExprKind::TERNARY: return rewrite_cond_op(expr);
+      default: return nullptr;
+    }
+  }
+
+  /// Remove double negations and double minus signs,
+  /// and parenthesize the operand exactly once
+  static IrExprPtr rewrite_un_op(const IrExprPtr & un_op) {
+    const auto & operand = un_op->operands.at(0);
+    const auto & sub = ir_strip_parens(operand);
+    if (sub->kind == IrExprKind::UNARY and sub->name == un_op->name) return ir_strip_parens(sub->operands.at(0));
+    if (operand->kind != IrExprKind::PAREN or operand->operands.at(0) != sub) return ir_unary(un_op->name, ir_paren(sub));
+    return nullptr;
+  }
+
+  /// Pick a branch if the condition is a literal
+  static IrExprPtr rewrite_cond_op(const IrExprPtr & cond_op) {
+    const auto & cond = cond_op->operands.at(0);
+    if (cond->kind == IrExprKind::INT_LITERAL) return cond->value != 0 ? cond_op->operands.at(1) : cond_op->operands.at(2);
+    return nullptr;
+  }
+
+  /// Does expr evaluate to 0 or 1 only?
+  static bool is_boolean(const IrExprPtr & expr) {
+    const auto & stripped = ir_strip_parens(expr);
+    switch (stripped->kind) {
+      case IrExprKind::INT_LITERAL: return stripped->value == 0 or stripped->value == 1;
+      case IrExprKind::UNARY: return stripped->name == "!";
+      case IrExprKind::BINARY: {
+        const auto & op = stripped->name;
+        return op == "==" or op == "!=" or op == "<" or op == ">" or op == "<=" or op == ">=" or op == "&&" or op == "||";
+      }
+      default: return false;
+    }
+  }
+
+  /// Does bin_op consist solely of op applied to variables and literals?
+  static bool contains_only(const IrExprPtr & bin_op, const std::string & op) {
+    if (bin_op->name != op) return false;
+    for (const auto & operand : bin_op->operands) {
+      const auto & child = ir_strip_parens(operand);
+      if (child->kind == IrExprKind::BINARY) {
+        if (not contains_only(child, op)) return false;
+      } else if (not (ir_is_var(child) or child->kind == IrExprKind::INT_LITERAL)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// Collect the leaves of a tree for which contains_only holds
+  static void collect_leaves(const IrExprPtr & expr, std::vector<IrExprPtr> & vars, std::vector<int64_t> & consts) {
+    const auto & stripped = ir_strip_parens(expr);
+    if (stripped->kind == IrExprKind::BINARY) {
+      for (const auto & operand : stripped->operands) collect_leaves(operand, vars, consts);
+    } else if (stripped->kind == IrExprKind::INT_LITERAL) {
+      consts.emplace_back(stripped->value);
+    } else {
+      vars.emplace_back(stripped);
+    }
+  }
+
+  /// Collect maximal subterms of a chain of op, deduplicated and sorted
+  void collect_terms(const IrExprPtr & expr, const std::string & op, std::map<std::string, IrExprPtr> & terms) const {
+    const auto & stripped = ir_strip_parens(expr);
+    if (stripped->kind == IrExprKind::BINARY and stripped->name == op) {
+      collect_terms(stripped->operands.at(0), op, terms);
+      collect_terms(stripped->operands.at(1), op, terms);
+    } else {
+      terms.emplace(str(stripped), stripped);
+    }
+  }
+
+  /// Left-associative chain e0 op e1 op e2 ...
+  static IrExprPtr chain(const std::string & op, const std::vector<IrExprPtr> & exprs) {
+    assert_exception(not exprs.empty());
+    IrExprPtr ret = exprs.front();
+    for (size_t i = 1; i < exprs.size(); i++) ret = ir_binary(op, ret, exprs.at(i));
+    return ret;
+  }
+
+  /// Rewrite a chain of one commutative, associative operator
+  /// into its constant followed by its variables in lexicographic order
+  IrExprPtr flatten(const IrExprPtr & bin_op) const {
+    const auto & op = bin_op->name;
+    const bool idempotent = (op == "&&" or op == "||");
+
+    std::vector<IrExprPtr> vars;
+    std::vector<int64_t> consts;
+    collect_leaves(bin_op, vars, consts);
+
+    // Sort variables by name. && and || are idempotent, so drop duplicates
+    // there, but keep them for + and *, where they matter.
+    std::stable_sort(vars.begin(), vars.end(), [this] (const auto & a, const auto & b) { return str(a) < str(b); });
+    if (idempotent) {
+      vars.erase(std::unique(vars.begin(), vars.end(), [this] (const auto & a, const auto & b) { return str(a) == str(b); }),
+                 vars.end());
+    }
+
+    const int64_t identity = (op == "+" or op == "||") ? 0 : 1;
+    int64_t const_eval = identity;
+    for (const auto & c : consts) {
+      int64_t folded;
+      ir_evaluate(ir_binary(op, ir_int(const_eval), ir_int(c)), folded);
+      const_eval = folded;
+    }
+    if (op == "*" and const_eval == 0) return ir_int(0);
+
+    std::vector<IrExprPtr> operands;
+    if (not consts.empty() and (const_eval != identity or vars.empty())) operands.emplace_back(ir_int(const_eval));
+    operands.insert(operands.end(), vars.begin(), vars.end());
+    // x && 1 and x || x are 0 or 1, not x, so keep the identity
+    // in front of a variable that would otherwise be left alone
+    if (idempotent and operands.size() == 1 and not is_boolean(operands.front())) {
+      operands.insert(operands.begin(), ir_int(identity));
+    }
+    return chain(op, operands);
+  }
+
+  IrExprPtr rewrite_bin_op(const IrExprPtr & bin_op) const {
+    const auto & op = bin_op->name;
+    const auto & lhs = ir_strip_parens(bin_op->operands.at(0));
+    const auto & rhs = ir_strip_parens(bin_op->operands.at(1));
+
+    // Fold constant expressions
+    int64_t value;
+    if (ir_evaluate(bin_op, value)) return ir_int(value);
+
+    // Annihilators: anything * 0 = 0, anything & 0 = 0, anything && 0 = 0,
+    // and anything || c = 1 for any other constant c
+    if ((op == "*" or op == "&" or op == "&&") and (ir_is_int(lhs, 0) or ir_is_int(rhs, 0))) return ir_int(0);
+    if (op == "||" and ((lhs->kind == IrExprKind::INT_LITERAL and lhs->value != 0) or
+                        (rhs->kind == IrExprKind::INT_LITERAL and rhs->value != 0))) {
+      return ir_int(1);
+    }
+
+    // Multiplicative identity: 1 * anything = anything, and 1 && anything = anything
+    // if anything is 0 or 1 already: 1 && 5 is 1
+    if (op == "*" or op == "&&") {
+      if (ir_is_int(lhs, 1) and (op == "*" or is_boolean(rhs))) return bin_op->operands.at(1);
+      if (ir_is_int(rhs, 1) and (op == "*" or is_boolean(lhs))) return bin_op->operands.at(0);
+    }
+
+    // Additive identity: 0 + anything = anything, 0 | anything = anything,
+    // and 0 || anything = anything if anything is 0 or 1 already
+    if (op == "+" or op == "|" or op == "||") {
+      if (ir_is_int(lhs, 0) and (op != "||" or is_boolean(rhs))) return bin_op->operands.at(1);
+      if (ir_is_int(rhs, 0) and (op != "||" or is_boolean(lhs))) return bin_op->operands.at(0);
+    }
+
+    // A && A = A, A || A = A, if A is 0 or 1
+    if ((op == "&&" or op == "||") and ir_equal(lhs, rhs) and is_boolean(lhs)) {
+      return bin_op->operands.at(0);
+    }
+
+    // Absorption: A && (A || B) = A, A || (A && B) = A, either way around.
+    // A must be 0 or 1 already, because the left-hand side is.
+    if (op == "&&" or op == "||") {
+      const std::string dual = op == "&&" ? "||" : "&&";
+      const auto absorbs = [&dual] (const IrExprPtr & a, const IrExprPtr & b) {
+        return is_boolean(a) and b->kind == IrExprKind::BINARY and b->name == dual and
+               (ir_equal(ir_strip_parens(b->operands.at(0)), a) or ir_equal(ir_strip_parens(b->operands.at(1)), a));
+      };
+      if (absorbs(lhs, rhs)) return bin_op->operands.at(0);
+      if (absorbs(rhs, lhs)) return bin_op->operands.at(1);
+    }
+
+    // Flatten chains of a single commutative, associative operator
+    if ((op == "+" or op == "*" or op == "&&" or op == "||") and contains_only(bin_op, op)) {
+      const auto flat = flatten(bin_op);
+      return ir_equal(flat, bin_op) ? nullptr : flat;
+    }
+
+    // A && A && A && B --> (A) && (B). Atomic terms stay bare, as flatten
+    // leaves variables and literals: parenthesizing them made the two rules
+    // undo each other on chains like a && b && (c - d).
+    if (op == "&&" or op == "||") {
+      std::map<std::string, IrExprPtr> terms;
+      collect_terms(bin_op, op, terms);
+      std::vector<IrExprPtr> parenthesized;
+      for (const auto & term : terms) {
+        parenthesized.emplace_back(ir_is_atomic(term.second) ? term.second : ir_paren(term.second));
+      }
+      // As in flatten, A && A is only A if A is 0 or 1
+      if (parenthesized.size() == 1 and not is_boolean(parenthesized.front())) return nullptr;
+      const auto canonical = chain(op, parenthesized);
+      if (str(canonical) != str(bin_op)) return canonical;
+    }
+
+    return nullptr;
+  }
+
+  /// Prefix for printing packet fields, used to order and compare subterms
+  const std::string pkt_prefix_;
+
+  /// Normal form of every expression simplified so far, and of every normal form
+  mutable std::unordered_map<IrExprPtr, IrExprPtr> normal_forms_ = {};
+};
+
+/// Simplify stmt, returning true if it changed
+bool simplify_stmt(const IrAlgebraicSimplifier & simplifier, IrStmt & stmt) {
+  const IrStmt simplified = {simplifier.simplify(stmt.lhs), simplifier.simplify(stmt.rhs)};
+  if (ir_equal(simplified.lhs, stmt.lhs) and ir_equal(simplified.rhs, stmt.rhs)) return false;
+  stmt = simplified;
+  return true;
+}
+
+}  // namespace
+
+bool ir_algebra_simplify_transform(IrProgram & program, Context &) {
+  const IrAlgebraicSimplifier simplifier(program.pkt_name);
+  bool changed = false;
+  for (auto & stmt : program.body) changed = simplify_stmt(simplifier, stmt) or changed;
+  return changed;
+}
+
+bool ir_elim_identical_lhs_rhs_transform(IrProgram & program, Context &) {
+  std::vector<IrStmt> new_body;
+  for (const auto & stmt : program.body) {
+    if (ir_equal(ir_strip_parens(stmt.lhs), ir_strip_parens(stmt.rhs))) continue;
+    new_body.emplace_back(stmt);
+  }
+  const bool changed = new_body.size() != program.body.size();
+  program.body = new_body;
+  return changed;
+}
+
+bool ir_ssa_transform(IrProgram & program, Context & ctx) {
+  auto & symbols = ctx.Symbols();
+  auto & names = ir_names(program, ctx);
+
+  std::unordered_map<Symbol, std::string> field_types;
+  for (const auto & field : program.fields) field_types[symbols.intern(field.name)] = field.type;
+
+  // Map from field name to its current SSA name. We rename ALL definitions
+  // of a packet field rather than just redefinitions, because reads
+  // preceding the first definition must still see the original field.
+  std::unordered_map<Symbol, std::string> current_field_replacements;
+  const auto replace = [&current_field_replacements, &symbols] (const IrExprPtr & var) -> IrExprPtr {
+    if (var->kind != IrExprKind::PKT_FIELD) return nullptr;
+    const auto it = current_field_replacements.find(symbols.intern(var->name));
+    return it == current_field_replacements.end() ? nullptr : ir_pkt_field(it->second);
+  };
+
+  std::vector<IrField> new_fields;
+  for (auto & stmt : program.body) {
+    // First rewrite RHS using whatever replacements we currently have
+    const auto rhs = ir_replace_vars(stmt.rhs, replace);
+
+    // Now look at LHS
+    const auto & lhs = ir_strip_parens(stmt.lhs);
+    if (lhs->kind == IrExprKind::PKT_FIELD) {
+      const auto & lhs_field = lhs->name;
+      const auto lhs_symbol = symbols.intern(lhs_field);
+      const auto new_tmp_var = names.allocate(lhs_field);
+      const auto lhs_type = field_types.at(lhs_symbol);
+      new_fields.emplace_back(IrField{lhs_type, new_tmp_var});
+      field_types[symbols.intern(new_tmp_var)] = lhs_type;
+
+      // Temporaries stay temporaries, everything else becomes a packet field
+      // so that read/write flanks aren't destroyed.
+      const auto var_domino_type = ctx.GetType(lhs_field);
+      const auto var_domino_kind = ctx.GetVarKind(lhs_field);
+      ctx.SetType(new_tmp_var, var_domino_type);
+      ctx.SetVarKind(new_tmp_var, var_domino_kind == D_TMP ? D_TMP : D_PKT_FIELD);
+      ctx.Derive(lhs_field, new_tmp_var);
+      if (var_domino_kind == D_TMP) ctx.SetOptLevel(new_tmp_var, D_OPT);
+
+      current_field_replacements[lhs_symbol] = new_tmp_var;
+    }
+
+    // Now rewrite LHS
+    stmt = IrStmt{ir_replace_vars(stmt.lhs, replace), rhs};
+  }
+  program.fields.insert(program.fields.end(), new_fields.begin(), new_fields.end());
+
+  // Print out the final replacements, by field name
+  std::map<std::string, std::string> final_replacements;
+  for (const auto & repl_pair : current_field_replacements)
+    final_replacements.emplace(symbols.name(repl_pair.first), repl_pair.second);
+  for (const auto & repl_pair : final_replacements)
+    ctx.Log() << "// " + repl_pair.first << " " << repl_pair.second << std::endl;
+
+  return not new_fields.empty();
+}
+
+bool ir_expr_prop_transform(IrProgram & program, Context & ctx) {
+  auto & symbols = ctx.Symbols();
+  std::unordered_map<Symbol, IrExprPtr> var_to_expr;
+  const auto substitute = [&var_to_expr, &program, &symbols] (const IrExprPtr & var) -> IrExprPtr {
+    if (var->kind != IrExprKind::PKT_FIELD) return nullptr;
+    const auto it = var_to_expr.find(ir_var_symbol(var, program.pkt_name, symbols));
+    return it == var_to_expr.end() ? nullptr : it->second;
+  };
+
+  const auto old_body = program.body;
+  const auto def_use = ir_def_use(program, symbols);
+  for (size_t i = 0; i < program.body.size(); i++) {
+    auto & stmt = program.body.at(i);
+    const auto lhs = ir_strip_parens(stmt.lhs);
+    const auto rhs = ir_strip_parens(stmt.rhs);
+    const auto lhs_symbol = def_use->defined(i);
+
+    if (not def_use->used(i).contains(lhs_symbol) and
+        rhs->kind != IrExprKind::STATE_VAR and rhs->kind != IrExprKind::TERNARY) {
+      var_to_expr[lhs_symbol] = rhs;
+    }
+
+    const auto propagated = rhs->kind == IrExprKind::PKT_FIELD
+                                ? var_to_expr.find(ir_var_symbol(rhs, program.pkt_name, symbols))
+                                : var_to_expr.end();
+    if (lhs->kind != IrExprKind::STATE_VAR and propagated != var_to_expr.end()) {
+      stmt = IrStmt{lhs, propagated->second};
+    } else if (lhs->kind != IrExprKind::STATE_VAR and rhs->kind == IrExprKind::TERNARY) {
+      const auto replaced_cond = ir_replace_vars(ir_strip_parens(rhs->operands.at(0)), substitute);
+      stmt = IrStmt{lhs, ir_ternary(ir_paren(replaced_cond), rhs->operands.at(1), rhs->operands.at(2))};
+    } else {
+      stmt = IrStmt{lhs, rhs};
+    }
+  }
+  return not ir_equal(old_body, program.body);
+}
+
+bool ir_paren_remover_transform(IrProgram & program, Context &) {
+  const auto old_body = program.body;
+  for (auto & stmt : program.body) {
+    const auto lhs = ir_strip_parens(stmt.lhs);
+    const auto rhs = ir_strip_parens(stmt.rhs);
+    if (rhs->kind == IrExprKind::TERNARY) {
+      auto cond_expr = ir_strip_parens(rhs->operands.at(0));
+      if (cond_expr->kind == IrExprKind::UNARY) {
+        cond_expr = ir_unary(cond_expr->name, ir_paren(ir_strip_parens(cond_expr->operands.at(0))));
+      }
+      stmt = IrStmt{lhs, ir_ternary(ir_paren(cond_expr),
+                                    ir_paren(ir_strip_parens(rhs->operands.at(1))),
+                                    ir_paren(ir_strip_parens(rhs->operands.at(2))))};
+    } else {
+      stmt = IrStmt{lhs, rhs};
+    }
+  }
+  return not ir_equal(old_body, program.body);
+}
+
+bool ir_branch_var_creator_transform(IrProgram & program, Context & ctx) {
+  auto & names = ir_names(program, ctx);
+
+  // Map from each condition (as printed) to the temporary holding it
+  std::map<std::string, std::string> expr_to_var;
+
+  std::vector<IrStmt> new_body;
+  for (const auto & stmt : program.body) {
+    const auto & rhs = ir_strip_parens(stmt.rhs);
+    if (rhs->kind != IrExprKind::TERNARY) {
+      new_body.emplace_back(stmt);
+      continue;
+    }
+
+    const auto & condexpr = ir_strip_parens(rhs->operands.at(0));
+    const auto conditional = ir_print_expr(condexpr, program.pkt_name + ".");
+    const auto & lhs = ir_strip_parens(stmt.lhs);
+    const auto rhs_texpr = ir_paren(ir_strip_parens(rhs->operands.at(1)));
+    const auto rhs_fexpr = ir_paren(ir_strip_parens(rhs->operands.at(2)));
+
+    if (expr_to_var.find(conditional) == expr_to_var.end()) {
+      const std::string tmp_var_name = names.allocate("_br_tmp");
+      program.fields.emplace_back(IrField{"int", tmp_var_name});
+
+      ctx.SetType(tmp_var_name, D_BIT);
+      ctx.SetVarKind(tmp_var_name, D_TMP);
+      ctx.Derive(tmp_var_name, tmp_var_name);
+      ctx.SetOptLevel(tmp_var_name, D_OPT);
+
+      expr_to_var[conditional] = tmp_var_name;
+      new_body.emplace_back(IrStmt{ir_pkt_field(tmp_var_name), condexpr});
+    }
+    new_body.emplace_back(IrStmt{lhs, ir_ternary(ir_pkt_field(expr_to_var.at(conditional)), rhs_texpr, rhs_fexpr)});
+  }
+  const bool changed = not ir_equal(program.body, new_body);
+  program.body = new_body;
+  return changed;
+}
+
+bool ir_dce_transform(IrProgram & program, Context & ctx) {
+  // Number of live statements reading each variable, by Symbol,
+  // starting out with all statements live
+  const auto def_use = ir_def_use(program, ctx.Symbols());
+  std::vector<size_t> use_count(ctx.Symbols().size(), 0);
+  for (size_t i = 0; i < def_use->size(); i++) {
+    for (const auto var : def_use->used(i)) use_count.at(var) = def_use->uses(var).size();
+  }
+
+  // A definition is dead if nothing reads it
+  // and the context allows us to optimize it away.
+  // Killing it may kill the definitions of what it read in turn.
+  std::vector<bool> dead(program.body.size(), false);
+  std::vector<size_t> worklist;
+  for (size_t i = program.body.size(); i > 0; i--) worklist.emplace_back(i - 1);
+  while (not worklist.empty()) {
+    const size_t i = worklist.back();
+    worklist.pop_back();
+    if (dead.at(i)) continue;
+    const auto & lhs = ir_strip_parens(program.body.at(i).lhs);
+    if (use_count.at(def_use->defined(i)) > 0 or
+        ctx.GetOptLevel(lhs->name) == D_NO_OPT) {
+      continue;
+    }
+    dead.at(i) = true;
+    for (const auto var : def_use->used(i)) {
+      if (--use_count.at(var) == 0 and def_use->def(var) != IrDefUse::kNoDef) {
+        worklist.emplace_back(def_use->def(var));
+      }
+    }
+  }
+
+  std::vector<IrStmt> new_body;
+  for (size_t i = 0; i < program.body.size(); i++) {
+    if (not dead.at(i)) new_body.emplace_back(program.body.at(i));
+  }
+  const bool changed = new_body.size() != program.body.size();
+  program.body = new_body;
+  return changed;
+}
+
+bool ir_dde_transform(IrProgram & program, Context & ctx) {
+  auto & symbols = ctx.Symbols();
+  std::vector<Symbol> used_pkt_vars;
+  for (const auto & stmt : program.body) {
+    ir_collect_var_symbols(stmt.lhs, program.pkt_name, symbols, used_pkt_vars, true, false);
+    ir_collect_var_symbols(stmt.rhs, program.pkt_name, symbols, used_pkt_vars, true, false);
+  }
+  const SymbolSet used(used_pkt_vars);
+
+  std::vector<IrField> new_fields;
+  for (const auto & field : program.fields) {
+    if (used.contains(symbols.find(program.pkt_name + "." + field.name)) or
+        ctx.GetOptLevel(field.name) == D_NO_OPT) {
+      new_fields.emplace_back(field);
+    }
+  }
+  const bool changed = new_fields.size() != program.fields.size();
+  program.fields = new_fields;
+  return changed;
+}
+
+namespace {
+
+/// Variables within expr, by name
+std::map<std::string, IrExprPtr> vars_by_name(const IrExprPtr & expr, const std::string & pkt_name) {
+  std::map<std::string, IrExprPtr> ret;
+  if (ir_is_var(expr)) {
+    ret.emplace(ir_var_name(expr, pkt_name), expr);
+  } else {
+    for (const auto & operand : expr->operands) {
+      const auto operand_vars = vars_by_name(operand, pkt_name);
+      ret.insert(operand_vars.begin(), operand_vars.end());
+    }
+  }
+  return ret;
+}
+
+/// Simplify lhs op rhs (op being && or ||) to lhs when rhs is lhs
+/// with one SSA version of a variable replaced by another version.
+IrExprPtr process_focused_subexpression(const IrExprPtr & lhs, const IrExprPtr & rhs,
+                                        const std::string & op, const std::string & pkt_name, Context & ctx) {
+  const auto lhs_vars = vars_by_name(lhs, pkt_name);
+  const auto rhs_vars = vars_by_name(rhs, pkt_name);
+
+  std::vector<IrExprPtr> not_in_rhs, not_in_lhs;
+  for (const auto & v : lhs_vars) if (rhs_vars.find(v.first) == rhs_vars.end()) not_in_rhs.emplace_back(v.second);
+  for (const auto & v : rhs_vars) if (lhs_vars.find(v.first) == lhs_vars.end()) not_in_lhs.emplace_back(v.second);
+
+  if (not_in_lhs.size() == 1 and not_in_rhs.size() == 1) {
+    const auto & lhs_var = not_in_rhs.front();
+    const auto & rhs_var = not_in_lhs.front();
+    if (lhs_var->kind == IrExprKind::PKT_FIELD and rhs_var->kind == IrExprKind::PKT_FIELD and
+        ctx.GetBase(lhs_var->name) == ctx.GetBase(rhs_var->name)) {
+      // Derived from the same SSA equivalence class:
+      // if rhs computes the same thing as lhs, drop it.
+      const auto rhs_replaced = ir_replace_vars(rhs, [&rhs_var, &lhs_var] (const IrExprPtr & var) -> IrExprPtr {
+        return ir_equal(var, rhs_var) ? lhs_var : nullptr;
+      });
+      if (ir_equal(lhs, rhs_replaced)) return lhs;
+    }
+  }
+  return ir_binary(op, lhs, rhs);
+}
+
+/// Simplify focus if it is a conjunction or disjunction
+IrExprPtr process_focus(const IrExprPtr & focus, const std::string & pkt_name, Context & ctx) {
+  if (focus->name == "&&" or focus->name == "||") {
+    return process_focused_subexpression(ir_strip_parens(focus->operands.at(0)),
+                                         ir_strip_parens(focus->operands.at(1)),
+                                         focus->name, pkt_name, ctx);
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+bool ir_flow_ite_simplify_transform(IrProgram & program, Context & ctx) {
+  bool changed = false;
+  for (auto & stmt : program.body) {
+    const auto lhs = ir_strip_parens(stmt.lhs);
+    const auto rhs = ir_strip_parens(stmt.rhs);
+    if (ctx.GetType(lhs->name) != D_BIT) continue;
+
+    if (rhs->kind == IrExprKind::BINARY) {
+      const auto processed = process_focus(rhs, program.pkt_name, ctx);
+      if (processed and not ir_equal(processed, rhs)) {
+        stmt = IrStmt{lhs, processed};
+        changed = true;
+      }
+    } else if (rhs->kind == IrExprKind::UNARY and rhs->operands.at(0)->kind == IrExprKind::BINARY) {
+      const auto processed = process_focus(rhs->operands.at(0), program.pkt_name, ctx);
+      if (processed and not ir_equal(processed, rhs->operands.at(0))) {
+        stmt = IrStmt{lhs, ir_unary(rhs->name, ir_paren(processed))};
+        changed = true;
+      }
+    }
+  }
+  return changed;
+}
+
+bool ir_rename_pkt_fields_transform(IrProgram & program, Context &) {
+  const bool changed = not program.pkt_fields_renamed;
+  program.pkt_fields_renamed = true;
+  return changed;
+}
+
+namespace {
+
+/// IR counterpart of ExprFlattenerHandler
+class IrExprFlattener {
+ public:
+  IrExprFlattener(IrProgram & program, Context & ctx)
+    : program_(program), ctx_(ctx), names_(ir_names(program, ctx)) {}
+
+  /// Flatten expr, appending the definitions of any temporaries to new_defs
+  IrExprPtr flatten(const IrExprPtr & expr, const DominoType expr_type, std::vector<IrStmt> & new_defs) {
+    const auto & stripped = ir_strip_parens(expr);
+    if (ir_is_flat(stripped)) return stripped;
+    switch (stripped->kind) {
+      case IrExprKind::UNARY: {
+        // Like the clang version, leave op(y op z) alone:
+        // only a sub expression that isn't flat gets a temporary.
+        const auto & sub = stripped->operands.at(0);
+        if (ir_is_flat(sub)) return stripped;
+        const DominoType un_op_type = (stripped->name == "!" or stripped->name == "~") ? D_BIT : D_INT;
+        return ir_unary(stripped->name, ir_paren(flatten_to_atomic_expr(sub, un_op_type, new_defs)));
+      }
+      case IrExprKind::BINARY: {
+        const DominoType bin_op_type = (stripped->name == "&&" or stripped->name == "||") ? D_BIT : D_INT;
+        const auto lhs = flatten_to_atomic_expr(stripped->operands.at(0), bin_op_type, new_defs);
+        const auto rhs = flatten_to_atomic_expr(stripped->operands.at(1), bin_op_type, new_defs);
+        return ir_binary(stripped->name, lhs, rhs);
+      }
+      case IrExprKind::TERNARY: {
+        const auto cond = flatten_to_atomic_expr(stripped->operands.at(0), D_BIT, new_defs);
+        const auto true_expr = flatten_to_atomic_expr(stripped->operands.at(1), expr_type, new_defs);
+        const auto false_expr = flatten_to_atomic_expr(stripped->operands.at(2), expr_type, new_defs);
+        return ir_ternary(cond, true_expr, false_expr);
+      }
+      default:
+        throw std::logic_error("IrExprFlattener::flatten error: Expr is neither conditional, binary, or unary. It is : " +
+                               ir_print_expr(stripped, program_.pkt_name + "."));
+    }
+  }
+
+ private:
+  /// Flatten expr and, unless it is atomic, hand it to a new packet temporary
+  IrExprPtr flatten_to_atomic_expr(const IrExprPtr & expr, const DominoType expr_type, std::vector<IrStmt> & new_defs) {
+    if (ir_is_atomic(expr)) return ir_strip_parens(expr);
+
+    const auto flat_expr = flatten(expr, expr_type, new_defs);
+    const auto flat_var_member = names_.allocate();
+    program_.fields.emplace_back(IrField{"int", flat_var_member});
+
+    ctx_.SetType(flat_var_member, expr_type);
+    ctx_.SetVarKind(flat_var_member, D_TMP);
+    ctx_.Derive(flat_var_member, flat_var_member);
+    ctx_.SetOptLevel(flat_var_member, D_OPT);
+
+    new_defs.emplace_back(IrStmt{ir_pkt_field(flat_var_member), flat_expr});
+    return ir_pkt_field(flat_var_member);
+  }
+
+  /// Program whose fields receive the new temporaries
+  IrProgram & program_;
+
+  /// Context receiving the types of the new temporaries
+  Context & ctx_;
+
+  /// Source of names for the new temporaries
+  NameAllocator & names_;
+};
+
+}  // namespace
+
+bool ir_expr_flattener_transform(IrProgram & program, Context & ctx) {
+  // The last iteration of the fixed point finds nothing to flatten:
+  // then don't set up the flattener, which needs the census, at all.
+  if (ir_in_flat_form(program)) return false;
+
+  IrExprFlattener flattener(program, ctx);
+  bool changed = false;
+  std::vector<IrStmt> new_body;
+  for (const auto & stmt : program.body) {
+    if (ir_is_flat(stmt.rhs)) {
+      new_body.emplace_back(stmt);
+      continue;
+    }
+    const auto & lhs = ir_strip_parens(stmt.lhs);
+    std::vector<IrStmt> new_defs;
+    const auto flat_expr = flattener.flatten(stmt.rhs, ctx.GetType(lhs->name), new_defs);
+    new_body.insert(new_body.end(), new_defs.begin(), new_defs.end());
+    new_body.emplace_back(IrStmt{lhs, flat_expr});
+    changed = changed or not ir_equal(flat_expr, ir_strip_parens(stmt.rhs));
+  }
+  program.body = new_body;
+  return changed;
+}
+
+bool ir_const_prop_transform(IrProgram & program, Context & ctx) {
+  const IrAlgebraicSimplifier simplifier(program.pkt_name);
+
+  // Packet variables known to hold a constant, or a unary operation
+  // on one, mapped to that expression
+  std::map<std::string, IrExprPtr> const_vars;
+  const auto substitute = [&const_vars] (const IrExprPtr & var) -> IrExprPtr {
+    if (var->kind != IrExprKind::PKT_FIELD) return nullptr;
+    const auto it = const_vars.find(var->name);
+    return it == const_vars.end() ? nullptr : ir_paren(it->second);
+  };
+
+  // Statements reading a variable in const_vars, the only ones to substitute into
+  const auto def_use = ir_def_use(program, ctx.Symbols());
+  std::vector<bool> reads_const(program.body.size(), false);
+
+  // In SSA every use follows its definition, so one forward sweep
+  // that simplifies as it substitutes catches constants uncovered on the way.
+  bool changed = false;
+  std::vector<IrStmt> new_body;
+  for (size_t i = 0; i < program.body.size(); i++) {
+    const auto & stmt = program.body.at(i);
+    IrStmt new_stmt = {stmt.lhs, reads_const.at(i) ? ir_replace_vars(stmt.rhs, substitute) : stmt.rhs};
+    simplify_stmt(simplifier, new_stmt);
+    changed = changed or not ir_equal(new_stmt.rhs, stmt.rhs);
+
+    const auto & lhs = ir_strip_parens(new_stmt.lhs);
+    const auto & rhs = ir_strip_parens(new_stmt.rhs);
+    if (lhs->kind == IrExprKind::PKT_FIELD and
+        (rhs->kind == IrExprKind::INT_LITERAL or rhs->kind == IrExprKind::UNARY)) {
+      const_vars[lhs->name] = rhs;
+      for (const auto use : def_use->uses(def_use->defined(i))) reads_const.at(use) = true;
+      // Definitions the context doesn't allow us to optimize away stay,
+      // everything else now lives on in its uses alone.
+      if (ctx.GetOptLevel(lhs->name) != D_NO_OPT) {
+        changed = true;
+        continue;
+      }
+    }
+    new_body.emplace_back(new_stmt);
+  }
+  program.body = new_body;
+  return changed;
+}
+
+namespace {
+
+/// Rewrite expressions computing the same value the same way up to
+/// the order of operands, so that value numbering sees them as equal
+class IrCanonicalizer {
+ public:
+  explicit IrCanonicalizer(const std::string & pkt_name) : pkt_prefix_(pkt_name + ".") {}
+
+  IrExprPtr canonicalize(const IrExprPtr & expr) const {
+    switch (expr->kind) {
+      case IrExprKind::PAREN: return ir_paren(canonicalize(expr->operands.at(0)));
+      case IrExprKind::UNARY: return ir_unary(expr->name, canonicalize(expr->operands.at(0)));
+      case IrExprKind::BINARY: return canonicalize_bin_op(expr);
+      case IrExprKind::TERNARY:
+        return ir_ternary(canonicalize(expr->operands.at(0)), canonicalize(expr->operands.at(1)),
+                          canonicalize(expr->operands.at(2)));
+      case IrExprKind::CALL: {
+        std::vector<IrExprPtr> args;
+        for (const auto & arg : expr->operands) args.emplace_back(canonicalize(arg));
+        return ir_call(expr->name, args);
+      }
+      default: return expr;
+    }
+  }
+
+ private:
+  /// Order of operands: by printed form, parentheses aside. This puts
+  /// literals before variables, as IrAlgebraicSimplifier::flatten does.
+  bool before(const IrExprPtr & a, const IrExprPtr & b) const {
+    return ir_print_expr(ir_strip_parens(a), pkt_prefix_) < ir_print_expr(ir_strip_parens(b), pkt_prefix_);
+  }
+
+  static bool is_associative(const std::string & op) {
+    return op == "+" or op == "*" or op == "&" or op == "|" or op == "^" or op == "&&" or op == "||";
+  }
+
+  /// Collect the operands of a chain of op, through parentheses
+  void collect_operands(const IrExprPtr & expr, const std::string & op, std::vector<IrExprPtr> & operands) const {
+    const auto & stripped = ir_strip_parens(expr);
+    if (stripped->kind == IrExprKind::BINARY and stripped->name == op) {
+      for (const auto & operand : stripped->operands) collect_operands(operand, op, operands);
+    } else {
+      operands.emplace_back(canonicalize(expr));
+    }
+  }
+
+  /// Sort the operands of commutative operators, flattening chains of
+  /// associative ones into one left-associative chain, and turn > and >=
+  /// around into < and <=. && and || are only flattened: an operand may
+  /// guard the ones after it, e.g., p.x != 0 && p.y / p.x > 1.
+  IrExprPtr canonicalize_bin_op(const IrExprPtr & bin_op) const {
+    const auto & op = bin_op->name;
+    if (is_associative(op)) {
+      std::vector<IrExprPtr> operands;
+      collect_operands(bin_op, op, operands);
+      if (op != "&&" and op != "||") {
+        std::stable_sort(operands.begin(), operands.end(),
+                         [this] (const auto & a, const auto & b) { return before(a, b); });
+      }
+      IrExprPtr ret = operands.front();
+      for (size_t i = 1; i < operands.size(); i++) ret = ir_binary(op, ret, operands.at(i));
+      return ret;
+    }
+
+    const auto lhs = canonicalize(bin_op->operands.at(0));
+    const auto rhs = canonicalize(bin_op->operands.at(1));
+    if (op == "==" or op == "!=") return before(rhs, lhs) ? ir_binary(op, rhs, lhs) : ir_binary(op, lhs, rhs);
+    if (op == ">") return ir_binary("<", rhs, lhs);
+    if (op == ">=") return ir_binary("<=", rhs, lhs);
+    return ir_binary(op, lhs, rhs);
+  }
+
+  /// Prefix for printing packet fields, used to order operands
+  const std::string pkt_prefix_;
+};
+
+}  // namespace
+
+bool ir_canonicalize_transform(IrProgram & program, Context &) {
+  const IrCanonicalizer canonicalizer(program.pkt_name);
+  bool changed = false;
+  for (auto & stmt : program.body) {
+    const auto rhs = canonicalizer.canonicalize(stmt.rhs);
+    if (ir_equal(rhs, stmt.rhs)) continue;
+    stmt = IrStmt{stmt.lhs, rhs};
+    changed = true;
+  }
+  return changed;
+}
+
+namespace {
+
+/// Value number: equal numbers mean equal values
+typedef uint32_t ValueNumber;
+
+/// Hash-consed value numbers of expressions. An expression is numbered
+/// by what it computes (its kind, operator, callee or literal value, and
+/// the numbers of its operands), so all expressions computing the same
+/// value from the same values get the same number, whatever variables
+/// the values went through on the way.
+class IrValueNumbering {
+ public:
+  explicit IrValueNumbering(const std::string & pkt_name) : pkt_name_(pkt_name) {}
+
+  /// Number of expr, given the variables assigned so far through assign()
+  ValueNumber number(const IrExprPtr & expr) {
+    const auto & stripped = ir_strip_parens(expr);
+    if (ir_is_var(stripped)) {
+      const auto it = var_numbers_.find(ir_var_name(stripped, pkt_name_));
+      if (it != var_numbers_.end()) return it->second;
+    }
+    // Variables not assigned yet hold their input value: a leaf named after them
+    Key key{stripped->kind, stripped->name, stripped->value, {}};
+    for (const auto & operand : stripped->operands) key.operands.emplace_back(number(operand));
+    const auto it = numbers_.find(key);
+    if (it != numbers_.end()) return it->second;
+    const auto ret = next_number_++;
+    numbers_.emplace(std::move(key), ret);
+    return ret;
+  }
+
+  /// From now on, var holds the value of expr
+  void assign(const IrExprPtr & var, const IrExprPtr & expr) {
+    const auto value = number(expr);
+    var_numbers_[ir_var_name(ir_strip_parens(var), pkt_name_)] = value;
+  }
+
+  /// Number of the value var holds
+  ValueNumber value_of(const IrExprPtr & var) { return number(var); }
+
+ private:
+  /// What an expression computes: variables (by name) and literals are
+  /// leaves, everything else applies its operator to the values of its operands
+  struct Key {
+    IrExprKind kind;
+    std::string name;
+    int64_t value;
+    std::vector<ValueNumber> operands;
+
+    bool operator==(const Key & other) const {
+      return kind == other.kind and name == other.name and value == other.value and operands == other.operands;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key & key) const {
+      size_t ret = std::hash<std::string>()(key.name) * 31 + static_cast<size_t>(key.kind);
+      ret = ret * 31 + std::hash<int64_t>()(key.value);
+      for (const auto operand : key.operands) ret = ret * 31 + operand;
+      return ret;
+    }
+  };
+
+  /// Name of the packet, to tell packet fields from state variables
+  const std::string pkt_name_;
+
+  /// Number of every expression seen so far
+  std::unordered_map<Key, ValueNumber, KeyHash> numbers_ = {};
+  ValueNumber next_number_ = 0;
+
+  /// Number of the value every variable assigned so far holds, by ir_var_name
+  std::unordered_map<std::string, ValueNumber> var_numbers_ = {};
+};
+
+}  // namespace
+
+bool ir_gvn_transform(IrProgram & program, Context & ctx) {
+  // In SSA each packet field holds the value of its one definition,
+  // so one forward sweep numbers all of them. State variables may be
+  // assigned too: reads after that see the new value.
+  IrValueNumbering numbering(program.pkt_name);
+
+  // Packet fields holding each value, in lexical order
+  std::unordered_map<ValueNumber, std::vector<std::string>> holders;
+  std::vector<ValueNumber> order;
+  for (const auto & stmt : program.body) {
+    numbering.assign(stmt.lhs, stmt.rhs);
+    const auto & lhs = ir_strip_parens(stmt.lhs);
+    if (lhs->kind != IrExprKind::PKT_FIELD) continue;
+    const auto number = numbering.value_of(lhs);
+    auto & fields = holders[number];
+    if (fields.empty()) order.emplace_back(number);
+    fields.emplace_back(lhs->name);
+  }
+
+  // Rename every field holding a value to the last one holding it,
+  // which preserves the SSA renames. Fields the context doesn't allow us
+  // to optimize away keep their names, and the last of them is the one
+  // the others are renamed to.
+  std::map<std::string, std::string> repl_map;
+  for (const auto number : order) {
+    const auto & fields = holders.at(number);
+    if (fields.size() == 1) continue;
+    const auto kept = std::find_if(fields.rbegin(), fields.rend(),
+                                   [&ctx] (const auto & pkt_var) { return ctx.GetOptLevel(pkt_var) == D_NO_OPT; });
+    const auto & target = kept != fields.rend() ? *kept : fields.back();
+    for (const auto & pkt_var : fields) {
+      if (pkt_var != target and ctx.GetOptLevel(pkt_var) == D_OPT) repl_map[pkt_var] = target;
+    }
+  }
+  if (repl_map.empty()) return false;
+
+  const auto replace = [&repl_map] (const IrExprPtr & var) -> IrExprPtr {
+    if (var->kind != IrExprKind::PKT_FIELD) return nullptr;
+    const auto it = repl_map.find(var->name);
+    return it == repl_map.end() ? nullptr : ir_pkt_field(it->second);
+  };
+  for (auto & stmt : program.body) {
+    stmt = IrStmt{ir_replace_vars(stmt.lhs, replace), ir_replace_vars(stmt.rhs, replace)};
+  }
+  return true;
+}
+
+bool ir_cse_transform(IrProgram & program, Context &) {
+  // After GVN, statements computing the same value assign the same variable,
+  // so keep only the first assignment to each.
+  std::set<std::string> assigned;
+  std::vector<IrStmt> new_body;
+  for (const auto & stmt : program.body) {
+    if (assigned.emplace(ir_var_name(ir_strip_parens(stmt.lhs), program.pkt_name)).second) {
+      new_body.emplace_back(stmt);
+    }
+  }
+  const bool changed = new_body.size() != program.body.size();
+  program.body = new_body;
+  return changed;
+}
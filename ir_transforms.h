@@ -0,0 +1,102 @@
+#ifndef IR_TRANSFORMS_H_
+#define IR_TRANSFORMS_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "context.h"
+#include "domino_ir.h"
+
+/// Transform of a Domino program held in IR form,
+/// the IR counterpart of Transformer in compiler_pass.h.
+/// Records new variables in the program's Context.
+/// Returns true if it changed the program in any way.
+typedef std::function<bool(IrProgram &, Context &)> IrTransformer;
+
+/// Give up on a fixed point after this many iterations:
+/// a pass that hasn't converged by then is looping.
+const int kMaxFixedPointIterations = 1000;
+
+/// Run transformer until it reports no change, the IR counterpart of
+/// FixedPointPass. Throws std::logic_error naming pass_name if that
+/// takes more than kMaxFixedPointIterations.
+IrTransformer ir_fixed_point(const IrTransformer & transformer, const std::string & pass_name);
+
+/// Run transformers one after the other, the IR counterpart of CompoundPass
+IrTransformer ir_sequence(const std::vector<IrTransformer> & transformers);
+
+/// Each of the following mirrors the clang-based pass
+/// of the same name, operating on a program after if_converter.
+/// They don't check their preconditions, e.g., SSA form, themselves:
+/// populate_passes in domino.cc declares them through ir_pass (ir_analysis.h).
+
+/// Read state variables into packet temporaries at the start of the body
+/// and write them back at the end (stateful_flanks.h)
+bool ir_stateful_flanks_transform(IrProgram & program, Context & ctx);
+
+/// Algebraic simplification (algebraic_simplifier.h), plus annihilators
+/// (x * 0, x && 0) and boolean absorption (a && (a || b)). x || 0, x && 1
+/// and x && x are only rewritten to x if x is 0 or 1 already. Expressions are
+/// rewritten bottom-up into normal form in one traversal, so the result is
+/// already a fixed point. The default pipeline runs it twice: on if_converter's
+/// output, and after expr_propagater, which substitutes branch conditions
+/// into the predicates of ternaries.
+bool ir_algebra_simplify_transform(IrProgram & program, Context & ctx);
+
+/// Drop assignments of a variable to itself (elim_identical_lhs_rhs.h)
+bool ir_elim_identical_lhs_rhs_transform(IrProgram & program, Context & ctx);
+
+/// Rename every packet field definition (ssa.h)
+bool ir_ssa_transform(IrProgram & program, Context & ctx);
+
+/// Propagate expressions into copies and branch conditions (expr_prop.h)
+bool ir_expr_prop_transform(IrProgram & program, Context & ctx);
+
+/// Normalize parentheses around ternaries (paren_remover.h)
+bool ir_paren_remover_transform(IrProgram & program, Context & ctx);
+
+/// Give every branch condition a packet temporary (branch_var_creator.h)
+bool ir_branch_var_creator_transform(IrProgram & program, Context & ctx);
+
+/// Dead code elimination (dce.h). Removing a definition decrements the use
+/// counts of what it read, and only definitions whose count drops to zero
+/// are revisited, so one sweep reaches the fixed point.
+bool ir_dce_transform(IrProgram & program, Context & ctx);
+
+/// Remove declarations of unused packet fields (dde.h)
+bool ir_dde_transform(IrProgram & program, Context & ctx);
+
+/// Simplify conditions derived from the same SSA variable (flow_based_ite_simplifier.h)
+bool ir_flow_ite_simplify_transform(IrProgram & program, Context & ctx);
+
+/// Flatten packet fields into p_field variables (rename_pkt_fields.h).
+/// This only switches the printed form of the program, so it must run last.
+bool ir_rename_pkt_fields_transform(IrProgram & program, Context & ctx);
+
+/// Flatten expressions into x = y op z form using temporaries
+/// (expr_flattener_handler.h). Unlike the clang version, temporaries are
+/// flattened recursively, so a single sweep produces flat code.
+bool ir_expr_flattener_transform(IrProgram & program, Context & ctx);
+
+/// Propagate constants (const_prop.h), simplifying each statement as
+/// constants are substituted into it, so that constants discovered on the
+/// way are propagated in the same forward sweep.
+bool ir_const_prop_transform(IrProgram & program, Context & ctx);
+
+/// Bring every expression into a canonical form up to the order of
+/// operands: sort the operands of commutative operators other than && and ||,
+/// flatten chains of associative ones, and write > and >= as < and <=. This lets
+/// ir_gvn_transform tell that b + a computes the same value as a + b.
+bool ir_canonicalize_transform(IrProgram & program, Context & ctx);
+
+/// Merge packet variables holding the same value, found by global value
+/// numbering in one sweep instead of csi.h's pairwise comparisons.
+/// Unlike csi.h, this also covers conditional operators, copies, and
+/// operators and calls over expressions that aren't plain variables.
+bool ir_gvn_transform(IrProgram & program, Context & ctx);
+
+/// Drop redefinitions left behind by ir_gvn_transform (cse.h)
+bool ir_cse_transform(IrProgram & program, Context & ctx);
+
+#endif  // IR_TRANSFORMS_H_
@@ -0,0 +1,32 @@
+#include "name_allocator.h"
+
+void NameAllocator::reserve(const std::string & name) {
+  const auto symbol = symbols_.intern(name);
+  if (symbol >= taken_.size()) taken_.resize(symbol + 1, false);
+  taken_[symbol] = true;
+}
+
+void NameAllocator::reserve(const std::set<std::string> & names) {
+  for (const auto & name : names) reserve(name);
+}
+
+bool NameAllocator::taken(const std::string & name) const {
+  const auto symbol = symbols_.find(name);
+  return symbol != kNoSymbol and symbol < taken_.size() and taken_[symbol];
+}
+
+std::vector<std::string> NameAllocator::taken_names() const {
+  std::vector<std::string> ret;
+  for (Symbol symbol = 0; symbol < taken_.size(); symbol++) {
+    if (taken_[symbol]) ret.emplace_back(symbols_.name(symbol));
+  }
+  return ret;
+}
+
+std::string NameAllocator::allocate(const std::string & prefix) {
+  auto & next_suffix = next_suffix_[prefix];
+  std::string candidate = prefix + std::to_string(next_suffix++);
+  while (taken(candidate)) candidate = prefix + std::to_string(next_suffix++);
+  reserve(candidate);
+  return candidate;
+}
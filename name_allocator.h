@@ -0,0 +1,59 @@
+#ifndef NAME_ALLOCATOR_H_
+#define NAME_ALLOCATOR_H_
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "symbol_table.h"
+
+/// Hands out fresh identifiers prefix0, prefix1, ... that clash with
+/// no name reserved or handed out before. Taken names are flags by Symbol,
+/// and every prefix remembers the last suffix it handed out, so the next
+/// one is found without probing all the names taken before it again.
+/// Names are never released, so a prefix never needs to look below its
+/// last suffix: what it would find there is still taken.
+/// Every Context has one, shared by all passes over that program.
+class NameAllocator {
+ public:
+  /// Allocator interning names in symbols, which must outlive it
+  explicit NameAllocator(SymbolTable & symbols) : symbols_(symbols) {}
+  NameAllocator(const NameAllocator &) = delete;
+  NameAllocator & operator=(const NameAllocator &) = delete;
+
+  /// Mark names as taken, e.g., all identifiers of the program being
+  /// compiled, before allocating new ones for it
+  void reserve(const std::string & name);
+  void reserve(const std::set<std::string> & names);
+
+  /// Is name reserved or handed out?
+  bool taken(const std::string & name) const;
+
+  /// Fresh identifier prefix<N>, with N the smallest number past the last
+  /// one handed out for prefix that makes it fresh
+  std::string allocate(const std::string & prefix = "tmp");
+
+  /// Every name reserved or handed out so far, in no particular order
+  std::vector<std::string> taken_names() const;
+
+  /// Next suffix to try for every prefix that allocated a name
+  const std::unordered_map<std::string, uint64_t> & next_suffixes() const { return next_suffix_; }
+
+  /// Continue prefix at suffix, as if the names before it had been handed out,
+  /// e.g., to replay a pass's allocations without running it
+  void set_next_suffix(const std::string & prefix, uint64_t suffix) { next_suffix_[prefix] = suffix; }
+
+ private:
+  /// Symbol table the names are interned in
+  SymbolTable & symbols_;
+
+  /// Whether each symbol is taken, by Symbol
+  std::vector<bool> taken_ = {};
+
+  /// Next suffix to try for every prefix
+  std::unordered_map<std::string, uint64_t> next_suffix_ = {};
+};
+
+#endif  // NAME_ALLOCATOR_H_
@@ -0,0 +1,84 @@
+#include "parse_session.h"
+
+#include <iostream>
+#include <memory>
+
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/TargetOptions.h"
+#include "clang/Lex/Preprocessor.h"
+#include "clang/Parse/ParseAST.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "ast_printer.h"
+
+void ParseSession::SimpleDiag::HandleDiagnostic(clang::DiagnosticsEngine::Level DiagLevel __attribute__((unused)),
+                                                const clang::Diagnostic & diagnostic) {
+  llvm::SmallString<100> OutStr;
+  diagnostic.FormatDiagnostic(OutStr);
+  // Scripts look for this marker on stdout, so print it even though the exception carries the message too
+  std::cout << "ERROR ERROR CLANG ERROR: " << std::string(OutStr.str()) << std::endl;
+  throw std::logic_error("Clang compiler error: " + std::string(OutStr.str()));
+}
+
+ParseSession & ParseSession::get() {
+  static thread_local ParseSession session;
+  return session;
+}
+
+ParseSession::ParseSession() {
+  compiler_instance_.getDiagnosticOpts().Warnings.emplace_back("all");
+  compiler_instance_.createDiagnostics(& simple_diag_, false);
+  compiler_instance_.getLangOpts().CPlusPlus = 0;
+  compiler_instance_.getLangOpts().LineComment = 1;
+
+  // Initialize target info with the default triple for our platform.
+  auto TO = std::make_shared<clang::TargetOptions>();
+  TO->Triple = llvm::sys::getDefaultTargetTriple();
+  clang::TargetInfo *TI =
+  clang::TargetInfo::CreateTargetInfo(compiler_instance_.getDiagnostics(), TO);
+  compiler_instance_.setTarget(TI);
+
+  // The FileManager outlives individual programs,
+  // so stat()s of included headers are cached across passes.
+  compiler_instance_.createFileManager();
+}
+
+void ParseSession::reset_program_state() {
+  compiler_instance_.setASTContext(nullptr);
+  compiler_instance_.setPreprocessor(nullptr);
+  compiler_instance_.setSourceManager(nullptr);
+}
+
+void ParseSession::parse(const std::string & string_to_parse, clang::ASTConsumer & consumer) {
+  reset_program_state();
+
+  compiler_instance_.createSourceManager(compiler_instance_.getFileManager());
+  clang::SourceManager &SourceMgr = compiler_instance_.getSourceManager();
+  compiler_instance_.createPreprocessor(clang::TU_Module);
+  compiler_instance_.createASTContext();
+
+  // Hand string_to_parse to the source manager as an in-memory main file,
+  // so that no pass ever touches the disk. Quoted #includes still resolve
+  // relative to the current directory, exactly as they did for the
+  // temporary files we used to write there.
+  SourceMgr.setMainFileID(SourceMgr.createFileID(
+      llvm::MemoryBuffer::getMemBufferCopy(string_to_parse, kBufferName),
+      clang::SrcMgr::C_User));
+  compiler_instance_.getDiagnosticClient().BeginSourceFile(
+      compiler_instance_.getLangOpts(), &compiler_instance_.getPreprocessor());
+
+  // Parse the file to AST, registering consumer as the AST consumer.
+  // Passes print nodes through printer, whose cache is only valid
+  // while this ASTContext lives.
+  AstPrinter printer;
+  AstPrinter::Scope printing(printer);
+  clang::ParseAST(compiler_instance_.getPreprocessor(), &consumer,
+                  compiler_instance_.getASTContext());
+
+  compiler_instance_.getDiagnosticClient().EndSourceFile();
+}
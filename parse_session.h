@@ -0,0 +1,53 @@
+#ifndef PARSE_SESSION_H_
+#define PARSE_SESSION_H_
+
+#include <string>
+
+#include "clang/AST/ASTConsumer.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Frontend/CompilerInstance.h"
+
+/// A warm clang front end shared by every pass.
+/// Setting up diagnostics, the TargetInfo for the default triple,
+/// the language options and the FileManager is done once per thread.
+/// Each call to parse() then only creates what is specific to one
+/// program: a SourceManager, a Preprocessor and a fresh ASTContext.
+class ParseSession {
+ public:
+  /// Get the session for this thread, creating it on first use.
+  /// Each thread gets its own, since a CompilerInstance can only parse one program at a time.
+  static ParseSession & get();
+
+  /// Parse string_to_parse (held in memory, never written to disk)
+  /// and hand the resulting translation unit to consumer.
+  /// The ASTContext handed to consumer is only valid during the call.
+  void parse(const std::string & string_to_parse, clang::ASTConsumer & consumer);
+
+  /// No copies: the session owns a clang::CompilerInstance
+  ParseSession(const ParseSession &) = delete;
+  ParseSession & operator=(const ParseSession &) = delete;
+
+ private:
+  /// Set up the per-process part of the compiler instance
+  ParseSession();
+
+  /// Throw away the per-program state left behind by the previous parse,
+  /// in the reverse order of creation so that nothing dangles.
+  void reset_program_state();
+
+  /// SimpleDiag, TODO: Add FixIt hints and other goodies to make it comparable to gcc/clang
+  class SimpleDiag : public clang::DiagnosticConsumer {
+    void HandleDiagnostic(clang::DiagnosticsEngine::Level DiagLevel __attribute__((unused)),
+                          const clang::Diagnostic & diagnostic) override;
+  };
+  SimpleDiag simple_diag_ = {};
+
+  /// clang::CompilerInstance holds the instance of the Clang compiler for us,
+  /// managing the various objects needed to run the compiler.
+  clang::CompilerInstance compiler_instance_ = {};
+
+  /// Name under which the in-memory buffer shows up in clang's diagnostics
+  static constexpr const char * kBufferName = "domino_input.c";
+};
+
+#endif  // PARSE_SESSION_H_
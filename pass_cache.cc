@@ -0,0 +1,157 @@
+#include "pass_cache.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+
+#include "util.h"
+
+namespace {
+
+/// 128-bit FNV-1a, wide enough that keys don't collide in practice
+std::string fnv1a_128(const std::string & data) {
+  const unsigned __int128 prime = (static_cast<unsigned __int128>(1) << 88) + 0x13B;
+  unsigned __int128 hash = (static_cast<unsigned __int128>(0x6c62272e07bb0142ULL) << 64) + 0x62b821756295c58dULL;
+  for (const unsigned char c : data) {
+    hash ^= c;
+    hash *= prime;
+  }
+  std::string hex;
+  for (int i = 0; i < 32; i++) {
+    hex += "0123456789abcdef"[static_cast<unsigned>(hash & 0xf)];
+    hash >>= 4;
+  }
+  return hex;
+}
+
+std::string join_lines(const std::vector<std::string> & lines) {
+  std::string ret;
+  for (const auto & line : lines) ret += line + "\n";
+  return ret;
+}
+
+/// Lines in after but not in before, both sorted
+std::vector<std::string> added_lines(const std::vector<std::string> & before, const std::vector<std::string> & after) {
+  std::vector<std::string> ret;
+  std::set_difference(after.begin(), after.end(), before.begin(), before.end(), std::back_inserter(ret));
+  return ret;
+}
+
+/// Identifies the build of the running binary by its size and modification
+/// time, which every rebuild changes, without reading all of it.
+/// Computed once per process: the binary doesn't change under a running one.
+const std::string & current_build_id() {
+  static const std::string build_id = []() -> std::string {
+    std::error_code error;
+    const std::filesystem::path exe = std::filesystem::read_symlink("/proc/self/exe", error);
+    if (not error) {
+      const auto size = std::filesystem::file_size(exe, error);
+      const auto mtime = std::filesystem::last_write_time(exe, error);
+      if (not error) {
+        return fnv1a_128(encode_fields({exe.string(), std::to_string(size),
+                                        std::to_string(mtime.time_since_epoch().count())}));
+      }
+    }
+    // Without /proc, rebuilding the cache after rebuilding the binary is up to the user
+    return __DATE__ " " __TIME__;
+  }();
+  return build_id;
+}
+
+const std::string kCacheTag = "domino-cache-2";
+
+}  // namespace
+
+PassCache::PassCache(const std::string & t_directory, const std::string & config)
+    : directory_(t_directory),
+      build_id_(config.empty() ? current_build_id() : fnv1a_128(encode_fields({current_build_id(), config}))) {
+  std::filesystem::create_directories(directory_);
+}
+
+std::string PassCache::key(const std::string & step_name, const std::string & input, const Context & ctx) const {
+  return fnv1a_128(encode_fields({kCacheTag, build_id_, step_name, input, join_lines(ctx.Entries())}));
+}
+
+std::string PassCache::path(const std::string & key) const {
+  return (std::filesystem::path(directory_) / key.substr(0, 2) / key.substr(2)).string();
+}
+
+bool PassCache::lookup(const std::string & key, CachedStep & step) const {
+  std::ifstream in(path(key), std::ios::binary);
+  if (not in.good()) return false;
+  std::stringstream contents;
+  contents << in.rdbuf();
+  try {
+    const auto fields = decode_fields(contents.str(), 4);
+    if (fields.at(0) != kCacheTag) return false;
+    step.output = fields.at(1);
+    step.context_delta = split(fields.at(2), "\n");
+    step.log = fields.at(3);
+    // split keeps an empty last element after the trailing newline
+    step.context_delta.erase(std::remove(step.context_delta.begin(), step.context_delta.end(), ""),
+                             step.context_delta.end());
+    return true;
+  } catch (const std::exception &) {
+    // e.g., a file truncated by a full disk: recompute it
+    return false;
+  }
+}
+
+void PassCache::store(const std::string & key, const CachedStep & step) const {
+  try {
+    const auto file_name = path(key);
+    std::filesystem::create_directories(std::filesystem::path(file_name).parent_path());
+    // Write to a file of our own first, so that
+    // readers only ever see complete entries.
+    const auto tmp_name = file_name + ".tmp." + std::to_string(getpid()) + "." +
+                          std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+      std::ofstream out(tmp_name, std::ios::binary);
+      out << encode_fields({kCacheTag, step.output, join_lines(step.context_delta), step.log});
+      if (not out.good()) {
+        std::filesystem::remove(tmp_name);
+        return;
+      }
+    }
+    std::filesystem::rename(tmp_name, file_name);
+  } catch (const std::exception &) {
+    // Not cached this time
+  }
+}
+
+std::string PassCache::run(const std::string & step_name, const std::string & input, Context & ctx,
+                           const std::function<std::string(const std::string &)> & step_fn) const {
+  const auto before = ctx.Entries();
+  const auto step_key = key(step_name, input, ctx);
+
+  CachedStep step;
+  if (lookup(step_key, step)) {
+    ctx.Apply(step.context_delta);
+    ctx.Log() << step.log;
+    return step.output;
+  }
+
+  // Capture the step's log to cache it, passing it on as it would have gone anyway
+  std::ostream & log = ctx.Log();
+  std::ostringstream step_log;
+  ctx.SetLog(step_log);
+  try {
+    step.output = step_fn(input);
+  } catch (...) {
+    ctx.SetLog(log);
+    log << step_log.str();
+    throw;
+  }
+  ctx.SetLog(log);
+  log << step_log.str();
+
+  step.context_delta = added_lines(before, ctx.Entries());
+  step.log = step_log.str();
+  store(step_key, step);
+  return step.output;
+}
@@ -0,0 +1,65 @@
+#ifndef PASS_CACHE_H_
+#define PASS_CACHE_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "context.h"
+
+/// Everything needed to replay one step of the pipeline without running it
+struct CachedStep {
+  /// Program the step produced
+  std::string output;
+
+  /// Context::Entries() lines the step added or changed
+  std::vector<std::string> context_delta;
+
+  /// What the step wrote to Context::Log(), e.g., rename maps
+  std::string log;
+};
+
+/// On-disk, content-addressed cache of pipeline steps, shared by every
+/// program and pipeline that uses the same directory. A step's key hashes
+/// its name (for a run of IR passes, the names of all of them), its input
+/// program, the Context it starts from, and the domino binary itself
+/// (with its configuration, e.g., --rules), so
+/// a step is reused exactly when rerunning it would do the same thing,
+/// e.g., the passes that the default and --noopt pipelines share.
+/// Safe to use from several threads and processes at once.
+class PassCache {
+ public:
+  /// Cache in directory, creating it if needed. config is anything besides
+  /// the binary that changes what steps do, e.g., the rules of --rules,
+  /// and keys every step along with the binary.
+  explicit PassCache(const std::string & t_directory, const std::string & config = "");
+
+  /// Run step_fn, the step named step_name, on input with ctx, unless
+  /// the cache already has its result, in which case ctx and ctx.Log()
+  /// are updated as if it had run. Steps that throw aren't cached.
+  std::string run(const std::string & step_name, const std::string & input, Context & ctx,
+                  const std::function<std::string(const std::string &)> & step_fn) const;
+
+ private:
+  /// Key of running step_name on input with ctx
+  std::string key(const std::string & step_name, const std::string & input, const Context & ctx) const;
+
+  /// File holding the step with this key
+  std::string path(const std::string & key) const;
+
+  /// Read the step with this key into step, returning false if it isn't cached
+  bool lookup(const std::string & key, CachedStep & step) const;
+
+  /// Save step under this key, silently giving up if that fails:
+  /// the cache only saves time, it is never needed for correctness.
+  void store(const std::string & key, const CachedStep & step) const;
+
+  /// Directory holding one file per cached step
+  std::string directory_;
+
+  /// Hash of the running binary's identity and config, so that a rebuilt or
+  /// reconfigured compiler never reuses the results of an older one
+  std::string build_id_;
+};
+
+#endif  // PASS_CACHE_H_
@@ -0,0 +1,114 @@
+#include "pass_profiler.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "third_party/assert_exception.h"
+
+thread_local PassProfiler * PassProfiler::active_ = nullptr;
+
+namespace {
+
+long peak_rss_kb() {
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  // Linux reports ru_maxrss in KB
+  return usage.ru_maxrss;
+}
+
+/// Every statement and declaration of a Domino program ends with a semicolon
+size_t count_statements(const std::string & program) {
+  return static_cast<size_t>(std::count(program.begin(), program.end(), ';'));
+}
+
+std::string json_string(const std::string & str) {
+  std::string ret = "\"";
+  for (const char c : str) {
+    if (c == '"' or c == '\\') ret += '\\';
+    ret += c;
+  }
+  return ret + "\"";
+}
+
+std::string ms(const double seconds) {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2) << seconds * 1000.0;
+  return out.str();
+}
+
+}  // namespace
+
+void PassProfiler::begin_pass(const std::string & name, const std::string & input) {
+  PassTiming timing = {name, static_cast<int>(running_.size()), 0.0, 0.0, 0.0, 0.0, 0,
+                       input.size(), 0, count_statements(input), 0, {}};
+  timings_.emplace_back(timing);
+  running_.emplace_back(Running{timings_.size() - 1, std::chrono::steady_clock::now(), peak_rss_kb()});
+}
+
+void PassProfiler::end_pass(const std::string & output) {
+  assert_exception(not running_.empty());
+  const auto running = running_.back();
+  running_.pop_back();
+  auto & timing = timings_.at(running.index);
+  timing.total_seconds = seconds_since(running.start);
+  timing.peak_rss_delta_kb = peak_rss_kb() - running.peak_rss_kb;
+  timing.bytes_out = output.size();
+  timing.statements_out = count_statements(output);
+}
+
+void print_timing_table(std::ostream & out, const std::vector<PassTiming> & timings) {
+  out << std::left << std::setw(32) << "pass" << std::right
+      << std::setw(11) << "parse ms" << std::setw(13) << "transform ms" << std::setw(10) << "print ms"
+      << std::setw(10) << "total ms" << std::setw(7) << "iters" << std::setw(10) << "rss +KB"
+      << std::setw(18) << "bytes in -> out" << std::setw(16) << "stmts in -> out" << std::endl;
+
+  // Passes inside a run of IR passes are already counted in the run
+  PassTiming total = {"total", 0, 0.0, 0.0, 0.0, 0.0, 0, 0, 0, 0, 0, {}};
+  for (const auto & timing : timings) {
+    out << std::left << std::setw(32) << (std::string(2 * timing.depth, ' ') + timing.name) << std::right
+        << std::setw(11) << ms(timing.parse_seconds) << std::setw(13) << ms(timing.transform_seconds)
+        << std::setw(10) << ms(timing.print_seconds) << std::setw(10) << ms(timing.total_seconds)
+        << std::setw(7) << std::max<size_t>(1, timing.iteration_seconds.size())
+        << std::setw(10) << timing.peak_rss_delta_kb
+        << std::setw(18) << (std::to_string(timing.bytes_in) + " -> " + std::to_string(timing.bytes_out))
+        << std::setw(16) << (std::to_string(timing.statements_in) + " -> " + std::to_string(timing.statements_out))
+        << std::endl;
+    if (timing.depth == 0) {
+      total.parse_seconds += timing.parse_seconds;
+      total.transform_seconds += timing.transform_seconds;
+      total.print_seconds += timing.print_seconds;
+      total.total_seconds += timing.total_seconds;
+      total.peak_rss_delta_kb += timing.peak_rss_delta_kb;
+    }
+  }
+  out << std::left << std::setw(32) << total.name << std::right
+      << std::setw(11) << ms(total.parse_seconds) << std::setw(13) << ms(total.transform_seconds)
+      << std::setw(10) << ms(total.print_seconds) << std::setw(10) << ms(total.total_seconds)
+      << std::setw(7) << "" << std::setw(10) << total.peak_rss_delta_kb << std::endl;
+}
+
+void print_timing_json(std::ostream & out, const std::vector<PassTiming> & timings) {
+  out << "[";
+  for (size_t i = 0; i < timings.size(); i++) {
+    const auto & timing = timings.at(i);
+    out << (i == 0 ? "\n" : ",\n")
+        << "  {\"pass\": " << json_string(timing.name) << ", \"depth\": " << timing.depth
+        << ", \"parse_seconds\": " << timing.parse_seconds
+        << ", \"transform_seconds\": " << timing.transform_seconds
+        << ", \"print_seconds\": " << timing.print_seconds
+        << ", \"total_seconds\": " << timing.total_seconds
+        << ", \"peak_rss_delta_kb\": " << timing.peak_rss_delta_kb
+        << ", \"bytes_in\": " << timing.bytes_in << ", \"bytes_out\": " << timing.bytes_out
+        << ", \"statements_in\": " << timing.statements_in << ", \"statements_out\": " << timing.statements_out
+        << ", \"iterations\": " << std::max<size_t>(1, timing.iteration_seconds.size())
+        << ", \"iteration_seconds\": [";
+    for (size_t j = 0; j < timing.iteration_seconds.size(); j++) {
+      out << (j == 0 ? "" : ", ") << timing.iteration_seconds.at(j);
+    }
+    out << "]}";
+  }
+  out << "\n]" << std::endl;
+}
@@ -0,0 +1,111 @@
+#ifndef PASS_PROFILER_H_
+#define PASS_PROFILER_H_
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// Where one pass spent its time, and what it did to the program
+struct PassTiming {
+  /// Name of the pass
+  std::string name;
+
+  /// 0 for a step of the pipeline, 1 for a pass inside a run of IR passes
+  int depth;
+
+  /// Wall time parsing its input (clang, or the IR builder)
+  double parse_seconds;
+
+  /// Wall time transforming. For clang passes this includes printing the
+  /// output, which they produce as text while walking the AST.
+  double transform_seconds;
+
+  /// Wall time printing its output, for IR passes
+  double print_seconds;
+
+  /// Wall time from start to end, including what the columns above miss,
+  /// e.g., setting up the pass or replaying it from the cache
+  double total_seconds;
+
+  /// Growth of the process's peak resident set size, in KB
+  long peak_rss_delta_kb;
+
+  /// Size of the program before and after the pass
+  size_t bytes_in, bytes_out;
+  size_t statements_in, statements_out;
+
+  /// Wall time of each iteration of a fixed point pass, empty for other passes
+  std::vector<double> iteration_seconds;
+};
+
+/// Collects a PassTiming for every pass run on one thread while it is active.
+/// Passes report to whichever profiler is active on their thread,
+/// so nothing has to be threaded through the pass interfaces,
+/// and passes pay only for a null check when no profiler is active.
+class PassProfiler {
+ public:
+  PassProfiler() {}
+  PassProfiler(const PassProfiler &) = delete;
+  PassProfiler & operator=(const PassProfiler &) = delete;
+
+  /// Profiler of the calling thread, or nullptr if none is active
+  static PassProfiler * active() { return active_; }
+
+  /// Make a profiler the active one of the calling thread until destroyed
+  class Scope {
+   public:
+    explicit Scope(PassProfiler & profiler) : previous_(active_) { active_ = &profiler; }
+    ~Scope() { active_ = previous_; }
+    Scope(const Scope &) = delete;
+    Scope & operator=(const Scope &) = delete;
+   private:
+    PassProfiler * previous_;
+  };
+
+  /// Start a pass named name on input, nested in the pass
+  /// that is already running if there is one
+  void begin_pass(const std::string & name, const std::string & input);
+
+  /// End the innermost running pass, which produced output
+  void end_pass(const std::string & output);
+
+  /// Attribute time to the innermost running pass, if any
+  void add_parse(const double seconds) { if (current()) current()->parse_seconds += seconds; }
+  void add_transform(const double seconds) { if (current()) current()->transform_seconds += seconds; }
+  void add_print(const double seconds) { if (current()) current()->print_seconds += seconds; }
+  void add_iteration(const double seconds) { if (current()) current()->iteration_seconds.emplace_back(seconds); }
+
+  /// Every pass, in the order they started
+  const std::vector<PassTiming> & timings() const { return timings_; }
+
+ private:
+  PassTiming * current() { return running_.empty() ? nullptr : &timings_.at(running_.back().index); }
+
+  /// The active profiler of each thread
+  static thread_local PassProfiler * active_;
+
+  std::vector<PassTiming> timings_ = {};
+
+  /// Indices in timings_ of the running passes, innermost last,
+  /// with when they started and the peak RSS at that time
+  struct Running {
+    size_t index;
+    std::chrono::steady_clock::time_point start;
+    long peak_rss_kb;
+  };
+  std::vector<Running> running_ = {};
+};
+
+/// Seconds elapsed since start
+inline double seconds_since(const std::chrono::steady_clock::time_point & start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// Print timings as a table, one row per pass, followed by totals
+void print_timing_table(std::ostream & out, const std::vector<PassTiming> & timings);
+
+/// Print timings as a JSON array with one object per pass
+void print_timing_json(std::ostream & out, const std::vector<PassTiming> & timings);
+
+#endif  // PASS_PROFILER_H_
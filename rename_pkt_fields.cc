@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <iostream>
+#include <sstream>
 
 #include "third_party/assert_exception.h"
 
@@ -32,11 +33,12 @@ std::string get_pkt_prefix(const TranslationUnitDecl *tu_decl) {
   return "p_";
 }
 
-std::string rename_pkt_fields_transform(const TranslationUnitDecl *tu_decl) {
+std::string rename_pkt_fields_transform(const TranslationUnitDecl *tu_decl, Context &ctx) {
 
   const auto &id_set = identifier_census(tu_decl);
 
-  // Storage for returned string
+  // Storage for returned string: declarations first, then the body
+  std::ostringstream decls;
   std::string ret;
   std::string pkt_prefix = get_pkt_prefix(tu_decl);
   // Create unique identifier generator
@@ -60,23 +62,23 @@ std::string rename_pkt_fields_transform(const TranslationUnitDecl *tu_decl) {
   std::set<std::string> statelessVars =
       identifier_census(tu_decl, packetVarsSel);
   for (const auto &statelessVar : statelessVars) {
-    if (Context::GetContext().GetType(statelessVar) == D_BIT)
+    if (ctx.GetType(statelessVar) == D_BIT)
       branchVars.insert(statelessVar);
     else {
-      std::cout << "int " << pkt_prefix << statelessVar << ";" << std::endl;
+      decls << "int " << pkt_prefix << statelessVar << ";" << std::endl;
     }
   }
-  std::cout << "# state variables start" << std::endl;
+  decls << "# state variables start" << std::endl;
   for (const auto &stateVar : stateVars) {
-    std::cout << "int " << stateVar << ";" << std::endl;
+    decls << "int " << stateVar << ";" << std::endl;
   }
-  std::cout << "# state variables end" << std::endl;
+  decls << "# state variables end" << std::endl;
   for (const auto &branchVar : branchVars) {
-    std::cout << "bit " << pkt_prefix << branchVar << ";" << std::endl;
+    decls << "bit " << pkt_prefix << branchVar << ";" << std::endl;
   }
-  std::cout << "# packet vars start" << std::endl;
-  Context::GetContext().PrintPktVars(pkt_prefix);
-  std::cout << "# declarations end" << std::endl;
+  decls << "# packet vars start" << std::endl;
+  ctx.PrintPktVars(decls, pkt_prefix);
+  decls << "# declarations end" << std::endl;
   for (const auto *child_decl : dyn_cast<DeclContext>(tu_decl)->decls()) {
     assert_exception(child_decl);
     if (isa<VarDecl>(child_decl) or isa<RecordDecl>(child_decl)) {
@@ -102,8 +104,7 @@ std::string rename_pkt_fields_transform(const TranslationUnitDecl *tu_decl) {
           dyn_cast<clang::CompoundStmt>(function_decl->getBody()), pkt_name);
     }
   }
-  std::cout << ret << std::endl;
-  return ret;
+  return decls.str() + ret;
 }
 
 std::string rename_pkt_fields_body(const clang::CompoundStmt *function_body,
@@ -7,12 +7,16 @@
 #include <map>
 #include "clang/AST/Expr.h"
 
+#include "context.h"
+
 
 /// Entry point for pass that rewrites packet fields from p.xxx to p_xxx
 /// This renaming pass comes last in the frontend pass pipeline, and 
 /// will prepare the SSA'd Domino code for being lowered into the mid-end
 /// dependency and SCC graphs, and finally for Sketch synthesis.
-std::string rename_pkt_fields_transform(const clang::TranslationUnitDecl * tu_decl);
+/// Returns the variable declarations (up to "# declarations end")
+/// followed by the renamed statements, one per line.
+std::string rename_pkt_fields_transform(const clang::TranslationUnitDecl * tu_decl, Context & ctx);
 
 /// Main function for packet
 std::string rename_pkt_fields_body(const clang::CompoundStmt * function_body, const std::string & pkt_name __attribute__((unused)));
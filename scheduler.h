@@ -0,0 +1,278 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+
+/// Resources of the switch pipeline a program has to fit in:
+/// a fixed number of stages, each with a fixed number of ALUs
+/// for stateless operations and for stateful operations (atoms).
+struct PipelineModel {
+  uint32_t num_stages;
+  uint32_t stateless_alus_per_stage;
+  uint32_t stateful_alus_per_stage;
+};
+
+/// Kind of ALU an operation runs on
+enum class AluKind { STATELESS, STATEFUL };
+
+/// What a node of the dependency graph needs from the pipeline: it occupies
+/// one ALU of kind alu in each of latency consecutive stages,
+/// and its successors can start in the stage after the last of those.
+struct Operation {
+  uint32_t latency;
+  AluKind alu;
+};
+
+/// Start stages of every node by ID ignoring resources,
+/// i.e., as if every stage had unlimited ALUs
+struct TimingBounds {
+  /// Earliest start stage (as soon as possible)
+  std::vector<uint32_t> asap;
+
+  /// Latest start stage that doesn't lengthen the critical path
+  /// (as late as possible)
+  std::vector<uint32_t> alap;
+
+  /// Number of stages on the critical path, a lower bound for any schedule
+  uint32_t length;
+};
+
+/// Stage assignment of a list schedule, and how it uses the pipeline
+struct PipelineSchedule {
+  /// Start stage of every node by ID
+  std::vector<uint32_t> stage;
+
+  /// How many stages later every node could start without delaying one of its
+  /// successors or lengthening the schedule. Nodes with slack 0 are critical.
+  /// Only dependences are accounted for: moving a node may still need an ALU
+  /// that is taken in its new stage.
+  std::vector<uint32_t> slack;
+
+  /// ALUs in use in every stage, one entry per stage of the schedule
+  std::vector<uint32_t> stateless_occupancy;
+  std::vector<uint32_t> stateful_occupancy;
+
+  /// Number of stages the schedule uses
+  uint32_t length;
+
+  /// Number of stages on the critical path, see TimingBounds
+  uint32_t critical_path_length;
+
+  /// Whether the schedule fits in the stages of the pipeline model
+  bool fits;
+};
+
+/// Operation of every node by ID, evaluating operation once per node
+template <class NodeType>
+std::vector<Operation>
+operations_by_id(const Graph<NodeType> &dag,
+                 const std::function<Operation(const NodeType &)> &operation) {
+  std::vector<Operation> ops;
+  ops.reserve(dag.num_nodes());
+  for (const auto &node : dag.nodes()) {
+    ops.emplace_back(operation(node));
+    if (ops.back().latency == 0)
+      throw std::logic_error("Operation of node " + std::to_string(ops.size() - 1) +
+                             " has latency 0, every operation takes at least one stage\n");
+  }
+  return ops;
+}
+
+/// ASAP and ALAP start stages of every node of an acyclic graph, in O(V + E):
+/// one sweep over a topological order and one back. This is critical path
+/// scheduling, folklore by now (https://en.wikipedia.org/wiki/Critical_path_method)
+/// but going back to Kelley and Walker (1959):
+/// http://dl.acm.org/citation.cfm?id=1460318
+template <class NodeType>
+TimingBounds timing_bounds(const Graph<NodeType> &dag,
+                           const std::vector<Operation> &ops) {
+  assert_exception(ops.size() == dag.num_nodes());
+  const auto order = dag.topological_order();
+
+  TimingBounds bounds = {std::vector<uint32_t>(dag.num_nodes(), 0), {}, 0};
+  for (const auto node : order) {
+    const auto finish = bounds.asap.at(node) + ops.at(node).latency;
+    for (const auto neighbor : dag.succ(node))
+      bounds.asap.at(neighbor) = std::max(bounds.asap.at(neighbor), finish);
+    bounds.length = std::max(bounds.length, finish);
+  }
+
+  bounds.alap.resize(dag.num_nodes());
+  for (auto it = order.rbegin(); it != order.rend(); it++) {
+    auto latest_finish = bounds.length;
+    for (const auto neighbor : dag.succ(*it))
+      latest_finish = std::min(latest_finish, bounds.alap.at(neighbor));
+    bounds.alap.at(*it) = latest_finish - ops.at(*it).latency;
+  }
+  return bounds;
+}
+
+/// Resource-constrained list scheduling of an acyclic graph onto a pipeline.
+/// Stages are filled in order: in every stage, the nodes whose predecessors
+/// have finished are placed by increasing ALAP stage (least slack first, then
+/// by ID), as long as an ALU of their kind is free in every stage they occupy,
+/// and the rest wait for the next stage. With unit latencies this takes
+/// O((V + E) log V + stages); nodes spanning several stages add O(log V)
+/// whenever one is passed over because a later stage it spans is full.
+/// The schedule uses as many stages as it needs: check fits to see if it
+/// fits in the pipeline.
+/// Throws if a node needs an ALU kind the pipeline doesn't have.
+template <class NodeType>
+PipelineSchedule list_schedule(const Graph<NodeType> &dag,
+                               const std::vector<Operation> &ops,
+                               const PipelineModel &model) {
+  assert_exception(ops.size() == dag.num_nodes());
+  typedef typename Graph<NodeType>::NodeId NodeId;
+  const auto bounds = timing_bounds(dag, ops);
+
+  PipelineSchedule schedule = {std::vector<uint32_t>(dag.num_nodes(), 0),
+                               std::vector<uint32_t>(dag.num_nodes(), 0),
+                               {}, {}, 0, bounds.length, false};
+  const auto capacity = [&model](const AluKind alu) {
+    return alu == AluKind::STATEFUL ? model.stateful_alus_per_stage
+                                    : model.stateless_alus_per_stage;
+  };
+  const auto occupancy = [&schedule](const AluKind alu) -> std::vector<uint32_t> & {
+    return alu == AluKind::STATEFUL ? schedule.stateful_occupancy
+                                    : schedule.stateless_occupancy;
+  };
+  for (NodeId i = 0; i < dag.num_nodes(); i++) {
+    if (capacity(ops.at(i).alu) == 0)
+      throw std::logic_error("Node " + dag.node_printer()(dag.node(i)) +
+                             " needs a " + (ops.at(i).alu == AluKind::STATEFUL ? "stateful" : "stateless") +
+                             " ALU, but the pipeline has none\n");
+  }
+
+  // Nodes are waiting until their predecessors finish, ordered by the stage
+  // that happens in, then ready, ordered by ALAP stage, one queue per ALU kind
+  typedef std::pair<uint32_t, NodeId> Keyed;
+  typedef std::priority_queue<Keyed, std::vector<Keyed>, std::greater<Keyed>> Queue;
+  Queue waiting;
+  std::map<AluKind, Queue> ready = {{AluKind::STATELESS, Queue()}, {AluKind::STATEFUL, Queue()}};
+  std::vector<uint32_t> unscheduled_preds(dag.num_nodes());
+  std::vector<uint32_t> earliest(dag.num_nodes(), 0);
+  for (NodeId i = 0; i < dag.num_nodes(); i++) {
+    unscheduled_preds.at(i) = dag.pred(i).size();
+    if (unscheduled_preds.at(i) == 0) waiting.emplace(0, i);
+  }
+
+  const auto used_in = [&occupancy](const AluKind alu, const uint32_t stage) {
+    const auto &used = occupancy(alu);
+    return stage < used.size() ? used.at(stage) : 0;
+  };
+  const auto free_alus = [&](const NodeId node, const uint32_t start) {
+    for (auto s = start; s < start + ops.at(node).latency; s++)
+      if (used_in(ops.at(node).alu, s) >= capacity(ops.at(node).alu)) return false;
+    return true;
+  };
+
+  size_t num_scheduled = 0;
+  for (uint32_t stage = 0; num_scheduled < dag.num_nodes(); stage++) {
+    // Skip stages in which nothing can start
+    if (ready.at(AluKind::STATELESS).empty() and ready.at(AluKind::STATEFUL).empty())
+      stage = std::max(stage, waiting.top().first);
+    while (not waiting.empty() and waiting.top().first <= stage) {
+      const auto node = waiting.top().second;
+      waiting.pop();
+      ready.at(ops.at(node).alu).emplace(bounds.alap.at(node), node);
+    }
+
+    // Only look at as many nodes of each kind as there are ALUs left in this
+    // stage, and the ones that don't fit because of a later stage they span
+    for (auto &kind_and_queue : ready) {
+      const auto alu = kind_and_queue.first;
+      auto &queue = kind_and_queue.second;
+      std::vector<Keyed> deferred;
+      while (not queue.empty() and used_in(alu, stage) < capacity(alu)) {
+        const auto candidate = queue.top();
+        queue.pop();
+        const auto node = candidate.second;
+        if (not free_alus(node, stage)) {
+          deferred.emplace_back(candidate);
+          continue;
+        }
+
+        schedule.stage.at(node) = stage;
+        num_scheduled++;
+        const auto finish = stage + ops.at(node).latency;
+        auto &used = occupancy(alu);
+        if (used.size() < finish) used.resize(finish, 0);
+        for (auto s = stage; s < finish; s++) used.at(s)++;
+        schedule.length = std::max(schedule.length, finish);
+
+        for (const auto neighbor : dag.succ(node)) {
+          earliest.at(neighbor) = std::max(earliest.at(neighbor), finish);
+          if (--unscheduled_preds.at(neighbor) == 0)
+            waiting.emplace(earliest.at(neighbor), neighbor);
+        }
+      }
+      for (const auto &candidate : deferred) queue.emplace(candidate);
+    }
+  }
+  schedule.stateless_occupancy.resize(schedule.length, 0);
+  schedule.stateful_occupancy.resize(schedule.length, 0);
+  schedule.fits = schedule.length <= model.num_stages;
+
+  for (NodeId i = 0; i < dag.num_nodes(); i++) {
+    auto latest_finish = schedule.length;
+    for (const auto neighbor : dag.succ(i))
+      latest_finish = std::min(latest_finish, schedule.stage.at(neighbor));
+    schedule.slack.at(i) = latest_finish - (schedule.stage.at(i) + ops.at(i).latency);
+  }
+  return schedule;
+}
+
+/// Print a schedule one stage per line, with the ALUs it uses
+/// and the nodes that start in it, each with its slack.
+/// Every line is a // comment, even for nodes that print as several lines.
+template <class NodeType>
+void print_schedule(std::ostream &out, const Graph<NodeType> &dag,
+                    const PipelineSchedule &schedule,
+                    const PipelineModel &model) {
+  std::vector<std::vector<typename Graph<NodeType>::NodeId>> starting(schedule.length);
+  for (typename Graph<NodeType>::NodeId i = 0; i < dag.num_nodes(); i++)
+    starting.at(schedule.stage.at(i)).emplace_back(i);
+
+  out << "// " << schedule.length << " stages used of " << model.num_stages
+      << ", critical path " << schedule.critical_path_length << " stages"
+      << (schedule.fits ? "" : ": DOES NOT FIT") << "\n";
+  for (uint32_t stage = 0; stage < schedule.length; stage++) {
+    out << "// stage " << stage << ": stateless "
+        << schedule.stateless_occupancy.at(stage) << "/" << model.stateless_alus_per_stage
+        << ", stateful " << schedule.stateful_occupancy.at(stage) << "/"
+        << model.stateful_alus_per_stage << "\n";
+    for (const auto node : starting.at(stage)) {
+      auto text = dag.node_printer()(dag.node(node));
+      while (not text.empty() and text.back() == '\n') text.pop_back();
+      for (auto pos = text.find('\n'); pos != std::string::npos; pos = text.find('\n', pos + 1))
+        text.insert(pos + 1, "//   ");
+      out << "//   " << text << " (slack " << schedule.slack.at(node) << ")\n";
+    }
+  }
+}
+
+/// Critical path schedule of an acyclic graph assuming unit latencies and
+/// unlimited resources: the earliest time step of every node, one step after
+/// the latest of its predecessors. O(V + E), plus building the map.
+template <class NodeType>
+std::map<NodeType, uint32_t> critical_path_schedule(const Graph<NodeType> &dag) {
+  const auto bounds = timing_bounds(
+      dag, std::vector<Operation>(dag.num_nodes(), Operation{1, AluKind::STATELESS}));
+  std::map<NodeType, uint32_t> schedule;
+  for (typename Graph<NodeType>::NodeId i = 0; i < dag.num_nodes(); i++)
+    schedule.emplace(dag.node(i), bounds.asap.at(i));
+  return schedule;
+}
+
+#endif // SCHEDULER_H_
@@ -3,9 +3,13 @@
 
 #include <ostream>
 #include <algorithm>
+#include <iterator>
+#include <utility>
 #include <vector>
 #include <set>
 
+#include "symbol_table.h"
+
 template <class T>
 std::ostream & operator<<(std::ostream & out, const std::set<T> & set) {
   out << "{";
@@ -46,4 +50,31 @@ std::set<T> operator*(const std::set<T> & a, const std::set<T> & b) {
   return std::set<T>(temp.begin(), temp.end());
 }
 
+// The same three operators on sets of interned symbols:
+// linear merges of sorted IDs instead of string comparisons
+inline SymbolSet operator+(const SymbolSet & a, const SymbolSet & b) {
+  std::vector<Symbol> temp;
+  temp.reserve(a.size() + b.size());
+  std::set_union(a.begin(), a.end(),
+                 b.begin(), b.end(),
+                 std::back_inserter(temp));
+  return SymbolSet::from_sorted(std::move(temp));
+}
+
+inline SymbolSet operator-(const SymbolSet & a, const SymbolSet & b) {
+  std::vector<Symbol> temp;
+  std::set_difference(a.begin(), a.end(),
+                      b.begin(), b.end(),
+                      std::back_inserter(temp));
+  return SymbolSet::from_sorted(std::move(temp));
+}
+
+inline SymbolSet operator*(const SymbolSet & a, const SymbolSet & b) {
+  std::vector<Symbol> temp;
+  std::set_intersection(a.begin(), a.end(),
+                        b.begin(), b.end(),
+                        std::back_inserter(temp));
+  return SymbolSet::from_sorted(std::move(temp));
+}
+
 #endif // SET_IDIOMS_H_
@@ -18,16 +18,17 @@ using namespace clang;
 using std::placeholders::_1;
 using std::placeholders::_2;
 
-std::string ssa_transform(const TranslationUnitDecl *tu_decl) {
+std::string ssa_transform(const TranslationUnitDecl *tu_decl, Context &ctx) {
   const auto &id_set = identifier_census(tu_decl);
   return pkt_func_transform(tu_decl,
-                            std::bind(ssa_rewrite_fn_body, _1, _2, id_set));
+                            std::bind(ssa_rewrite_fn_body, _1, _2, id_set, std::ref(ctx)));
 }
 
 std::pair<std::string, std::vector<std::string>>
 ssa_rewrite_fn_body(const CompoundStmt *function_body,
                     const std::string &pkt_name,
-                    const std::set<std::string> &id_set) {
+                    const std::set<std::string> &id_set,
+                    Context &ctx) {
   // Vector of newly created packet temporaries
   std::vector<std::string> new_decls = {};
 
@@ -88,7 +89,7 @@ ssa_rewrite_fn_body(const CompoundStmt *function_body,
       const auto *lhsPkt = dyn_cast<MemberExpr>(lhs)->getMemberDecl();
       const std::string lhs_var = clang_stmt_printer(lhs);
       const std::string lhs_field = lhsPkt->getNameAsString();
-   //   if (!(Context::GetContext().GetVarKind(lhs_var) == D_STATEFUL)) {
+   //   if (!(ctx.GetVarKind(lhs_var) == D_STATEFUL)) {
         // Assert that this definition and current value of index show up in
         // def_locs lhs_var is the base of SSA string.
         assert_exception(def_locs.find(lhs_var) != def_locs.end());
@@ -108,15 +109,15 @@ ssa_rewrite_fn_body(const CompoundStmt *function_body,
         // we mark newly created var as a PKT_FIELD, because we don't want to destroy
         // read/write flanks.
         // std::cout << "getting type of var " << lhs_var << "\n";
-        const auto var_domino_type = Context::GetContext().GetType(lhs_field);
-        const auto var_domino_kind = Context::GetContext().GetVarKind(lhs_field);
+        const auto var_domino_type = ctx.GetType(lhs_field);
+        const auto var_domino_kind = ctx.GetVarKind(lhs_field);
 
-        Context::GetContext().SetType(new_tmp_var, var_domino_type);
-        Context::GetContext().SetVarKind(new_tmp_var, var_domino_kind == D_TMP ? D_TMP : D_PKT_FIELD);
-        Context::GetContext().Derive(lhs_field, new_tmp_var);
+        ctx.SetType(new_tmp_var, var_domino_type);
+        ctx.SetVarKind(new_tmp_var, var_domino_kind == D_TMP ? D_TMP : D_PKT_FIELD);
+        ctx.Derive(lhs_field, new_tmp_var);
         // if a variable is a tmp, mark it as OPT.
         if (var_domino_kind == D_TMP)
-          Context::GetContext().SetOptLevel(new_tmp_var, D_OPT);
+          ctx.SetOptLevel(new_tmp_var, D_OPT);
         
         new_decls.emplace_back(var_decl);
         current_packet_var_replacements[lhs_var] = pkt_name + "." + new_tmp_var;
@@ -139,7 +140,7 @@ ssa_rewrite_fn_body(const CompoundStmt *function_body,
   // Print out the final replacements, i.e. the value of
   // current_packet_var_replacements at this point
   for (const auto &repl_pair : current_packet_field_replacements)
-    std::cerr << "// " + repl_pair.first << " " << repl_pair.second
+    ctx.Log() << "// " + repl_pair.first << " " << repl_pair.second
               << std::endl;
 
   return std::make_pair("{" + function_body_str + "}", new_decls);
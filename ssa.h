@@ -7,13 +7,15 @@
 
 #include "clang/AST/Decl.h"
 
+#include "context.h"
+
 // Static Single-Assignment form for function body, excluding the final write
 // in the write epilogue to state variables. This guarantees that each packet
 // variable is assigned exactly once. If it is assigned more than once, perform
 // simple renaming. SSA is very simple in domino because we have no branches and no phi nodes.
-std::string ssa_transform(const clang::TranslationUnitDecl * tu_decl);
+std::string ssa_transform(const clang::TranslationUnitDecl * tu_decl, Context & ctx);
 
 /// Helper function that does most of the heavy lifting in SSA, by rewriting the function body into SSA form.
-std::pair<std::string, std::vector<std::string>> ssa_rewrite_fn_body(const clang::CompoundStmt * function_body, const std::string & pkt_name, const std::set<std::string> & id_set);
+std::pair<std::string, std::vector<std::string>> ssa_rewrite_fn_body(const clang::CompoundStmt * function_body, const std::string & pkt_name, const std::set<std::string> & id_set, Context & ctx);
 
 #endif  // SSA_H_
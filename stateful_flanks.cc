@@ -16,7 +16,7 @@ using namespace clang;
 using std::placeholders::_1;
 using std::placeholders::_2;
 
-std::pair<std::string, std::vector<std::string>> add_stateful_flanks(const CompoundStmt * function_body, const std::string & pkt_name, const std::set<std::string> & id_set) {
+std::pair<std::string, std::vector<std::string>> add_stateful_flanks(const CompoundStmt * function_body, const std::string & pkt_name, const std::set<std::string> & id_set, Context & ctx) {
   // Vector of newly created packet temporaries
   std::vector<std::string> new_decls = {};
 
@@ -75,9 +75,9 @@ std::pair<std::string, std::vector<std::string>> add_stateful_flanks(const Compo
 
         const auto pkt_tmp_var   = pkt_name + "." + new_tmp_var;
 
-        Context::GetContext().SetType(new_tmp_var, D_INT);
-        Context::GetContext().SetVarKind(new_tmp_var, D_PKT_FIELD);
-        Context::GetContext().Derive(new_tmp_var, new_tmp_var);
+        ctx.SetType(new_tmp_var, D_INT);
+        ctx.SetVarKind(new_tmp_var, D_PKT_FIELD);
+        ctx.Derive(new_tmp_var, new_tmp_var);
 
         // Read from a state variable into a packet temporary
         // If it's an array, read index into a newly created packet temporary and move to prologue too
@@ -106,7 +106,7 @@ std::pair<std::string, std::vector<std::string>> add_stateful_flanks(const Compo
           write_epilogue += replace_subscript_expr(dyn_cast<ArraySubscriptExpr>(lhs), new_subscript_var) + " = " + pkt_tmp_var + ";";
 
           // Print out the rename of subscript_var for jayhawk to use
-          std::cerr << "// " << pkt_field_in_subscript << " " << new_tmp_var_for_subscript << std::endl;
+          ctx.Log() << "// " << pkt_field_in_subscript << " " << new_tmp_var_for_subscript << std::endl;
         } else {
           read_prologue += pkt_tmp_var + " = " + state_var + ";";
           write_epilogue += state_var + " = " + pkt_tmp_var + ";";
@@ -141,7 +141,7 @@ std::string replace_subscript_expr(const ArraySubscriptExpr * array_op, const st
   return clang_stmt_printer(array_op->getBase()) + "[" + new_subscript + "]";
 }
 
-std::string stateful_flank_transform(const TranslationUnitDecl * tu_decl) {
+std::string stateful_flank_transform(const TranslationUnitDecl * tu_decl, Context & ctx) {
   const auto & id_set = identifier_census(tu_decl);
-  return pkt_func_transform(tu_decl, std::bind(add_stateful_flanks, _1, _2, id_set));
+  return pkt_func_transform(tu_decl, std::bind(add_stateful_flanks, _1, _2, id_set, std::ref(ctx)));
 }
@@ -0,0 +1,41 @@
+#include "symbol_table.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "third_party/assert_exception.h"
+
+Symbol SymbolTable::intern(const std::string & name) {
+  const auto it = ids_.find(name);
+  if (it != ids_.end()) return it->second;
+
+  assert_exception(names_.size() < kNoSymbol);
+  const auto symbol = static_cast<Symbol>(names_.size());
+  names_.emplace_back(name);
+  ids_.emplace(names_.back(), symbol);
+  return symbol;
+}
+
+SymbolSet::SymbolSet(std::vector<Symbol> symbols) : symbols_(std::move(symbols)) {
+  std::sort(symbols_.begin(), symbols_.end());
+  symbols_.erase(std::unique(symbols_.begin(), symbols_.end()), symbols_.end());
+}
+
+SymbolSet SymbolSet::from_sorted(std::vector<Symbol> symbols) {
+  SymbolSet ret;
+  ret.symbols_ = std::move(symbols);
+  return ret;
+}
+
+void SymbolSet::insert(const Symbol symbol) {
+  if (symbols_.empty() or symbols_.back() < symbol) {
+    symbols_.emplace_back(symbol);
+    return;
+  }
+  const auto it = std::lower_bound(symbols_.begin(), symbols_.end(), symbol);
+  if (*it != symbol) symbols_.insert(it, symbol);
+}
+
+bool SymbolSet::contains(const Symbol symbol) const {
+  return std::binary_search(symbols_.begin(), symbols_.end(), symbol);
+}
@@ -0,0 +1,87 @@
+#ifndef SYMBOL_TABLE_H_
+#define SYMBOL_TABLE_H_
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// Interned name of a variable or other identifier
+typedef uint32_t Symbol;
+
+/// Returned by SymbolTable::find for names that were never interned
+const Symbol kNoSymbol = std::numeric_limits<Symbol>::max();
+
+/// Interns names to dense Symbols 0, 1, 2, ... in the order they are first
+/// seen, so that passes can key hash maps and vectors by a 32-bit ID
+/// instead of trees keyed by strings, and compare names in O(1).
+/// Symbol 0 is the empty name, which is what a default-constructed Symbol
+/// in a hash map reads as, just like a default-constructed std::string.
+/// Every Context has one, shared by all passes over that program,
+/// so it isn't thread-safe and doesn't need to be.
+class SymbolTable {
+ public:
+  SymbolTable() { intern(""); }
+  SymbolTable(const SymbolTable &) = delete;
+  SymbolTable & operator=(const SymbolTable &) = delete;
+
+  /// Symbol of name, interning it if it's new
+  Symbol intern(const std::string & name);
+
+  /// Symbol of name, or kNoSymbol if it was never interned
+  Symbol find(const std::string & name) const {
+    const auto it = ids_.find(name);
+    return it == ids_.end() ? kNoSymbol : it->second;
+  }
+
+  /// Name of symbol, which must come from this table
+  const std::string & name(const Symbol symbol) const { return names_.at(symbol); }
+
+  /// Number of symbols interned so far, i.e., one more than the largest Symbol
+  size_t size() const { return names_.size(); }
+
+ private:
+  /// Names by Symbol. A deque doesn't move its elements as it grows,
+  /// so ids_ can key on views of them instead of a second copy.
+  std::deque<std::string> names_ = {};
+
+  std::unordered_map<std::string_view, Symbol> ids_ = {};
+};
+
+/// Set of symbols, kept as a sorted vector: compact, cache-friendly,
+/// and combined with others by linear merges (see set_idioms.h)
+/// instead of the tree operations of a std::set<std::string>
+class SymbolSet {
+ public:
+  SymbolSet() {}
+
+  /// Set of the symbols in symbols, in any order, with repeats
+  explicit SymbolSet(std::vector<Symbol> symbols);
+
+  /// Set of the symbols in symbols, already sorted and without repeats,
+  /// e.g., the result of std::set_union, in O(1)
+  static SymbolSet from_sorted(std::vector<Symbol> symbols);
+
+  /// Add symbol, O(size()) unless it goes at the end
+  void insert(const Symbol symbol);
+
+  /// Whether symbol is in the set, O(log size())
+  bool contains(const Symbol symbol) const;
+
+  /// Symbols in increasing order
+  std::vector<Symbol>::const_iterator begin() const { return symbols_.begin(); }
+  std::vector<Symbol>::const_iterator end() const { return symbols_.end(); }
+  size_t size() const { return symbols_.size(); }
+  bool empty() const { return symbols_.empty(); }
+
+  bool operator==(const SymbolSet & other) const { return symbols_ == other.symbols_; }
+  bool operator!=(const SymbolSet & other) const { return symbols_ != other.symbols_; }
+
+ private:
+  std::vector<Symbol> symbols_ = {};
+};
+
+#endif  // SYMBOL_TABLE_H_
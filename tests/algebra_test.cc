@@ -0,0 +1,135 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "context.h"
+#include "domino_ir.h"
+#include "ir_transforms.h"
+#include "tests/ir_test_util.h"
+#include "third_party/gtest.h"
+
+namespace {
+
+const auto f = ir_pkt_field;
+
+/// Simplify rhs as the right-hand side of p.t, returning it printed
+std::string simplify(const IrExprPtr & rhs) {
+  Context ctx;
+  IrProgram program;
+  for (const auto & name : {"a", "b", "c", "d", "t"}) {
+    program.fields.emplace_back(IrField{"int", name});
+    ctx.SetType(name, D_INT);
+    ctx.SetVarKind(name, D_PKT_FIELD);
+    ctx.SetOptLevel(name, D_OPT);
+  }
+  program.body = {{f("t"), rhs}};
+  ir_algebra_simplify_transform(program, ctx);
+  // The result is a fixed point: a second run changes nothing
+  EXPECT_FALSE(ir_algebra_simplify_transform(program, ctx));
+  return ir_print_expr(program.body.front().rhs, "p.");
+}
+
+TEST(AlgebraTest, FoldingAndIdentities) {
+  EXPECT_EQ("-2147483648", simplify(ir_binary("+", ir_int(2147483647), ir_int(1))));
+  EXPECT_EQ("p.a", simplify(ir_binary("*", ir_binary("+", f("a"), ir_int(0)), ir_int(1))));
+  EXPECT_EQ("p.a", simplify(ir_unary("-", ir_paren(ir_unary("-", ir_paren(f("a")))))));
+  // Nested chains are normalized bottom-up, constants first
+  EXPECT_EQ("5 + p.a + p.b",
+            simplify(ir_binary("+", ir_binary("+", ir_int(2), f("b")), ir_paren(ir_binary("+", f("a"), ir_int(3))))));
+}
+
+TEST(AlgebraTest, LogicalIdentities) {
+  // 0 is the identity of | as of +
+  EXPECT_EQ("p.a", simplify(ir_binary("|", f("a"), ir_int(0))));
+  EXPECT_EQ("p.a", simplify(ir_binary("|", ir_int(0), f("a"))));
+  // but a || 0 and a && 1 are 0 or 1, not a, unless a is already
+  EXPECT_EQ("0 || p.a", simplify(ir_binary("||", f("a"), ir_int(0))));
+  EXPECT_EQ("0 || p.a", simplify(ir_binary("||", ir_int(0), f("a"))));
+  EXPECT_EQ("1 && p.a", simplify(ir_binary("&&", f("a"), ir_int(1))));
+  EXPECT_EQ("1 && p.a", simplify(ir_binary("&&", f("a"), f("a"))));
+  EXPECT_EQ("(p.c - p.d) || (p.c - p.d)",
+            simplify(ir_binary("||", ir_paren(ir_binary("-", f("c"), f("d"))), ir_paren(ir_binary("-", f("c"), f("d"))))));
+  const auto less = ir_paren(ir_binary("<", f("a"), f("b")));
+  EXPECT_EQ("(p.a < p.b)", simplify(ir_binary("||", less, ir_int(0))));
+  EXPECT_EQ("(p.a < p.b)", simplify(ir_binary("&&", ir_int(1), less)));
+  EXPECT_EQ("(p.a < p.b)", simplify(ir_binary("||", less, less)));
+}
+
+TEST(AlgebraTest, AnnihilatorsAndAbsorption) {
+  EXPECT_EQ("0",
+            simplify(ir_binary("*", ir_paren(ir_binary("-", f("a"), f("b"))),
+                               ir_paren(ir_binary("-", ir_int(3), ir_int(3))))));
+  EXPECT_EQ("1", simplify(ir_binary("||", f("c"), ir_int(7))));
+  const auto less = ir_paren(ir_binary("<", f("a"), f("b")));
+  EXPECT_EQ("(p.a < p.b)", simplify(ir_binary("&&", less, ir_paren(ir_binary("||", less, f("c"))))));
+  // a isn't 0 or 1, so a && (a || c) isn't a
+  EXPECT_NE("p.a", simplify(ir_binary("&&", f("a"), ir_paren(ir_binary("||", f("a"), f("c"))))));
+}
+
+TEST(AlgebraTest, MixedChainsConverge) {
+  // flatten and the && term rule used to undo each other on this
+  EXPECT_EQ("p.a && p.b && (p.c - p.d)",
+            simplify(ir_binary("&&", ir_binary("&&", f("a"), f("b")), ir_paren(ir_binary("-", f("c"), f("d"))))));
+}
+
+TEST(AlgebraTest, DefaultPipelineRuns) {
+  // if (p.x > 3) { s = s + 1; if (p.y == 0) p.z = s; }, as if_converter leaves it
+  Context ctx;
+  IrProgram program;
+  program.state_vars.emplace_back(IrStateVar{"s", "int s = 0;", "int", false});
+  ctx.SetType("s", D_INT);
+  ctx.SetVarKind("s", D_STATEFUL);
+  for (const auto & name : {"x", "y", "z", "__br_tmp0", "__br_tmp1"}) {
+    const bool branch = std::string(name).find("__br_tmp") == 0;
+    program.fields.emplace_back(IrField{"int", name});
+    ctx.SetType(name, branch ? D_BIT : D_INT);
+    ctx.SetVarKind(name, branch ? D_TMP : D_PKT_FIELD);
+    ctx.SetOptLevel(name, branch ? D_OPT : D_NO_OPT);
+  }
+  const auto predicate = [](const std::vector<std::string> & branches) {
+    IrExprPtr ret = ir_int(1);
+    for (const auto & branch : branches) ret = ir_binary("&&", ret, ir_paren(f(branch)));
+    return ret;
+  };
+  const auto s = ir_state_var("s");
+  program.body = {{f("__br_tmp0"), ir_binary(">", f("x"), ir_int(3))},
+                  {s, ir_paren(ir_ternary(predicate({"__br_tmp0"}), ir_paren(ir_binary("+", s, ir_int(1))), s))},
+                  {f("__br_tmp1"), ir_binary("==", f("y"), ir_int(0))},
+                  {f("z"), ir_paren(ir_ternary(predicate({"__br_tmp0", "__br_tmp1"}), ir_paren(s), f("z")))}};
+
+  // The default pipeline up to create_branch_var
+  ir_stateful_flanks_transform(program, ctx);
+  EXPECT_TRUE(ir_algebra_simplify_transform(program, ctx));
+  ir_elim_identical_lhs_rhs_transform(program, ctx);
+  ir_ssa_transform(program, ctx);
+  ir_expr_prop_transform(program, ctx);
+  // expr_propagater substitutes the branch conditions into 1 && (p.__br_tmp0) && (p.__br_tmp1),
+  // which need normalizing again
+  EXPECT_TRUE(ir_algebra_simplify_transform(program, ctx));
+  ir_paren_remover_transform(program, ctx);
+  ir_branch_var_creator_transform(program, ctx);
+  // but create_branch_var only moves conditions that are normalized already
+  EXPECT_FALSE(ir_algebra_simplify_transform(program, ctx));
+}
+
+TEST(AlgebraTest, RandomExpressions) {
+  // Simplified expressions have the values they had, wherever they are defined
+  std::mt19937 rng(2);
+  const std::vector<std::string> ops = {"+", "-", "*", "==", "!=", "<", ">", "<=", "&", "|", "^", "&&", "||"};
+  for (int i = 0; i < 2000; i++) {
+    Context ctx;
+    std::vector<std::string> kept;
+    const auto before = ir_test_random_program(rng, 1 + rng() % 4, ops, ctx, &kept);
+    auto after = before;
+    ir_algebra_simplify_transform(after, ctx);
+    for (int j = 0; j < 8; j++) {
+      if (not ir_test_same_values(before, after, ir_test_random_inputs(rng), kept)) {
+        ADD_FAILURE() << "algebra_simplify changed the values of\n" << ir_test_body(before) << "into\n"
+                      << ir_test_body(after);
+        return;
+      }
+    }
+  }
+}
+
+}  // namespace
@@ -0,0 +1,108 @@
+#include <string>
+#include <vector>
+
+#include "graph.h"
+#include "third_party/gtest.h"
+
+namespace {
+
+typedef Graph<std::string>::NodeId NodeId;
+
+Graph<std::string> string_graph(const std::vector<std::string> & nodes,
+                                const std::vector<std::pair<std::string, std::string>> & edges) {
+  Graph<std::string> graph([](const std::string & x) { return x; });
+  for (const auto & node : nodes) graph.add_node(node);
+  for (const auto & edge : edges) graph.add_edge(edge.first, edge.second);
+  return graph;
+}
+
+/// Every edge between components goes from a lower to a higher number
+void check_topological(const Graph<std::string> & graph, const std::vector<uint32_t> & ids) {
+  for (const auto & edge : graph.edges()) EXPECT_LE(ids.at(edge.first), ids.at(edge.second));
+}
+
+TEST(GraphTest, CsrAdjacency) {
+  // Edges added out of order and twice come back sorted and once
+  auto graph = string_graph({"a", "b", "c", "d", "x"}, {{"a", "d"}, {"a", "b"}, {"c", "b"}});
+  graph.add_edges_by_id({{0, 3}, {0, 1}, {0, 2}});
+  EXPECT_EQ(4u, graph.num_edges());
+  const std::vector<NodeId> succ_a(graph.succ(0).begin(), graph.succ(0).end());
+  EXPECT_EQ((std::vector<NodeId>{1, 2, 3}), succ_a);
+  const std::vector<NodeId> pred_b(graph.pred(1).begin(), graph.pred(1).end());
+  EXPECT_EQ((std::vector<NodeId>{0, 2}), pred_b);
+  EXPECT_TRUE(graph.exists_edge("c", "b"));
+  EXPECT_FALSE(graph.exists_edge("b", "c"));
+  EXPECT_TRUE(graph.exists_path("a", "b"));
+  EXPECT_FALSE(graph.exists_path("d", "a"));
+
+  // Adjacency is rebuilt after removing a node, and the nodes after it move down
+  graph.add_node("y");
+  graph.add_edge("c", "y");
+  graph.remove_singleton_node("x");
+  EXPECT_EQ(5u, graph.num_nodes());
+  EXPECT_EQ(4u, graph.id("y"));
+  EXPECT_TRUE(graph.exists_edge_by_id(2, 4));
+  EXPECT_EQ(1u, graph.pred(4).size());
+}
+
+TEST(GraphTest, SccIds) {
+  // Two cycles, a -> b -> a and c -> d -> e -> c, joined by b -> c,
+  // and f alone after them
+  const auto graph = string_graph({"a", "b", "c", "d", "e", "f"},
+                                  {{"a", "b"}, {"b", "a"}, {"b", "c"}, {"c", "d"},
+                                   {"d", "e"}, {"e", "c"}, {"e", "f"}});
+  const auto ids = graph.scc_ids();
+  EXPECT_EQ(ids.at(1), ids.at(0));
+  EXPECT_EQ(ids.at(3), ids.at(2));
+  EXPECT_EQ(ids.at(4), ids.at(3));
+  EXPECT_NE(ids.at(2), ids.at(0));
+  EXPECT_NE(ids.at(5), ids.at(2));
+  check_topological(graph, ids);
+
+  const auto components = graph.scc();
+  EXPECT_EQ(3u, components.size());
+  EXPECT_TRUE(components.at(0) == (std::vector<std::string>{"a", "b"}) or
+              components.at(0) == (std::vector<std::string>{"b", "a"}));
+  EXPECT_EQ((std::vector<std::string>{"f"}), components.at(2));
+}
+
+TEST(GraphTest, DeepGraph) {
+  // A path long enough to overflow the stack of a recursive search,
+  // closed into one cycle by its last edge
+  const size_t length = 200000;
+  Graph<uint32_t> graph([](const uint32_t & x) { return std::to_string(x); });
+  std::vector<Graph<uint32_t>::IdEdge> edges;
+  for (uint32_t i = 0; i < length; i++) {
+    graph.add_node(i);
+    if (i > 0) edges.emplace_back(i - 1, i);
+  }
+  graph.add_edges_by_id(edges);
+  const auto path_ids = graph.scc_ids();
+  EXPECT_EQ(0u, path_ids.front());
+  EXPECT_EQ(length - 1, path_ids.back());
+
+  graph.add_edge_by_id(length - 1, 0);
+  const auto cycle_ids = graph.scc_ids();
+  EXPECT_TRUE(std::all_of(cycle_ids.begin(), cycle_ids.end(), [](const uint32_t id) { return id == 0; }));
+}
+
+TEST(GraphTest, Condensation) {
+  const auto graph = string_graph({"a", "b", "c", "d", "e"},
+                                  {{"a", "b"}, {"b", "a"}, {"a", "c"}, {"b", "c"},
+                                   {"c", "d"}, {"d", "c"}, {"e", "a"}});
+  const auto dag = graph.condensation(std::less<std::string>());
+  EXPECT_EQ(3u, dag.num_nodes());
+  // Two edges from {a, b} to {c, d} become one
+  EXPECT_EQ(2u, dag.num_edges());
+  const auto ids = graph.scc_ids();
+  EXPECT_EQ((std::vector<std::string>{"a", "b"}), dag.node(ids.at(graph.id("a"))));
+  EXPECT_EQ((std::vector<std::string>{"c", "d"}), dag.node(ids.at(graph.id("c"))));
+  EXPECT_TRUE(dag.exists_edge({"e"}, {"a", "b"}));
+  EXPECT_TRUE(dag.exists_edge({"a", "b"}, {"c", "d"}));
+
+  const auto order = dag.topological_order();
+  EXPECT_EQ((std::vector<NodeId>{0, 1, 2}), order);
+  EXPECT_THROW(graph.topological_order(), std::exception);
+}
+
+}  // namespace
@@ -0,0 +1,172 @@
+#ifndef TESTS_IR_TEST_UTIL_H_
+#define TESTS_IR_TEST_UTIL_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "context.h"
+#include "domino_ir.h"
+
+/// Running IR programs the way the switch would, to check that
+/// a pass computes the same values as the program it was given,
+/// and random programs to run it on.
+
+/// Body of program, one statement per line
+inline std::string ir_test_body(const IrProgram & program) {
+  std::string ret;
+  for (const auto & stmt : program.body) ret += ir_print_stmt(stmt, program.pkt_name) + ";\n";
+  return ret;
+}
+
+/// Values of variables by ir_var_name, e.g., p.x and count
+typedef std::map<std::string, int64_t> IrValues;
+
+/// Truncate to a 32-bit int, as ir_evaluate does
+inline int64_t ir_test_wrap(const int64_t v) {
+  return static_cast<int64_t>(static_cast<int32_t>(static_cast<uint32_t>(v)));
+}
+
+/// Value of expr with variables taken from values (unset ones read as 0), evaluated like C:
+/// operators on the values of their operands as ir_evaluate folds them, and
+/// short-circuit &&, || and ?:, which only evaluate an operand if the ones
+/// before it don't decide the result, with && and || giving 0 or 1 for any
+/// operands. Calls return a hash of their arguments. Sets undefined if an
+/// operator that is evaluated has no value, e.g., divides by zero.
+inline int64_t ir_test_eval(const IrExprPtr & expr, const IrValues & values,
+                            const std::string & pkt_name, bool & undefined) {
+  const auto eval = [&](const IrExprPtr & operand) { return ir_test_eval(operand, values, pkt_name, undefined); };
+  const auto fold = [&undefined](const IrExprPtr & op_on_literals) {
+    int64_t value = 0;
+    if (not ir_evaluate(op_on_literals, value)) undefined = true;
+    return value;
+  };
+  const auto & ops = expr->operands;
+  switch (expr->kind) {
+    case IrExprKind::INT_LITERAL:
+      return expr->value;
+    case IrExprKind::PKT_FIELD:
+    case IrExprKind::STATE_VAR: {
+      const auto it = values.find(ir_var_name(expr, pkt_name));
+      return it == values.end() ? 0 : it->second;
+    }
+    case IrExprKind::PAREN:
+      return eval(ops.at(0));
+    case IrExprKind::UNARY:
+      return fold(ir_unary(expr->name, ir_int(eval(ops.at(0)))));
+    case IrExprKind::TERNARY:
+      return eval(ops.at(0)) ? eval(ops.at(1)) : eval(ops.at(2));
+    case IrExprKind::CALL: {
+      int64_t ret = static_cast<int64_t>(std::hash<std::string>()(expr->name) % 1000);
+      for (const auto & operand : ops) ret = ir_test_wrap(ret * 31 + eval(operand));
+      return ret;
+    }
+    case IrExprKind::BINARY: {
+      const auto & op = expr->name;
+      const auto l = eval(ops.at(0));
+      if (op == "&&") return l != 0 and eval(ops.at(1)) != 0;
+      if (op == "||") return l != 0 or eval(ops.at(1)) != 0;
+      return fold(ir_binary(op, ir_int(l), ir_int(eval(ops.at(1)))));
+    }
+  }
+  throw std::logic_error("ir_test_eval: unknown expression kind");
+}
+
+/// Run the body of program on inputs, returning the values of all variables
+/// afterwards, and setting undefined if any statement is undefined
+inline IrValues ir_test_run(const IrProgram & program, const IrValues & inputs, bool & undefined) {
+  IrValues values = inputs;
+  for (const auto & stmt : program.body)
+    values[ir_var_name(ir_strip_parens(stmt.lhs), program.pkt_name)] =
+        ir_test_eval(stmt.rhs, values, program.pkt_name, undefined);
+  return values;
+}
+
+/// Check that after computes what before does on inputs: every variable
+/// both assign has the same value, every variable in kept keeps the
+/// value it has after before, and if before is defined, so is after
+inline bool ir_test_same_values(const IrProgram & before, const IrProgram & after, const IrValues & inputs,
+                                const std::vector<std::string> & kept) {
+  bool before_undefined = false;
+  bool after_undefined = false;
+  const auto expected = ir_test_run(before, inputs, before_undefined);
+  const auto actual = ir_test_run(after, inputs, after_undefined);
+  if (after_undefined and not before_undefined) return false;
+  // Undefined behavior may be gone or have moved: nothing more to compare
+  if (before_undefined) return true;
+  for (const auto & var : kept) {
+    if (actual.count(var) == 0 or actual.at(var) != expected.at(var)) return false;
+  }
+  for (const auto & p : actual) {
+    if (expected.count(p.first) != 0 and expected.at(p.first) != p.second) return false;
+  }
+  return true;
+}
+
+/// Random program of num_stmts statements p.t0 = ..., p.t1 = ..., each
+/// over p.i0, p.i1, p.i2, the state variable s, small literals, and the
+/// fields assigned before it, using binary_ops (with any operands, also for
+/// && and ||), ternaries, calls and unary minus. Every field is declared in
+/// ctx; the ones in kept (if not null) are D_NO_OPT, all others D_OPT.
+inline IrProgram ir_test_random_program(std::mt19937 & rng, const size_t num_stmts,
+                                        const std::vector<std::string> & binary_ops, Context & ctx,
+                                        std::vector<std::string> * kept = nullptr) {
+  IrProgram program;
+  program.state_vars.emplace_back(IrStateVar{"s", "int s = 0;", "int", false});
+  std::vector<std::string> readable = {"i0", "i1", "i2"};
+  for (const auto & input : readable) {
+    program.fields.emplace_back(IrField{"int", input});
+    ctx.SetType(input, D_INT);
+    ctx.SetVarKind(input, D_PKT_FIELD);
+    ctx.SetOptLevel(input, D_NO_OPT);
+  }
+
+  std::function<IrExprPtr(int)> random_expr = [&](const int depth) -> IrExprPtr {
+    switch (rng() % (depth >= 2 ? 3 : 8)) {
+      case 0:
+      case 1:
+        return ir_pkt_field(readable.at(rng() % readable.size()));
+      case 2:
+        return rng() % 4 == 0 ? ir_state_var("s") : ir_int(static_cast<int64_t>(rng() % 4));
+      case 3:
+      case 4:
+      case 5: {
+        const auto & op = binary_ops.at(rng() % binary_ops.size());
+        return ir_binary(op, random_expr(depth + 1), random_expr(depth + 1));
+      }
+      case 6:
+        return rng() % 2 == 0
+                   ? ir_paren(ir_ternary(random_expr(depth + 1), random_expr(depth + 1), random_expr(depth + 1)))
+                   : ir_call("hash2", {random_expr(depth + 1), random_expr(depth + 1)});
+      default:
+        return ir_unary("-", ir_paren(random_expr(depth + 1)));
+    }
+  };
+
+  for (size_t i = 0; i < num_stmts; i++) {
+    const auto name = "t" + std::to_string(i);
+    program.fields.emplace_back(IrField{"int", name});
+    ctx.SetType(name, D_INT);
+    ctx.SetVarKind(name, D_PKT_FIELD);
+    const bool keep = kept != nullptr and rng() % 3 == 0;
+    ctx.SetOptLevel(name, keep ? D_NO_OPT : D_OPT);
+    if (keep) kept->emplace_back("p." + name);
+    program.body.emplace_back(IrStmt{ir_pkt_field(name), random_expr(0)});
+    readable.emplace_back(name);
+  }
+  return program;
+}
+
+/// Random values for the inputs of ir_test_random_program, mostly small
+/// so that comparisons and guards go both ways
+inline IrValues ir_test_random_inputs(std::mt19937 & rng) {
+  IrValues inputs;
+  for (const auto & var : {"p.i0", "p.i1", "p.i2", "s"})
+    inputs[var] = rng() % 8 == 0 ? ir_test_wrap(rng()) : static_cast<int64_t>(rng() % 5) - 2;
+  return inputs;
+}
+
+#endif  // TESTS_IR_TEST_UTIL_H_
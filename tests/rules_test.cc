@@ -0,0 +1,112 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "context.h"
+#include "domino_ir.h"
+#include "ir_rules.h"
+#include "third_party/gtest.h"
+
+namespace {
+
+const auto f = ir_pkt_field;
+
+/// expr rewritten with rules_text, printed
+std::string rewrite(const std::string & rules_text, const IrExprPtr & expr) {
+  const IrRuleSet rules(rules_text, "test.rules");
+  IrRuleSet::Memo memo;
+  return ir_print_expr(rules.rewrite(expr, memo), "p.");
+}
+
+/// Message of the std::logic_error parsing rules_text throws, or "" if it doesn't
+std::string parse_error(const std::string & rules_text) {
+  try {
+    const IrRuleSet rules(rules_text, "bad.rules");
+  } catch (const std::logic_error & e) {
+    return e.what();
+  }
+  return "";
+}
+
+TEST(RulesTest, Parser) {
+  const IrRuleSet rules("# strength reduction\n"
+                        "\n"
+                        "?x * #c => ?x << log2(#c) if pow2(#c), #c > 1  # comment\n"
+                        "?c ? ?x : ?x => ?x\n",
+                        "test.rules");
+  EXPECT_EQ(2u, rules.rules().size());
+  EXPECT_EQ(2u, rules.rules().at(0).conditions.size());
+  EXPECT_EQ("test.rules:4", rules.rules().at(1).location);
+
+  // Precedence and associativity as in C
+  EXPECT_EQ("0", rewrite("?a + ?b * ?c => 0", ir_binary("+", f("x"), ir_binary("*", f("y"), f("z")))));
+  EXPECT_EQ("0", rewrite("?a - ?b - ?c => 0", ir_binary("-", ir_binary("-", f("x"), f("y")), f("z"))));
+  EXPECT_EQ("p.x - (p.y - p.z)",
+            rewrite("?a - ?b - ?c => 0", ir_binary("-", f("x"), ir_paren(ir_binary("-", f("y"), f("z"))))));
+}
+
+TEST(RulesTest, ParseErrors) {
+  EXPECT_EQ(0u, parse_error("?x => 1").find("bad.rules:1: a pattern must not be a bare variable"));
+  EXPECT_EQ(0u, parse_error("\n?x + ?y => ?z").find("bad.rules:2: ?z isn't bound"));
+  EXPECT_NE(std::string::npos, parse_error("?x * #c => ?x if ?x > 1").find("conditions may only use #variables"));
+  EXPECT_NE(std::string::npos, parse_error("?x * #c => log2(?x)").find("log2 only takes constants"));
+  EXPECT_NE(std::string::npos, parse_error("?x + #x => 1").find("?x and #x in one pattern"));
+  EXPECT_NE(std::string::npos, parse_error("a + ?x => 1").find("variables must be written ?a or #a"));
+  EXPECT_NE("", parse_error("?x + => 1"));
+  EXPECT_NE("", parse_error("1 + 1 => 2 if"));
+  EXPECT_NE(std::string::npos, parse_error("?x + 1 => ?x 1").find("expected end of rule"));
+}
+
+TEST(RulesTest, NegativeLiterals) {
+  // -1 in a rule is the literal -1, as in the IR, not a minus applied to 1
+  EXPECT_EQ("-p.a", rewrite("?x * -1 => -(?x)", ir_binary("*", f("a"), ir_int(-1))));
+  EXPECT_EQ("p.a - 3", rewrite("?x + -#c => ?x - #c", ir_binary("+", f("a"), ir_unary("-", ir_int(3)))));
+  EXPECT_EQ("p.a + p.a", rewrite("?x * - -2 => ?x + ?x", ir_binary("*", f("a"), ir_int(2))));
+}
+
+TEST(RulesTest, Builtins) {
+  const std::string rules = "?x * #c => ?x << log2(#c) if pow2(#c), #c > 1\n"
+                            "?x / #c => ?x >> log2(#c)\n";
+  EXPECT_EQ("p.a << 3", rewrite(rules, ir_binary("*", f("a"), ir_int(8))));
+  EXPECT_EQ("p.a * 6", rewrite(rules, ir_binary("*", f("a"), ir_int(6))));
+  // log2(0) and log2(-4) can't be evaluated, so the rule doesn't apply
+  // instead of leaving a call of log2 in the program
+  EXPECT_EQ("p.a / 0", rewrite(rules, ir_binary("/", f("a"), ir_int(0))));
+  EXPECT_EQ("p.a / -4", rewrite(rules, ir_binary("/", f("a"), ir_int(-4))));
+  EXPECT_EQ("p.a >> 2", rewrite(rules, ir_binary("/", f("a"), ir_int(4))));
+}
+
+TEST(RulesTest, RuleOrder) {
+  // The first rule in file order that matches wins, however the
+  // discrimination tree orders them, and a rule that doesn't apply
+  // leaves the expression to the next one
+  const std::string rules = "?x / #c => ?x >> log2(#c)\n"
+                            "?x / 0 => 0\n"
+                            "?x / #c => 1\n";
+  EXPECT_EQ("p.a >> 3", rewrite(rules, ir_binary("/", f("a"), ir_int(8))));
+  EXPECT_EQ("0", rewrite(rules, ir_binary("/", f("a"), ir_int(0))));
+  EXPECT_EQ("1", rewrite(rules, ir_binary("/", f("a"), ir_int(-2))));
+}
+
+TEST(RulesTest, BottomUpAndRepeatedVariables) {
+  const std::string rules = "?x - ?x => 0\n"
+                            "(?x + #a) + #b => ?x + (#a + #b)\n";
+  // The operands are rewritten first, so the outer rule sees their normal form
+  EXPECT_EQ("0",
+            rewrite(rules, ir_binary("-", ir_paren(ir_binary("+", ir_binary("+", f("a"), ir_int(1)), ir_int(2))),
+                                     ir_binary("+", f("a"), ir_int(3)))));
+  EXPECT_EQ("p.a - p.b", rewrite(rules, ir_binary("-", f("a"), f("b"))));
+}
+
+TEST(RulesTest, Loops) {
+  // Rules that undo each other are reported with the last rule that fired
+  try {
+    rewrite("?x + ?y => ?y + ?x\n", ir_binary("+", f("a"), f("b")));
+    ADD_FAILURE() << "rewriting did not throw";
+  } catch (const std::logic_error & e) {
+    EXPECT_EQ(0u, std::string(e.what()).find("rules did not converge"));
+    EXPECT_NE(std::string::npos, std::string(e.what()).find("test.rules:1"));
+  }
+}
+
+}  // namespace
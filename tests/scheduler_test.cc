@@ -0,0 +1,126 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dep_graph.h"
+#include "graph.h"
+#include "scheduler.h"
+#include "third_party/gtest.h"
+
+namespace {
+
+/// a -> b -> d -> e and a -> c -> d, with f on its own:
+/// the critical path is a, b (or c), d, e, four stages
+Graph<std::string> diamond() {
+  Graph<std::string> graph([](const std::string & x) { return x; });
+  for (const auto & node : {"a", "b", "c", "d", "e", "f"}) graph.add_node(node);
+  graph.add_edge("a", "b");
+  graph.add_edge("a", "c");
+  graph.add_edge("b", "d");
+  graph.add_edge("c", "d");
+  graph.add_edge("d", "e");
+  return graph;
+}
+
+const std::vector<Operation> kUnitStateless(6, Operation{1, AluKind::STATELESS});
+
+TEST(SchedulerTest, TimingBounds) {
+  const auto graph = diamond();
+  const auto bounds = timing_bounds(graph, kUnitStateless);
+  EXPECT_EQ(4u, bounds.length);
+  EXPECT_EQ((std::vector<uint32_t>{0, 1, 1, 2, 3, 0}), bounds.asap);
+  EXPECT_EQ((std::vector<uint32_t>{0, 1, 1, 2, 3, 3}), bounds.alap);
+
+  // b taking two stages pushes d and e back by one
+  auto ops = kUnitStateless;
+  ops.at(1).latency = 2;
+  const auto longer = timing_bounds(graph, ops);
+  EXPECT_EQ(5u, longer.length);
+  EXPECT_EQ(3u, longer.asap.at(3));
+  EXPECT_EQ(2u, longer.alap.at(2));
+}
+
+TEST(SchedulerTest, UnconstrainedSchedule) {
+  // Two ALUs per stage are enough for the schedule to be as short as the critical path
+  const auto graph = diamond();
+  const auto schedule = list_schedule(graph, kUnitStateless, PipelineModel{4, 2, 1});
+  EXPECT_EQ(4u, schedule.length);
+  EXPECT_EQ(4u, schedule.critical_path_length);
+  EXPECT_TRUE(schedule.fits);
+  EXPECT_EQ((std::vector<uint32_t>{0, 1, 1, 2, 3, 0}), schedule.stage);
+  EXPECT_EQ((std::vector<uint32_t>{0, 0, 0, 0, 0, 3}), schedule.slack);
+  EXPECT_EQ((std::vector<uint32_t>{2, 2, 1, 1}), schedule.stateless_occupancy);
+}
+
+TEST(SchedulerTest, ConstrainedSchedule) {
+  // With one ALU per stage, every node needs a stage of its own. Critical
+  // nodes go first, so f, the only one with slack, is the one left for last.
+  const auto graph = diamond();
+  const auto schedule = list_schedule(graph, kUnitStateless, PipelineModel{4, 1, 1});
+  EXPECT_EQ(6u, schedule.length);
+  EXPECT_EQ(4u, schedule.critical_path_length);
+  EXPECT_FALSE(schedule.fits);
+  EXPECT_EQ(5u, schedule.stage.at(graph.id("f")));
+  for (uint32_t stage = 0; stage < schedule.length; stage++)
+    EXPECT_EQ(1u, schedule.stateless_occupancy.at(stage));
+}
+
+TEST(SchedulerTest, StatefulAlus) {
+  // Three independent stateful nodes on one stateful ALU per stage,
+  // with stateless ALUs to spare
+  Graph<std::string> graph([](const std::string & x) { return x; });
+  for (const auto & node : {"x", "y", "z"}) graph.add_node(node);
+  const std::vector<Operation> ops(3, Operation{1, AluKind::STATEFUL});
+  const auto schedule = list_schedule(graph, ops, PipelineModel{3, 8, 1});
+  EXPECT_EQ(3u, schedule.length);
+  EXPECT_EQ(1u, schedule.critical_path_length);
+  EXPECT_TRUE(schedule.fits);
+  EXPECT_EQ((std::vector<uint32_t>{1, 1, 1}), schedule.stateful_occupancy);
+  EXPECT_EQ((std::vector<uint32_t>{0, 0, 0}), schedule.stateless_occupancy);
+
+  EXPECT_THROW(list_schedule(graph, ops, PipelineModel{3, 8, 0}), std::logic_error);
+}
+
+TEST(SchedulerTest, DependencyGraphSchedule) {
+  // The read-modify-write of count is one stateful component,
+  // which p_c has to wait for
+  const std::string program =
+      "# state variables start\n"
+      "int count;\n"
+      "# state variables end\n"
+      "int p_a;\n"
+      "int p_b;\n"
+      "int p_c;\n"
+      "# declarations end\n"
+      "p_a = count;\n"
+      "p_b = p_a + 1;\n"
+      "count = p_b;\n"
+      "p_c = p_a + p_b;\n";
+  const auto final_program = parse_final_program(program);
+  const auto dag = dependency_graph(final_program).condensation(std::less<uint32_t>());
+  EXPECT_EQ(2u, dag.num_nodes());
+  EXPECT_EQ((std::vector<uint32_t>{0, 1, 2}), dag.node(0));
+
+  const auto ops = component_operations(dag, final_program);
+  EXPECT_EQ(AluKind::STATEFUL, ops.at(0).alu);
+  EXPECT_EQ(AluKind::STATELESS, ops.at(1).alu);
+
+  const auto schedule = list_schedule(dag, ops, kDefaultPipelineModel);
+  EXPECT_EQ(2u, schedule.length);
+  EXPECT_EQ(2u, schedule.critical_path_length);
+  EXPECT_TRUE(schedule.fits);
+
+  std::ostringstream out;
+  print_schedule(out, dag, schedule, kDefaultPipelineModel);
+  const std::string expected =
+      "// 2 stages used of 12, critical path 2 stages\n"
+      "// stage 0: stateless 0/16, stateful 1/4\n"
+      "//   p_a = count;\n"
+      "//   p_b = p_a + 1;\n"
+      "//   count = p_b; (slack 0)\n"
+      "// stage 1: stateless 1/16, stateful 0/4\n"
+      "//   p_c = p_a + p_b; (slack 0)\n";
+  EXPECT_EQ(expected, out.str());
+}
+
+}  // namespace
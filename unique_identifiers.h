@@ -1,25 +1,30 @@
 #ifndef UNIQUE_IDENTIFIERS_H_
 #define UNIQUE_IDENTIFIERS_H_
 
-#include <map>
+#include <memory>
 #include <set>
 #include <string>
 
+#include "name_allocator.h"
+#include "symbol_table.h"
+
+/// Unique identifier generator for passes without a Context: a NameAllocator
+/// of its own, over a symbol table of its own. Passes with a Context
+/// share its NameAllocator (Context::Names()) instead.
 class UniqueIdentifiers {
  public:
-  /// Constructor
-  UniqueIdentifiers(const std::set<std::string> & initial_set) : id_set_(initial_set) {}
+  /// Constructor, reserving the identifiers in initial_set
+  UniqueIdentifiers(const std::set<std::string> & initial_set);
 
   /// Get unique identifier
-  std::string get_unique_identifier(const std::string & prefix = "tmp") const;
+  std::string get_unique_identifier(const std::string & prefix = "tmp") const { return names_->allocate(prefix); }
 
  private:
-  /// Set of identifier names
-  /// passed to the function in constructor
-  mutable std::set<std::string> id_set_;
+  /// Symbol table the identifiers are interned in
+  std::shared_ptr<SymbolTable> symbols_;
 
-  /// Last unique id suffix handed out for every prefix
-  mutable std::map<std::string, int>  id_suffix_ = {};
+  /// Allocator over symbols_
+  std::shared_ptr<NameAllocator> names_;
 };
 
 #endif  // UNIQUE_IDENTIFIERS_H_
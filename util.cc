@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <cctype>
 #include <exception>
+#include <stdexcept>
 
 std::string get_file_name(const int argc, const char ** argv) {
   std::string ret;
@@ -46,3 +47,30 @@ bool compare_after_removing_space(const std::string & s1, const std::string & s2
   s2_tmp.erase(std::remove_if(s2_tmp.begin(), s2_tmp.end(), isspace), s2_tmp.end());
   return s1_tmp == s2_tmp;
 }
+
+std::string encode_fields(const std::vector<std::string> & fields) {
+  std::string encoded;
+  for (const auto & field : fields) encoded += std::to_string(field.size()) + "\n" + field;
+  return encoded;
+}
+
+std::vector<std::string> decode_fields(const std::string & encoded, const size_t num_fields) {
+  std::vector<std::string> fields;
+  size_t pos = 0;
+  while (pos < encoded.size()) {
+    const auto newline = encoded.find('\n', pos);
+    if (newline == std::string::npos or newline == pos or newline - pos > 12 or
+        encoded.find_first_not_of("0123456789", pos) != newline) {
+      throw std::logic_error("Malformed fields: bad field length");
+    }
+    const auto length = std::stoul(encoded.substr(pos, newline - pos));
+    if (length > encoded.size() - newline - 1) throw std::logic_error("Malformed fields: truncated field");
+    fields.emplace_back(encoded.substr(newline + 1, length));
+    pos = newline + 1 + length;
+  }
+  if (fields.size() != num_fields) {
+    throw std::logic_error("Malformed fields: expected " + std::to_string(num_fields) + " fields, got " +
+                           std::to_string(fields.size()));
+  }
+  return fields;
+}
@@ -25,4 +25,12 @@ std::string hash_string (const std::string & str);
 /// Compare two strings after removing all forms of whitespace
 bool compare_after_removing_space(const std::string & s1, const std::string & s2);
 
+/// Pack fields into one string: each field's length in decimal,
+/// a newline, and then the field itself, so fields may hold any bytes
+std::string encode_fields(const std::vector<std::string> & fields);
+
+/// Unpack a string produced by encode_fields, throwing std::logic_error
+/// if it is malformed or doesn't have exactly num_fields fields
+std::vector<std::string> decode_fields(const std::string & encoded, const size_t num_fields);
+
 #endif  // UTIL_H_